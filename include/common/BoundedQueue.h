@@ -0,0 +1,120 @@
+#ifndef BOUNDED_QUEUE_H
+#define BOUNDED_QUEUE_H
+
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief A fixed-capacity, thread-safe handoff queue between producers and a single consumer.
+ *
+ * Producers never block: when the queue is full the item is rejected and counted
+ * as dropped. The consumer drains everything available in one call, which keeps
+ * lock traffic proportional to batches rather than items.
+ * @tparam T The type of data to be stored in the queue.
+ */
+template <typename T>
+class BoundedQueue {
+public:
+    /**
+     * @brief Constructs the queue with a fixed capacity.
+     * @param capacity The maximum number of items held at once.
+     */
+    explicit BoundedQueue(std::size_t capacity)
+        : buffer_(capacity > 0 ? capacity : 1) {}
+
+    /**
+     * @brief Pushes data to the queue without blocking.
+     * @param value The data to be pushed.
+     * @return True if the data was queued, false if the queue was full or closed.
+     */
+    bool tryPush(const T& value) {
+        bool wasEmpty;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (closed_ || count_ == buffer_.size()) {
+                ++dropped_;
+                return false;
+            }
+            buffer_[(head_ + count_) % buffer_.size()] = value;
+            wasEmpty = (count_++ == 0);
+        }
+        // Only the transition from empty can have a sleeping consumer.
+        if (wasEmpty) {
+            conditionVariable_.notify_one();
+        }
+        return true;
+    }
+
+    /**
+     * @brief Moves every queued item into the output vector.
+     *
+     * Waits up to the timeout for at least one item if the queue is empty.
+     * @param out The vector that receives the items (appended).
+     * @param timeoutMs Timeout duration in milliseconds.
+     * @return The number of items moved.
+     */
+    std::size_t drain(std::vector<T>& out, int timeoutMs) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        conditionVariable_.wait_for(lock, std::chrono::milliseconds(timeoutMs),
+                                    [this] { return closed_ || count_ > 0; });
+        const std::size_t drained = count_;
+        for (std::size_t i = 0; i < drained; ++i) {
+            out.push_back(std::move(buffer_[head_]));
+            head_ = (head_ + 1) % buffer_.size();
+        }
+        count_ = 0;
+        return drained;
+    }
+
+    /**
+     * @brief Rejects further pushes and wakes the consumer.
+     */
+    void close() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            closed_ = true;
+        }
+        conditionVariable_.notify_all();
+    }
+
+    /**
+     * @brief Checks whether the queue is closed and empty, so no item can arrive any more.
+     * @return True once every item pushed before close() has been drained.
+     */
+    bool closedAndEmpty() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return closed_ && count_ == 0;
+    }
+
+    /**
+     * @brief Re-opens a closed queue so it accepts pushes again.
+     */
+    void reopen() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed_ = false;
+    }
+
+    /**
+     * @brief Returns the number of items rejected since construction.
+     * @return The dropped item count.
+     */
+    std::uint64_t dropped() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return dropped_;
+    }
+
+private:
+    std::vector<T> buffer_;
+    std::size_t head_ = 0;
+    std::size_t count_ = 0;
+    std::uint64_t dropped_ = 0;
+    bool closed_ = false;
+    std::mutex mutex_;
+    std::condition_variable conditionVariable_;
+};
+
+#endif // BOUNDED_QUEUE_H
@@ -0,0 +1,81 @@
+#ifndef CYCLE_ARENA_H
+#define CYCLE_ARENA_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+
+/**
+ * @class CycleArena
+ * @brief A monotonic std::pmr arena for objects that all die together at the end of a cycle.
+ *
+ * Allocations are served by bumping a pointer through a preallocated buffer and
+ * individual deallocations are no-ops. reset() makes the whole buffer available
+ * again in constant time. If a cycle needs more than the buffer holds, the arena
+ * falls back to the heap and counts the overflow so the capacity can be tuned.
+ * Not thread-safe: one arena belongs to one thread.
+ */
+class CycleArena {
+public:
+    /**
+     * @brief Constructs an arena with a fixed initial buffer.
+     * @param capacity The size of the preallocated buffer in bytes.
+     */
+    explicit CycleArena(std::size_t capacity);
+
+    CycleArena(const CycleArena&) = delete;
+    CycleArena& operator=(const CycleArena&) = delete;
+
+    /**
+     * @brief Returns the memory resource to pass to pmr containers.
+     * @return The arena's memory resource.
+     */
+    std::pmr::memory_resource* resource() { return &resource_; }
+
+    /**
+     * @brief Releases everything allocated since the last reset.
+     *
+     * Every object allocated from the arena must have been destroyed.
+     */
+    void reset();
+
+    /**
+     * @brief Touches every page of the preallocated buffer so the first cycles do not page-fault.
+     */
+    void prefault();
+
+    /**
+     * @brief Returns the size of the preallocated buffer.
+     * @return The capacity in bytes.
+     */
+    std::size_t capacity() const { return capacity_; }
+
+    /**
+     * @brief Returns how many heap allocations were needed because a cycle outgrew the buffer.
+     * @return The overflow allocation count.
+     */
+    std::uint64_t overflowAllocations() const { return overflow_.allocations.load(std::memory_order_relaxed); }
+
+private:
+    /**
+     * @brief Upstream resource that counts the allocations it serves.
+     */
+    class OverflowResource : public std::pmr::memory_resource {
+    public:
+        std::atomic<std::uint64_t> allocations{0};
+
+    private:
+        void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+        void do_deallocate(void* pointer, std::size_t bytes, std::size_t alignment) override;
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+    };
+
+    std::size_t capacity_;
+    std::unique_ptr<std::byte[]> buffer_;
+    OverflowResource overflow_;
+    std::pmr::monotonic_buffer_resource resource_;
+};
+
+#endif // CYCLE_ARENA_H
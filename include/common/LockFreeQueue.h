@@ -0,0 +1,191 @@
+#ifndef LOCK_FREE_QUEUE_H
+#define LOCK_FREE_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+
+/**
+ * @class MpmcRing
+ * @brief Bounded multi-producer/multi-consumer ring over positions and cells owned by the caller.
+ *
+ * Each cell carries a sequence number that tells producers and consumers
+ * whether it is free or filled for the current lap, so push and pop are one
+ * compare-and-swap on the shared position plus a copy, and neither side ever
+ * waits on the other. The ring keeps only pointers to its storage, so the same
+ * code runs over a heap array or over a shared-memory segment.
+ * @tparam Cell A type with an std::atomic<Position> sequence member and a value member.
+ * @tparam Position The unsigned type of the push and pop positions.
+ */
+template <typename Cell, typename Position>
+class MpmcRing {
+    static_assert(std::is_unsigned_v<Position>, "MpmcRing positions must be unsigned.");
+
+public:
+    MpmcRing() = default;
+
+    /**
+     * @brief Attaches the ring to its storage.
+     * @param tail Position of the next push.
+     * @param head Position of the next pop.
+     * @param cells The cells.
+     * @param capacity The number of cells, a power of two.
+     */
+    MpmcRing(std::atomic<Position>* tail, std::atomic<Position>* head, Cell* cells, std::size_t capacity)
+        : tail_(tail), head_(head), cells_(cells), mask_(static_cast<Position>(capacity - 1)) {}
+
+    /**
+     * @brief Empties the ring and marks every cell free for the first lap. Not thread-safe.
+     */
+    void initialize() const {
+        tail_->store(0, std::memory_order_relaxed);
+        head_->store(0, std::memory_order_relaxed);
+        for (Position i = 0; i <= mask_; ++i) {
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * @brief Pushes a value without blocking.
+     * @param value The value.
+     * @return True if the value was queued, false if the ring was full.
+     */
+    template <typename Value>
+    bool tryPush(const Value& value) const {
+        Position position = tail_->load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = cells_[position & mask_];
+            const Position sequence = cell.sequence.load(std::memory_order_acquire);
+            const auto difference = static_cast<std::make_signed_t<Position>>(sequence - position);
+            if (difference == 0) {
+                if (tail_->compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    cell.value = value;
+                    cell.sequence.store(position + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (difference < 0) {
+                return false;
+            } else {
+                position = tail_->load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /**
+     * @brief Pops the oldest value without blocking.
+     * @param value Receives the value.
+     * @return True if a value was popped, false if the ring was empty.
+     */
+    template <typename Value>
+    bool tryPop(Value& value) const {
+        Position position = head_->load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = cells_[position & mask_];
+            const Position sequence = cell.sequence.load(std::memory_order_acquire);
+            const auto difference = static_cast<std::make_signed_t<Position>>(sequence - (position + 1));
+            if (difference == 0) {
+                if (head_->compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    value = cell.value;
+                    cell.sequence.store(position + mask_ + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (difference < 0) {
+                return false;
+            } else {
+                position = head_->load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /**
+     * @brief Returns the number of cells.
+     * @return The capacity.
+     */
+    std::size_t capacity() const { return static_cast<std::size_t>(mask_) + 1; }
+
+private:
+    std::atomic<Position>* tail_ = nullptr;
+    std::atomic<Position>* head_ = nullptr;
+    Cell* cells_ = nullptr;
+    Position mask_ = 0;
+};
+
+/**
+ * @class LockFreeQueue
+ * @brief A fixed-capacity, lock-free queue of trivially copyable items that owns its storage.
+ *
+ * An MpmcRing over a heap array, with each position on its own cache line.
+ * Neither push nor pop blocks or allocates: a full queue rejects the item and
+ * counts it as dropped, so a slow consumer cannot stall the producers.
+ * @tparam T The type of data to be stored in the queue. Must be trivially copyable.
+ */
+template <typename T>
+class LockFreeQueue {
+    static_assert(std::is_trivially_copyable_v<T>, "LockFreeQueue items must be trivially copyable.");
+
+public:
+    /**
+     * @brief Constructs the queue.
+     * @param capacity The maximum number of items held at once, rounded up to a power of two.
+     */
+    explicit LockFreeQueue(std::size_t capacity) {
+        std::size_t size = 2;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        cells_ = std::make_unique<Cell[]>(size);
+        ring_ = MpmcRing<Cell, std::size_t>(&tail_, &head_, cells_.get(), size);
+        ring_.initialize();
+    }
+
+    LockFreeQueue(const LockFreeQueue&) = delete;
+    LockFreeQueue& operator=(const LockFreeQueue&) = delete;
+
+    /**
+     * @brief Pushes an item without blocking.
+     * @param value The item.
+     * @return True if the item was queued, false if the queue was full.
+     */
+    bool tryPush(const T& value) {
+        if (ring_.tryPush(value)) {
+            return true;
+        }
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    /**
+     * @brief Pops the oldest item without blocking.
+     * @param value Receives the item.
+     * @return True if an item was popped, false if the queue was empty.
+     */
+    bool tryPop(T& value) { return ring_.tryPop(value); }
+
+    /**
+     * @brief Returns the capacity of the queue.
+     * @return The capacity.
+     */
+    std::size_t capacity() const { return ring_.capacity(); }
+
+    /**
+     * @brief Returns the number of items rejected since construction.
+     * @return The dropped item count.
+     */
+    std::uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+    struct Cell {
+        std::atomic<std::size_t> sequence{0};
+        T value{};
+    };
+
+    std::unique_ptr<Cell[]> cells_;
+    MpmcRing<Cell, std::size_t> ring_;
+    alignas(64) std::atomic<std::size_t> tail_{0};
+    alignas(64) std::atomic<std::size_t> head_{0};
+    alignas(64) std::atomic<std::uint64_t> dropped_{0};
+};
+
+#endif // LOCK_FREE_QUEUE_H
@@ -0,0 +1,132 @@
+#ifndef REALTIME_PROFILE_H
+#define REALTIME_PROFILE_H
+
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * @struct RealtimeThreadConfig
+ * @brief Scheduling settings for one latency-critical thread.
+ */
+struct RealtimeThreadConfig {
+    bool enabled = false;
+    int priority = 50;                          // SCHED_FIFO priority (1-99)
+    std::vector<int> cpus;                      // CPUs to pin to; empty leaves the affinity unchanged
+    std::size_t stackPrefaultBytes = 256 * 1024; // Stack touched up front so it never faults later
+};
+
+/**
+ * @struct RealtimeProfileConfig
+ * @brief The runtime profile for the library's I/O and monitoring threads.
+ */
+struct RealtimeProfileConfig {
+    bool lockMemory = false;                    // mlockall the process and keep freed heap mapped
+    std::size_t heapPrefaultBytes = 8 * 1024 * 1024; // Heap grown and touched once when memory is locked
+    RealtimeThreadConfig ioThread;
+    RealtimeThreadConfig monitorThread;
+};
+
+/**
+ * @struct RealtimeThreadResult
+ * @brief What was actually applied to one thread.
+ */
+struct RealtimeThreadResult {
+    std::string name;
+    bool realtimeScheduling = false;            // Running under SCHED_FIFO
+    bool pinned = false;                        // Affinity restricted to the configured CPUs
+    std::size_t stackPrefaultedBytes = 0;
+    std::vector<std::string> fallbacks;         // Settings that could not be applied, and why
+};
+
+/**
+ * @struct RealtimeReport
+ * @brief Summary of the applied real-time profile.
+ */
+struct RealtimeReport {
+    bool memoryLocked = false;
+    std::size_t heapPrefaultedBytes = 0;
+    std::vector<std::string> fallbacks;         // Process-wide settings that could not be applied
+    std::vector<RealtimeThreadResult> threads;
+
+    /**
+     * @brief Writes the report to the log.
+     */
+    void log() const;
+};
+
+/**
+ * @class RealtimeProfile
+ * @brief Applies a real-time execution profile and records what took effect.
+ *
+ * Tail latency on a shared host is dominated by page faults and preemption, so
+ * the profile locks the process's memory, pre-faults the heap and thread
+ * stacks, and runs the selected threads under SCHED_FIFO on pinned CPUs.
+ * Every step degrades gracefully: without the privileges (CAP_SYS_NICE,
+ * CAP_IPC_LOCK or a sufficient RLIMIT_MEMLOCK) or on non-Linux platforms the
+ * thread keeps running with default settings and the report lists the fallback.
+ *
+ * Threads apply their settings themselves, from inside the thread, so one
+ * profile object can be shared by all threads.
+ */
+class RealtimeProfile {
+public:
+    /**
+     * @brief Constructs a profile. Nothing is applied until the apply methods are called.
+     * @param config The profile settings.
+     */
+    explicit RealtimeProfile(RealtimeProfileConfig config);
+
+    RealtimeProfile(const RealtimeProfile&) = delete;
+    RealtimeProfile& operator=(const RealtimeProfile&) = delete;
+
+    /**
+     * @brief Applies the process-wide settings (memory locking and heap pre-faulting).
+     *
+     * Call once at startup, before the latency-critical threads start.
+     */
+    void applyProcess();
+
+    /**
+     * @brief Applies the I/O thread settings to the calling thread.
+     *
+     * Call at the top of each thread that runs the io_context.
+     * @param name The thread name used in the report and, on Linux, for the OS thread.
+     */
+    void applyIoThread(const std::string& name = "kohzu-io");
+
+    /**
+     * @brief Applies the monitoring thread settings to the calling thread.
+     * @param name The thread name used in the report and, on Linux, for the OS thread.
+     */
+    void applyMonitorThread(const std::string& name = "kohzu-monitor");
+
+    /**
+     * @brief Returns whether the process settings request locked, pre-faulted memory.
+     * @return True if buffers should be pre-faulted.
+     */
+    bool prefaultsBuffers() const { return config_.lockMemory; }
+
+    /**
+     * @brief Returns a copy of what has been applied so far.
+     * @return The report.
+     */
+    RealtimeReport report() const;
+
+    /**
+     * @brief Touches every page of a buffer so later accesses do not fault.
+     * @param data The buffer.
+     * @param bytes The size of the buffer in bytes.
+     */
+    static void prefault(void* data, std::size_t bytes);
+
+private:
+    void applyThread(const std::string& name, const RealtimeThreadConfig& config);
+
+    RealtimeProfileConfig config_;
+    mutable std::mutex mutex_;
+    RealtimeReport report_;
+};
+
+#endif // REALTIME_PROFILE_H
@@ -2,9 +2,14 @@
 #define AXIS_STATE_H
 
 #include <mutex>
+#include <atomic>
+#include <array>
 #include <map>
 #include <string>
 #include <vector>
+#include <cstdint>
+#include <functional>
+#include <utility>
 
 /**
  * @struct AxisStatus
@@ -19,6 +24,118 @@ struct AxisStatus {
     int cwCcwLimitSignal = 0;
     int softLimitState = 0;
     int correctionAllowableRange = 0;
+
+    /**
+     * @brief Packs the status fields into a single word, 4 bits per field in declaration order.
+     * @return The packed status word.
+     */
+    std::uint32_t toWord() const;
+
+    /**
+     * @brief Unpacks a status word produced by toWord().
+     * @param word The packed status word.
+     * @return The unpacked AxisStatus structure.
+     */
+    static AxisStatus fromWord(std::uint32_t word);
+};
+
+/**
+ * @struct AxisSample
+ * @brief A single observation of an axis, published on every state update.
+ *
+ * Samples carry the full state of the axis (position and packed status word)
+ * at the time of the update, so consumers never need to join separate streams.
+ */
+struct AxisSample {
+    std::int64_t timestampNs = 0; // Nanoseconds since the system clock epoch
+    int axisNo = 0;
+    int position = 0;             // -1 if hasPosition is false
+    std::uint32_t statusWord = 0;
+    bool hasPosition = false;     // False until the axis's position has been read once
+    bool positionUpdated = false; // True if the update carried a new position reading; not kept in telemetry files
+};
+
+/**
+ * @enum AxisCondition
+ * @brief Conditions of an axis tracked machine-wide by AxisState, one bit each.
+ */
+enum AxisCondition : std::uint8_t {
+    conditionMoving = 1,      // drivingState != 0
+    conditionLimitOrEmg = 2,  // emgSignal, cwCcwLimitSignal or softLimitState != 0
+    conditionHomed = 4        // Origin return completed (see AxisState::setHomed())
+};
+
+/**
+ * @struct AxisAggregates
+ * @brief Machine-wide counts of the axes in each condition, read in one atomic load.
+ */
+struct AxisAggregates {
+    std::uint32_t axes = 0;        // Axes with a status or a homed mark
+    std::uint32_t moving = 0;
+    std::uint32_t limitOrEmg = 0;
+    std::uint32_t homed = 0;
+
+    bool anyMoving() const { return moving != 0; }
+    bool anyLimitOrEmg() const { return limitOrEmg != 0; }
+    bool allHomed() const { return axes != 0 && homed == axes; }
+};
+
+/**
+ * @class AxisUpdateBatch
+ * @brief Position and status updates collected from one receive batch or monitoring cycle.
+ *
+ * The batch is filled without touching AxisState and handed to
+ * AxisState::apply(), which stores every update under one lock and notifies
+ * the listeners once. Not thread-safe; one batch is filled by one thread at a time.
+ */
+class AxisUpdateBatch {
+public:
+    /**
+     * @brief Adds a position update.
+     * @param axisNo The axis number.
+     * @param position The new position value.
+     * @param timestampNs When the position was read, or 0 for the time the batch is applied.
+     */
+    void addPosition(int axisNo, int position, std::int64_t timestampNs);
+
+    /**
+     * @brief Parses and adds a status update from the parameters of an STR response.
+     * @param axisNo The axis number.
+     * @param params A vector of strings containing status parameters from the STR command.
+     * @param timestampNs When the status was read, or 0 for the time the batch is applied.
+     * @return True if the parameters were valid and the update was added.
+     */
+    bool addStatus(int axisNo, const std::vector<std::string>& params, std::int64_t timestampNs);
+
+    /**
+     * @brief Returns the number of updates collected.
+     * @return The update count.
+     */
+    std::size_t size() const { return updates_.size(); }
+
+    /**
+     * @brief Checks whether the batch holds no update.
+     * @return True if empty.
+     */
+    bool empty() const { return updates_.empty(); }
+
+    /**
+     * @brief Discards the collected updates, keeping the storage for the next batch.
+     */
+    void clear() { updates_.clear(); }
+
+private:
+    friend class AxisState;
+
+    struct Update {
+        int axisNo = 0;
+        bool isStatus = false;
+        int position = 0;
+        AxisStatus status;
+        std::int64_t timestampNs = 0;
+    };
+
+    std::vector<Update> updates_;
 };
 
 /**
@@ -31,6 +148,101 @@ struct AxisStatus {
  */
 class AxisState {
 public:
+    using SampleListener = std::function<void(const AxisSample&)>;
+    using SampleBatchListener = std::function<void(const std::vector<AxisSample>&)>;
+
+    /**
+     * @brief Registers a listener that receives a sample after every position or status update.
+     *
+     * Listeners run on the updating thread while the state lock is held, so they must be
+     * cheap and must not call back into AxisState.
+     * @param listener The function to be called with each new sample.
+     */
+    void addSampleListener(SampleListener listener);
+
+    /**
+     * @brief Registers a listener that receives all samples of an update in one call.
+     *
+     * Called once per apply() with one sample per updated axis, and once per single update.
+     * Runs under the state lock, like SampleListener.
+     * @param listener The function to be called with the samples of each update.
+     */
+    void addSampleBatchListener(SampleBatchListener listener);
+
+    /**
+     * @brief Stores every update of a batch under one lock and notifies the listeners once.
+     *
+     * Each updated axis yields one sample carrying its state after the whole batch,
+     * stamped with the time of its position reading, or of its status if the batch has
+     * no position for the axis.
+     * @param batch The collected updates. Left unchanged.
+     */
+    void apply(const AxisUpdateBatch& batch);
+
+    /**
+     * @brief Returns a counter bumped once per position or status update and once per apply().
+     *
+     * Readers can poll it to skip re-reading unchanged state.
+     * @return The update version.
+     */
+    std::uint64_t version() const { return version_.load(std::memory_order_acquire); }
+
+    /**
+     * @brief Marks whether an axis has completed an origin return.
+     *
+     * STR does not report homing, so the homed condition is set from outside
+     * (KohzuController::moveOrigin() does so when the origin return completes).
+     * @param axisNo The axis number.
+     * @param homed True once the axis is homed, false if its origin is lost.
+     */
+    void setHomed(int axisNo, bool homed);
+
+    /**
+     * @brief Returns the machine-wide condition counts.
+     *
+     * Maintained on every status update, so this is one atomic load regardless of the number of axes.
+     * @return The counts, all taken from the same update.
+     */
+    AxisAggregates aggregates() const;
+
+    /**
+     * @brief Checks whether any axis is moving. One atomic load.
+     * @return True if at least one axis reported a non-zero driving state.
+     */
+    bool anyMoving() const { return aggregates().anyMoving(); }
+
+    /**
+     * @brief Checks whether any axis has an active limit or EMG signal. One atomic load.
+     * @return True if at least one axis reported EMG, a hardware limit or a soft limit.
+     */
+    bool anyLimitOrEmg() const { return aggregates().anyLimitOrEmg(); }
+
+    /**
+     * @brief Checks whether every known axis is homed. One atomic load.
+     * @return True if there is at least one axis and all of them are homed.
+     */
+    bool allHomed() const { return aggregates().allHomed(); }
+
+    /**
+     * @brief Checks a condition of one axis. One atomic load.
+     * @param axisNo The axis number. Only axes 0 to kMaxConditionAxes - 1 are tracked per axis.
+     * @param condition The condition.
+     * @return True if the axis is in the condition.
+     * @throws std::invalid_argument if condition is not exactly one AxisCondition.
+     */
+    bool hasCondition(int axisNo, AxisCondition condition) const;
+
+    /**
+     * @brief Lists the axes in a condition by scanning its bitset.
+     * @param condition The condition.
+     * @return The axis numbers, ascending.
+     * @throws std::invalid_argument if condition is not exactly one AxisCondition.
+     */
+    std::vector<int> axesWithCondition(AxisCondition condition) const;
+
+    static constexpr int kMaxConditionAxes = 1024;   ///< Axes covered by the per-axis bitsets; aggregates count all axes
+    static constexpr int kMaxAggregateAxes = 0xFFFF; ///< Axes counted by the aggregates (16 bits per count); further axes are logged and left out
+
     /**
      * @brief Updates the current position of a specific axis.
      * @param axisNo The axis number.
@@ -45,6 +257,23 @@ public:
      */
     void updateStatus(int axisNo, const std::vector<std::string>& params);
 
+    /**
+     * @brief Updates the current position of a specific axis, stamping the sample with a known time.
+     * @param axisNo The axis number.
+     * @param position The new position value.
+     * @param timestampNs When the position was read, in nanoseconds since the epoch (e.g. ProtocolResponse::sampleNs).
+     *                    0 stamps the sample with the current time.
+     */
+    void updatePosition(int axisNo, int position, std::int64_t timestampNs);
+
+    /**
+     * @brief Updates the detailed status of a specific axis, stamping the sample with a known time.
+     * @param axisNo The axis number.
+     * @param params A vector of strings containing status parameters from the STR command.
+     * @param timestampNs When the status was read, in nanoseconds since the epoch. 0 stamps the sample with the current time.
+     */
+    void updateStatus(int axisNo, const std::vector<std::string>& params, std::int64_t timestampNs);
+
     /**
      * @brief Retrieves the last known position of a specific axis.
      * @param axisNo The axis number.
@@ -59,9 +288,41 @@ public:
      */
     AxisStatus getStatusDetails(int axisNo);
 
+    /**
+     * @brief Caches the value of a system parameter of a specific axis (RSY/WSY).
+     * @param axisNo The axis number.
+     * @param systemNo The system parameter number.
+     * @param value The parameter value.
+     */
+    void updateSystemParameter(int axisNo, int systemNo, int value);
+
+    /**
+     * @brief Retrieves the cached value of a system parameter of a specific axis.
+     * @param axisNo The axis number.
+     * @param systemNo The system parameter number.
+     * @param value Receives the cached value.
+     * @return True if the parameter has been read before, false otherwise.
+     */
+    bool getSystemParameter(int axisNo, int systemNo, int& value);
+
 private:
+    void publishSample(int axisNo, std::int64_t timestampNs, bool positionUpdated);
+    void publishSamples();
+    void updateConditions(int axisNo, std::uint8_t conditions, std::uint8_t mask);
+
+    static constexpr int kConditionCount = 3;
+    static constexpr std::size_t kConditionWords = kMaxConditionAxes / 64;
+
     std::map<int, int> positions_;
     std::map<int, AxisStatus> statuses_;
+    std::map<std::pair<int, int>, int> systemParameters_; // Keyed by (axisNo, systemNo)
+    std::vector<SampleListener> sampleListeners_;
+    std::vector<SampleBatchListener> sampleBatchListeners_;
+    std::vector<AxisSample> pendingSamples_; // Samples of the update being published; reused under mutex_
+    std::atomic<std::uint64_t> version_{0};
+    std::map<int, std::uint8_t> conditions_; // Current AxisCondition bits per axis
+    std::atomic<std::uint64_t> aggregates_{0}; // AxisAggregates packed 16 bits per count: axes, moving, limitOrEmg, homed
+    std::array<std::array<std::atomic<std::uint64_t>, kConditionWords>, kConditionCount> conditionBits_{};
     std::mutex mutex_;
 };
 
@@ -0,0 +1,100 @@
+#ifndef AXIS_STATISTICS_H
+#define AXIS_STATISTICS_H
+
+#include "controller/AxisState.h"
+#include <cstdint>
+#include <map>
+#include <mutex>
+
+/**
+ * @struct AxisStatisticsSnapshot
+ * @brief Running statistics of a single axis at the time of the snapshot.
+ *
+ * A move starts when the driving state turns non-zero and ends when it returns
+ * to zero. Overshoot is how far the axis travelled past its final position in
+ * the direction of the move. Samples without a position (AxisSample::hasPosition)
+ * count toward move durations and time in limit but not toward travel or overshoot.
+ */
+struct AxisStatisticsSnapshot {
+    std::uint64_t sampleCount = 0;
+    std::uint64_t moveCount = 0;            // Completed moves
+    std::int64_t totalTravel = 0;           // Sum of absolute position changes
+    std::int64_t totalMoveDurationNs = 0;
+    std::int64_t lastMoveDurationNs = 0;
+    std::int64_t maxMoveDurationNs = 0;
+    int lastOvershoot = 0;
+    int maxOvershoot = 0;
+    std::int64_t timeInLimitNs = 0;         // Time with a hardware or software limit active
+    bool isMoving = false;
+
+    /**
+     * @brief Returns the mean duration of the completed moves.
+     * @return The mean move duration in nanoseconds.
+     */
+    double meanMoveDurationNs() const {
+        return moveCount > 0 ? static_cast<double>(totalMoveDurationNs) / moveCount : 0.0;
+    }
+};
+
+/**
+ * @class AxisStatistics
+ * @brief Maintains per-axis move and travel statistics incrementally from AxisState samples.
+ *
+ * Every sample is folded in with constant work, so snapshots are a copy of the
+ * accumulated values and cost nothing to compute.
+ */
+class AxisStatistics {
+public:
+    /**
+     * @brief Registers this object as a sample listener of the given AxisState.
+     *
+     * The statistics must outlive any further updates to the AxisState.
+     * @param axisState The state whose updates should be accumulated.
+     */
+    void attach(AxisState& axisState);
+
+    /**
+     * @brief Folds a sample into the statistics of its axis.
+     * @param sample The sample to accumulate.
+     */
+    void addSample(const AxisSample& sample);
+
+    /**
+     * @brief Returns the statistics of a single axis.
+     * @param axisNo The axis number.
+     * @return The snapshot. Default-constructed if the axis has no samples.
+     */
+    AxisStatisticsSnapshot snapshot(int axisNo);
+
+    /**
+     * @brief Returns the statistics of every axis seen so far.
+     * @return The snapshots keyed by axis number.
+     */
+    std::map<int, AxisStatisticsSnapshot> snapshotAll();
+
+    /**
+     * @brief Clears the statistics of a single axis, e.g. after maintenance.
+     * @param axisNo The axis number.
+     */
+    void reset(int axisNo);
+
+private:
+    struct Accumulator {
+        AxisStatisticsSnapshot stats;
+        bool hasPrevious = false;
+        bool hasPosition = false;       // lastPosition is known
+        int lastPosition = 0;
+        std::int64_t lastTimestampNs = 0;
+        bool inLimit = false;
+        std::int64_t moveStartNs = 0;
+        bool moveHasPosition = false;   // moveStartPosition is known
+        int moveStartPosition = 0;
+        int moveMinPosition = 0;
+        int moveMaxPosition = 0;
+    };
+
+    std::map<int, Accumulator> axes_;
+    std::mutex mutex_;
+};
+
+#endif // AXIS_STATISTICS_H
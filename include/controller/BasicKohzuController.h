@@ -0,0 +1,211 @@
+#ifndef BASIC_KOHZU_CONTROLLER_H
+#define BASIC_KOHZU_CONTROLLER_H
+
+#include "controller/AxisState.h"
+#include "protocol/BasicProtocolHandler.h"
+#include "protocol/ProtocolError.h"
+#include "spdlog/spdlog.h"
+#include <memory>
+#include <stdexcept>
+#include <utility>
+
+/**
+ * @class BasicKohzuController
+ * @brief The command interface of KohzuController with the transport and completion types fixed at compile time.
+ *
+ * Commands go through a BasicProtocolHandler, so the path from a received line
+ * to AxisState and the caller's completion has no virtual call and no
+ * std::function. Position, status and system parameter reads update AxisState
+ * before the completion runs, and origin returns maintain the homed condition,
+ * as in KohzuController. The monitoring thread, batches, cancellation and
+ * shutdown stay with KohzuController.
+ *
+ * @tparam Transport The transport type (see BasicProtocolHandler).
+ * @tparam Completion The completion type, callable as completion(const ProtocolResponse&).
+ */
+template <typename Transport, typename Completion>
+class BasicKohzuController {
+public:
+    /**
+     * @struct Dispatch
+     * @brief The handler's completion type: stores read results in AxisState, then runs the caller's completion.
+     */
+    struct Dispatch {
+        enum class Kind : std::uint8_t { command, origin, position, status, system };
+
+        AxisState* axisState = nullptr;
+        Kind kind = Kind::command;
+        int axisNo = -1;
+        int systemNo = 0;
+        Completion completion;
+
+        void operator()(const ProtocolResponse& response) {
+            if (response.status == 'C') {
+                store(response);
+            }
+            completion(response);
+        }
+
+    private:
+        void store(const ProtocolResponse& response) {
+            int value = 0;
+            switch (kind) {
+            case Kind::position:
+                if (!response.params.empty() && !parseInteger(response.params[0], value)) {
+                    axisState->updatePosition(axisNo, value, response.sampleNs);
+                }
+                break;
+            case Kind::status:
+                if (response.params.size() >= 6) {
+                    axisState->updateStatus(axisNo, response.params, response.sampleNs);
+                }
+                break;
+            case Kind::system:
+                if (!response.params.empty() && !parseInteger(response.params.back(), value)) {
+                    axisState->updateSystemParameter(axisNo, systemNo, value);
+                }
+                break;
+            case Kind::origin:
+                axisState->setHomed(axisNo, true);
+                break;
+            case Kind::command:
+                break;
+            }
+        }
+    };
+
+    using Handler = BasicProtocolHandler<Transport, Dispatch>;
+
+    /**
+     * @brief Constructs a controller on the given transport.
+     * @param transport The transport. Must outlive the controller.
+     * @param axisState The AxisState updated by read commands.
+     */
+    BasicKohzuController(Transport& transport, std::shared_ptr<AxisState> axisState)
+        : handler_(transport), axisState_(std::move(axisState)) {
+        if (!axisState_) {
+            throw std::invalid_argument("AxisState object is not valid.");
+        }
+    }
+
+    /**
+     * @brief Routes the transport's received lines to the handler (see BasicProtocolHandler::initialize()).
+     */
+    void start() { handler_.initialize(); }
+
+    /**
+     * @brief Sets the latency split of the connection (see BasicProtocolHandler::setLatencySplit()).
+     * @param outboundShare Fraction of the minimum round trip spent before the controller serves a request.
+     * @param windowSamples Number of samples after which the minimum round trip is re-measured.
+     */
+    void setLatencySplit(double outboundShare, std::size_t windowSamples = 1024) {
+        handler_.setLatencySplit(outboundShare, windowSamples);
+    }
+
+    /**
+     * @brief Commands the specified axis to move to an absolute position. (APS command)
+     * @param axisNo The axis number to move.
+     * @param position The target absolute position.
+     * @param speed The movement speed.
+     * @param responseType The response type.
+     * @param completion Called when the command completes.
+     */
+    void moveAbsolute(int axisNo, int position, int speed, int responseType, Completion completion) {
+        // According to the manual, the parameter order is: speed, position, response_type.
+        handler_.sendCommand("APS", axisNo, {speed, position, responseType}, command(axisNo, std::move(completion)));
+    }
+
+    /**
+     * @brief Commands the specified axis to move by a relative distance. (RPS command)
+     * @param axisNo The axis number to move.
+     * @param distance The relative distance to move.
+     * @param speed The movement speed.
+     * @param responseType The response type.
+     * @param completion Called when the command completes.
+     */
+    void moveRelative(int axisNo, int distance, int speed, int responseType, Completion completion) {
+        handler_.sendCommand("RPS", axisNo, {speed, distance, responseType}, command(axisNo, std::move(completion)));
+    }
+
+    /**
+     * @brief Commands the specified axis to perform an origin return operation. (ORG command)
+     *
+     * The axis counts as not homed from now on; with responseType 0 it is marked
+     * homed in AxisState when the origin return completes.
+     * @param axisNo The axis number to move.
+     * @param speed The movement speed (0-9).
+     * @param responseType The response type.
+     * @param completion Called when the command completes.
+     */
+    void moveOrigin(int axisNo, int speed, int responseType, Completion completion) {
+        axisState_->setHomed(axisNo, false);
+        // With another response type the reply only acknowledges the command.
+        const auto kind = responseType == 0 ? Dispatch::Kind::origin : Dispatch::Kind::command;
+        handler_.sendCommand("ORG", axisNo, {speed, responseType},
+                             Dispatch{axisState_.get(), kind, axisNo, 0, std::move(completion)});
+    }
+
+    /**
+     * @brief Sets a system parameter value for a specified axis. (WSY command)
+     * @param axisNo The axis number to configure.
+     * @param systemNo The system parameter number.
+     * @param value The value to set for the parameter.
+     * @param completion Called when the command completes.
+     */
+    void setSystem(int axisNo, int systemNo, int value, Completion completion) {
+        handler_.sendCommand("WSY", axisNo, {systemNo, value}, command(axisNo, std::move(completion)));
+    }
+
+    /**
+     * @brief Reads a system parameter and caches it in AxisState. (RSY command)
+     * @param axisNo The axis number to query.
+     * @param systemNo The system parameter number.
+     * @param completion Called when the command completes.
+     */
+    void readSystem(int axisNo, int systemNo, Completion completion) {
+        handler_.sendCommand("RSY", axisNo, {systemNo},
+                             Dispatch{axisState_.get(), Dispatch::Kind::system, axisNo, systemNo, std::move(completion)});
+    }
+
+    /**
+     * @brief Reads the position of an axis into AxisState. (RDP command)
+     * @param axisNo The axis number.
+     * @param completion Called when the command completes.
+     */
+    void readPosition(int axisNo, Completion completion) {
+        handler_.sendCommand("RDP", axisNo, {},
+                             Dispatch{axisState_.get(), Dispatch::Kind::position, axisNo, 0, std::move(completion)});
+    }
+
+    /**
+     * @brief Reads the detailed status of an axis into AxisState. (STR command)
+     * @param axisNo The axis number.
+     * @param completion Called when the command completes.
+     */
+    void readStatus(int axisNo, Completion completion) {
+        handler_.sendCommand("STR", axisNo, {},
+                             Dispatch{axisState_.get(), Dispatch::Kind::status, axisNo, 0, std::move(completion)});
+    }
+
+    /**
+     * @brief Returns the protocol handler, e.g. for a transport read loop that calls handleRead().
+     * @return The handler.
+     */
+    Handler& protocolHandler() { return handler_; }
+
+    /**
+     * @brief Returns the AxisState updated by read commands.
+     * @return The axis state.
+     */
+    const std::shared_ptr<AxisState>& axisState() const { return axisState_; }
+
+private:
+    Dispatch command(int axisNo, Completion completion) {
+        return Dispatch{axisState_.get(), Dispatch::Kind::command, axisNo, 0, std::move(completion)};
+    }
+
+    Handler handler_;
+    std::shared_ptr<AxisState> axisState_;
+};
+
+#endif // BASIC_KOHZU_CONTROLLER_H
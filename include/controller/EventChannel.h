@@ -0,0 +1,118 @@
+#ifndef EVENT_CHANNEL_H
+#define EVENT_CHANNEL_H
+
+#include "common/LockFreeQueue.h"
+#include "controller/AxisState.h"
+#include "protocol/ProtocolHandler.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+/**
+ * @enum ControllerEventType
+ * @brief The kind of a ControllerEvent.
+ */
+enum class ControllerEventType : std::uint8_t {
+    axisUpdate = 0,       // An axis position or status was updated
+    commandCompleted = 1, // A command submitted with EventChannel::completion() finished
+    monitorCycle = 2      // Every reply of one monitoring cycle has arrived
+};
+
+/**
+ * @struct ControllerEvent
+ * @brief One event delivered through an EventChannel. Fixed size, so it is queued without allocation.
+ */
+struct ControllerEvent {
+    ControllerEventType type = ControllerEventType::axisUpdate;
+    char status = '\0';          // commandCompleted: the reply status ('C', 'E', ...)
+    char command[6] = {};        // commandCompleted: the command mnemonic, NUL-terminated
+    int axisNo = -1;
+    std::int64_t timestampNs = 0; // Nanoseconds since the system clock epoch
+    int position = 0;            // axisUpdate
+    std::uint32_t statusWord = 0; // axisUpdate
+    std::uint64_t tag = 0;       // commandCompleted: the caller's tag; monitorCycle: the cycle number
+};
+
+/**
+ * @class EventChannel
+ * @brief Delivers axis updates, command completions and monitoring cycles to an external event loop.
+ *
+ * Events are pushed into a lock-free queue from whichever thread produces them
+ * and signalled through an eventfd, which the application adds to its own
+ * epoll (or poll/select) set. When the descriptor becomes readable, the
+ * application calls drain() on its own thread. No thread is added and nobody
+ * waits on a condition variable or spins.
+ *
+ * The descriptor is written only when it is not already signalled, so a burst
+ * of events costs one write() and one wakeup. When the queue is full, new
+ * events are dropped and counted (see dropped()); axis updates can be recovered
+ * from AxisState.
+ *
+ * The eventfd is Linux-only; construction throws std::system_error elsewhere.
+ */
+class EventChannel {
+public:
+    /**
+     * @brief Creates the eventfd and the queue.
+     * @param capacity The maximum number of undrained events.
+     * @throws std::system_error if the eventfd cannot be created.
+     */
+    explicit EventChannel(std::size_t capacity = 4096);
+
+    ~EventChannel();
+
+    EventChannel(const EventChannel&) = delete;
+    EventChannel& operator=(const EventChannel&) = delete;
+
+    /**
+     * @brief Returns the descriptor to poll for readability.
+     * @return The eventfd, non-blocking and close-on-exec.
+     */
+    int fd() const { return fd_; }
+
+    /**
+     * @brief Queues an event and signals the descriptor. Lock-free; callable from any thread.
+     * @param event The event.
+     * @return True if the event was queued, false if the queue was full.
+     */
+    bool publish(const ControllerEvent& event);
+
+    /**
+     * @brief Clears the descriptor and moves every queued event into the output vector.
+     *
+     * Never blocks. Call from the thread that polls fd().
+     * @param out The vector that receives the events (appended).
+     * @return The number of events moved.
+     */
+    std::size_t drain(std::vector<ControllerEvent>& out);
+
+    /**
+     * @brief Publishes an axisUpdate event for every sample of the given AxisState.
+     *
+     * The channel must outlive any further updates to the AxisState.
+     * @param axisState The state whose updates should be published.
+     */
+    void attach(AxisState& axisState);
+
+    /**
+     * @brief Returns a command callback that publishes a commandCompleted event.
+     * @param tag A caller-chosen value copied into the event.
+     * @return The callback, to pass to sendCommand(), moveAbsolute() and the like.
+     */
+    std::function<void(const ProtocolResponse&)> completion(std::uint64_t tag);
+
+    /**
+     * @brief Returns the number of events dropped because the queue was full.
+     * @return The dropped event count.
+     */
+    std::uint64_t dropped() const { return queue_.dropped(); }
+
+private:
+    LockFreeQueue<ControllerEvent> queue_;
+    std::atomic<bool> signalled_{false}; // The eventfd counter is non-zero
+    int fd_ = -1;
+};
+
+#endif // EVENT_CHANNEL_H
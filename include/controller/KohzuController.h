@@ -3,11 +3,17 @@
 
 #include "protocol/ProtocolHandler.h"
 #include "controller/AxisState.h"
+#include "controller/EventChannel.h"
+#include "common/RealtimeProfile.h"
 #include <memory>
 #include <thread>
 #include <atomic>
 #include <vector>
 #include <functional>
+#include <mutex>
+#include <condition_variable>
+
+class CycleArena;
 
 /**
  * @class KohzuController
@@ -25,16 +31,63 @@ public:
      */
     explicit KohzuController(std::shared_ptr<ProtocolHandler> protocolHandler, std::shared_ptr<AxisState> axisState);
 
+    /**
+     * @brief Constructs a KohzuController that keeps monitoring traffic off the command connection.
+     *
+     * Periodic RDP/STR polling and acquireInitialState() use the monitoring connection, so they
+     * are not blocked behind outstanding motion replies. Motion and system parameter commands
+     * (including RSY, so it stays ordered after WSY) use the command connection.
+     * @param commandHandler The ProtocolHandler of the connection used for motion and configuration commands.
+     * @param monitoringHandler The ProtocolHandler of the connection used for periodic reads.
+     * @param axisState A shared pointer to the AxisState instance for status management.
+     */
+    KohzuController(std::shared_ptr<ProtocolHandler> commandHandler, std::shared_ptr<ProtocolHandler> monitoringHandler,
+                    std::shared_ptr<AxisState> axisState);
+
+    /**
+     * @brief Destructor. Stops monitoring and detaches the controller's own reply callbacks.
+     *
+     * Replies that arrive later no longer reach the controller, but callers' callbacks
+     * still run. The handlers are left open, since other objects may share them; call
+     * shutdown() first to drain and close them. May be called from a reply callback.
+     */
     ~KohzuController();
 
     /**
-     * @brief Initializes the controller's communication by starting the protocol handler.
+     * @brief Initializes the controller's communication by starting the protocol handlers.
      */
     void start();
 
+    /**
+     * @brief Shuts the controller down in order within a deadline.
+     *
+     * Stops the monitoring thread, then shuts down the command and monitoring handlers:
+     * new commands are rejected, replies in flight are awaited until the deadline, the rest
+     * fail with an 'E' "shutdown" response and the connections are closed. The handlers are
+     * closed even if other objects share them. Later calls do nothing.
+     * @param deadline The total time allowed for replies in flight.
+     * @return The combined outcome for both connections.
+     */
+    ShutdownReport shutdown(std::chrono::milliseconds deadline);
+
+    /**
+     * @brief Returns the handler of the command connection.
+     * @return The command ProtocolHandler.
+     */
+    std::shared_ptr<ProtocolHandler> commandHandler() const { return protocolHandler_; }
+
+    /**
+     * @brief Returns the handler of the monitoring connection.
+     * @return The monitoring ProtocolHandler; the command handler if the controller uses one connection.
+     */
+    std::shared_ptr<ProtocolHandler> monitoringHandler() const { return monitoringHandler_; }
+
     /**
      * @brief Starts the background monitoring thread.
-     * @brief The thread will initially wait until axes are added for monitoring.
+     *
+     * The thread will initially wait until axes are added for monitoring. The positions and statuses
+     * read in one cycle reach AxisState together, in one AxisState::apply(), when the cycle's last reply arrives.
+     * Cycles do not overlap: a cycle whose replies are late delays the next one.
      * @param initial_axes_to_monitor A vector of axis numbers to monitor initially.
      * @param period_ms The monitoring period in milliseconds.
      */
@@ -45,6 +98,23 @@ public:
      */
     void stopMonitoring();
 
+    /**
+     * @brief Sets the real-time profile applied by the monitoring thread when it starts.
+     *
+     * Takes effect on the next startMonitoring() call.
+     * @param profile The shared profile, or nullptr to run with default settings.
+     */
+    void setRealtimeProfile(std::shared_ptr<RealtimeProfile> profile);
+
+    /**
+     * @brief Sets the latency split of the command and monitoring connections.
+     *
+     * See ProtocolHandler::setLatencySplit().
+     * @param outboundShare Fraction of the minimum round trip spent before the controller serves a request.
+     * @param windowSamples Number of samples after which the minimum round trip is re-measured.
+     */
+    void setLatencySplit(double outboundShare, std::size_t windowSamples = 1024);
+
     /**
      * @brief Adds a single axis to the monitoring list in a thread-safe manner.
      * @brief Wakes up the monitoring thread if it was waiting.
@@ -58,6 +128,21 @@ public:
      */
     void removeAxisToMonitor(int axisNo);
 
+    /**
+     * @brief Publishes axis updates and completed monitoring cycles to an event channel.
+     *
+     * Call once, before start(). Command completions are published by passing
+     * EventChannel::completion() as the command callback.
+     * @param channel The channel; kept alive by the controller.
+     */
+    void setEventChannel(std::shared_ptr<EventChannel> channel);
+
+    /**
+     * @brief Returns the number of monitoring cycles whose replies have all arrived.
+     * @return The completed cycle count.
+     */
+    std::uint64_t monitorCycles() const { return monitorCycles_.load(std::memory_order_relaxed); }
+
     /**
      * @brief Commands the specified axis to move to an absolute position.
      * @param axisNo The axis number to move.
@@ -65,9 +150,12 @@ public:
      * @param speed The movement speed. Defaults to 0 if not provided.
      * @param responseType The response type. Defaults to 0 if not provided.
      * @param callback A function to be called when the command completes.
+     * @param site Where the callback is registered, recorded by the CallbackProfiler.
+     * @return A handle that cancels the callback.
      */
-    void moveAbsolute(int axisNo, int position, int speed = 0, int responseType = 0,
-                      std::function<void(const ProtocolResponse&)> callback = nullptr);
+    CommandHandle moveAbsolute(int axisNo, int position, int speed = 0, int responseType = 0,
+                               std::function<void(const ProtocolResponse&)> callback = nullptr,
+                               CallSite site = CallSite::current());
 
     /**
      * @brief Commands the specified axis to move by a relative distance.
@@ -76,19 +164,28 @@ public:
      * @param speed The movement speed. Defaults to 0 if not provided.
      * @param responseType The response type. Defaults to 0 if not provided.
      * @param callback A function to be called when the command completes.
+     * @param site Where the callback is registered, recorded by the CallbackProfiler.
+     * @return A handle that cancels the callback.
      */
-    void moveRelative(int axisNo, int distance, int speed = 0, int responseType = 0,
-                      std::function<void(const ProtocolResponse&)> callback = nullptr);
+    CommandHandle moveRelative(int axisNo, int distance, int speed = 0, int responseType = 0,
+                               std::function<void(const ProtocolResponse&)> callback = nullptr,
+                               CallSite site = CallSite::current());
 
     /**
      * @brief Commands the specified axis to perform an origin return operation.
+     *
+     * The axis counts as not homed from now on; with responseType 0 it is marked homed
+     * in AxisState when the origin return completes (see AxisState::allHomed()).
      * @param axisNo The axis number to move.
      * @param speed The movement speed (0-9).
      * @param responseType The response type (e.g., 0 for completion response).
      * @param callback A function to be called when the command completes.
+     * @param site Where the callback is registered, recorded by the CallbackProfiler.
+     * @return A handle that cancels the callback.
      */
-    void moveOrigin(int axisNo, int speed = 0, int responseType = 0,
-                    std::function<void(const ProtocolResponse&)> callback = nullptr);
+    CommandHandle moveOrigin(int axisNo, int speed = 0, int responseType = 0,
+                             std::function<void(const ProtocolResponse&)> callback = nullptr,
+                             CallSite site = CallSite::current());
 
     /**
      * @brief Sets a system parameter value for a specified axis. (WSY command)
@@ -96,17 +193,115 @@ public:
      * @param systemNo The system parameter number.
      * @param value The value to set for the parameter.
      * @param callback A function to be called when the command completes.
+     * @param site Where the callback is registered, recorded by the CallbackProfiler.
+     * @return A handle that cancels the callback.
+     */
+    CommandHandle setSystem(int axisNo, int systemNo, int value,
+                            std::function<void(const ProtocolResponse&)> callback = nullptr,
+                            CallSite site = CallSite::current());
+
+    /**
+     * @brief Reads a system parameter value of a specified axis and caches it in AxisState. (RSY command)
+     * @param axisNo The axis number to query.
+     * @param systemNo The system parameter number.
+     * @param callback A function to be called when the command completes.
+     * @param site Where the callback is registered, recorded by the CallbackProfiler.
+     * @return A handle that cancels the callback.
      */
-    void setSystem(int axisNo, int systemNo, int value,
-                   std::function<void(const ProtocolResponse&)> callback = nullptr);
+    CommandHandle readSystem(int axisNo, int systemNo,
+                             std::function<void(const ProtocolResponse&)> callback = nullptr,
+                             CallSite site = CallSite::current());
+
+    /**
+     * @brief Reads position, status and the given system parameters of every axis in one pipelined burst.
+     *
+     * All results are written to AxisState; the callback runs once every reply has arrived.
+     * Positions and statuses are applied together just before the callback.
+     * @param axes The axis numbers to read.
+     * @param systemNos The system parameter numbers to read for each axis.
+     * @param callback Called with the number of replies that did not complete successfully.
+     */
+    void acquireInitialState(const std::vector<int>& axes, const std::vector<int>& systemNos,
+                             std::function<void(std::size_t failedReplies)> callback);
 
 private:
+    /**
+     * @struct CallbackGuard
+     * @brief Shared with the controller's own reply callbacks so they stop reaching it once it is destroyed.
+     */
+    struct CallbackGuard {
+        std::mutex mutex;   // Held while the controller's part of a callback runs
+        bool attached = true;
+        std::atomic<std::thread::id> runningThread{}; // Thread holding mutex, if any
+
+        /**
+         * @brief Runs the controller's part of a reply callback unless the controller was destroyed.
+         * @param work The code that uses the controller.
+         */
+        template <typename Work>
+        void run(Work&& work) {
+            if (runningThread.load() == std::this_thread::get_id()) {
+                // Nested in a callback of this thread that already holds the guard.
+                if (attached) {
+                    work();
+                }
+                return;
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            if (attached) {
+                runningThread.store(std::this_thread::get_id());
+                work();
+                runningThread.store(std::thread::id());
+            }
+        }
+
+        /**
+         * @brief Keeps later callbacks away from the controller, waiting for one running on another thread.
+         */
+        void detach();
+    };
+
+    /**
+     * @struct MonitorCycle
+     * @brief The polling cycle in flight, reused from one cycle to the next.
+     *
+     * Its reply callbacks capture only a pointer to it and the axis number, so they fit in
+     * std::function's small buffer. While replies are outstanding it holds a reference to
+     * itself, which the last reply drops, so it outlives a controller destroyed in the meantime.
+     */
+    struct MonitorCycle {
+        KohzuController* controller = nullptr;     // Reached only through guard
+        std::shared_ptr<CallbackGuard> guard;
+        std::shared_ptr<MonitorCycle> self;        // Set while replies are outstanding
+        std::atomic<std::size_t> remaining{0};
+        AxisUpdateBatch updates;
+        std::vector<CommandHandle> handles;        // Of the commands sent, withdrawn on destruction
+        std::mutex doneMutex;
+        std::condition_variable doneCv;
+        bool done = true;
+
+        void onReply(int axisNo, const ProtocolResponse& response, bool isStatus);
+        void finish();
+    };
+
+    static constexpr std::size_t kMonitorArenaBytes = 16 * 1024; ///< Scratch memory per polling cycle
+
     void monitorThreadFunction(int periodMs);
-    void readPosition(int axisNo);
-    void readStatus(int axisNo);
+    void completeMonitorCycle(const AxisUpdateBatch& updates);
+    bool handlePositionResponse(int axisNo, const ProtocolResponse& response, AxisUpdateBatch* updates = nullptr);
+    bool handleStatusResponse(int axisNo, const ProtocolResponse& response, AxisUpdateBatch* updates = nullptr);
+    bool handleSystemResponse(int axisNo, int systemNo, const ProtocolResponse& response);
     
-    std::shared_ptr<ProtocolHandler> protocolHandler_;
+    std::shared_ptr<ProtocolHandler> protocolHandler_;   // Command connection
+    std::shared_ptr<ProtocolHandler> monitoringHandler_; // Monitoring connection; same as protocolHandler_ if shared
     std::shared_ptr<AxisState> axisState_;
+    std::shared_ptr<RealtimeProfile> realtimeProfile_;
+    std::shared_ptr<EventChannel> eventChannel_;
+    std::atomic<std::uint64_t> monitorCycles_{0};
+    std::shared_ptr<CallbackGuard> callbackGuard_ = std::make_shared<CallbackGuard>();
+    std::shared_ptr<MonitorCycle> monitorCycle_ = std::make_shared<MonitorCycle>();
+    std::unique_ptr<CycleArena> initialStateArena_; // Reused by acquireInitialState() under initialStateMutex_
+    std::mutex initialStateMutex_;
 
     std::atomic<bool> isMonitoringRunning_{false};
     std::unique_ptr<std::thread> monitoringThread_;
@@ -0,0 +1,144 @@
+#ifndef PLANT_STARTUP_H
+#define PLANT_STARTUP_H
+
+#include "controller/KohzuController.h"
+#include "core/FailoverClient.h"
+#include "core/TcpClient.h"
+#include "protocol/ConnectionWatchdog.h"
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * @struct ControllerEndpoint
+ * @brief Address and axes of one controller in the plant.
+ */
+struct ControllerEndpoint {
+    std::string name;
+    std::string host;
+    std::string port;
+    std::vector<int> axes;
+    bool separateMonitoringConnection = false; // Open a second connection dedicated to monitoring reads
+    bool hotStandby = false;                   // Keep a standby for the command connection (see FailoverClient)
+    bool livenessWatchdog = false;             // Heartbeat idle links and reconnect dead ones (see ConnectionWatchdog)
+    double latencyOutboundShare = 0.5;         // Outbound share of the round trip (see ProtocolHandler::setLatencySplit())
+};
+
+/**
+ * @struct ControllerStartupResult
+ * @brief Outcome and per-phase timing of one controller's startup.
+ *
+ * All times are measured from the start of PlantStartup::run().
+ */
+struct ControllerStartupResult {
+    std::string name;
+    bool connected = false;
+    bool ready = false;              // Every initial reply arrived before the deadline
+    std::string error;
+    std::size_t failedReplies = 0;   // Initial replies that were not successful completions
+    double connectedMs = 0.0;
+    double readyMs = 0.0;
+};
+
+/**
+ * @struct StartupReport
+ * @brief Summary of a plant startup.
+ */
+struct StartupReport {
+    std::vector<ControllerStartupResult> controllers;
+    double connectPhaseMs = 0.0;     // Time until the last controller connected
+    double acquirePhaseMs = 0.0;     // Longest initial state acquisition after connecting
+    double timeToReadyMs = 0.0;      // Time until the last controller was ready (or the deadline)
+    bool allReady = false;
+
+    /**
+     * @brief Writes the report to the log.
+     */
+    void log() const;
+};
+
+/**
+ * @class PlantStartup
+ * @brief Brings up many controllers concurrently and acquires their initial state.
+ *
+ * All controllers are connected in parallel on the I/O context. As soon as a
+ * controller's connections are up, it is started and the initial RDP, STR and
+ * RSY reads for every axis are sent in a single pipelined burst. run() returns
+ * once every controller is ready or the deadline passes. An endpoint whose
+ * connections complete after that stays down: its connections are closed and
+ * its controller stays null, so controllers() is not modified once run() has
+ * returned. When one of an endpoint's two connections fails, the other one is
+ * closed as well.
+ *
+ * The I/O context must be run by at least one other thread while run() waits,
+ * and the PlantStartup object owns the created controllers, so it must outlive
+ * both their use and the I/O context's pending handlers.
+ */
+class PlantStartup {
+public:
+    /**
+     * @struct StartedController
+     * @brief The client stack created for one endpoint.
+     */
+    struct StartedController {
+        ControllerEndpoint endpoint;
+        std::shared_ptr<TcpClient> client;                      // Null if the endpoint uses a hot standby
+        std::shared_ptr<FailoverClient> failoverClient;         // Null unless the endpoint asks for a hot standby
+        std::shared_ptr<ProtocolHandler> protocolHandler;
+        std::shared_ptr<AxisState> axisState;
+        std::shared_ptr<KohzuController> controller; // Null if the connection failed
+        std::shared_ptr<TcpClient> monitoringClient;            // Null unless the endpoint asks for a separate connection
+        std::shared_ptr<ProtocolHandler> monitoringHandler;
+        std::shared_ptr<ConnectionWatchdog> watchdog;           // Null unless the endpoint asks for a liveness watchdog
+        std::shared_ptr<ConnectionWatchdog> monitoringWatchdog;
+    };
+
+    /**
+     * @brief Constructs a PlantStartup.
+     * @param ioContext The Boost.Asio I/O context used by all clients.
+     * @param endpoints The controllers to bring up.
+     * @param systemParameters System parameter numbers read for every axis during startup.
+     */
+    PlantStartup(boost::asio::io_context& ioContext, std::vector<ControllerEndpoint> endpoints,
+                 std::vector<int> systemParameters = {});
+
+    PlantStartup(const PlantStartup&) = delete;
+    PlantStartup& operator=(const PlantStartup&) = delete;
+
+    /**
+     * @brief Connects all controllers and acquires their initial state.
+     * @param timeout The deadline for the whole startup.
+     * @return The startup report. It is also logged.
+     * @throws std::logic_error if called more than once.
+     */
+    StartupReport run(std::chrono::milliseconds timeout = std::chrono::milliseconds(5000));
+
+    /**
+     * @brief Returns the controllers created by run(), in endpoint order.
+     * @return The started controllers.
+     */
+    std::vector<StartedController>& controllers() { return controllers_; }
+
+private:
+    double elapsedMs() const;
+    void onConnected(std::size_t index, const std::error_code& error);
+    void onReady(std::size_t index, std::size_t failedReplies);
+
+    boost::asio::io_context& ioContext_;
+    std::vector<int> systemParameters_;
+    std::vector<StartedController> controllers_;
+    std::vector<ControllerStartupResult> results_;
+    std::vector<std::size_t> pendingConnections_; // Connections per endpoint still being established
+    std::size_t finished_ = 0;
+    std::size_t starting_ = 0;   // Endpoints whose controller is being built by onConnected()
+    bool hasRun_ = false;
+    bool runFinished_ = false;   // run() has returned or is returning; later connections are closed
+    std::chrono::steady_clock::time_point startTime_;
+    std::mutex mutex_;
+    std::condition_variable finishedCv_;
+};
+
+#endif // PLANT_STARTUP_H
@@ -0,0 +1,223 @@
+#ifndef FAILOVER_CLIENT_H
+#define FAILOVER_CLIENT_H
+
+#include "ICommunicationClient.h"
+#include "TcpClient.h"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+/**
+ * @class FailoverClient
+ * @brief A communication client that keeps a hot-standby connection to the same controller.
+ *
+ * Two TCP connections are opened. The active one carries all traffic; the
+ * standby one is kept connected with its read loop running and is checked by
+ * a cheap heartbeat command. When the active connection fails, traffic moves
+ * to the standby at once, so failover costs one write instead of a reconnect:
+ *
+ * - Commands still waiting for a reply are tracked in write order. Read-only
+ *   commands (RDP, STR, RSY, IDN by default) are replayed on the new connection.
+ * - Other commands (motion, parameter writes) are never repeated, since the
+ *   controller may already have executed them. Their callbacks receive a
+ *   synthetic "E\t<command><axis>\tfailover" reply so replies stay matched.
+ *
+ * The failed connection is then reconnected in the background and becomes the
+ * new standby. The disconnect handler is only called when both are down; it
+ * is then responsible for failing the commands still waiting for a reply.
+ *
+ * Connection and read handling run on the I/O context; asyncWrite() may be
+ * called from any thread. The object must outlive the I/O context's pending
+ * handlers. Like TcpClient, the Asio timer lives in a private implementation.
+ */
+class FailoverClient : public ICommunicationClient {
+public:
+    /**
+     * @struct Config
+     * @brief Failover settings.
+     */
+    struct Config {
+        std::string standbyHost;            // Empty: same as the primary host
+        std::string standbyPort;            // Empty: same as the primary port
+        int heartbeatIntervalMs = 200;      // Standby heartbeat and reconnect check period
+        int heartbeatTimeoutMs = 600;       // Standby is dropped if a heartbeat is unanswered this long
+        int reconnectIntervalMs = 1000;     // Minimum time between reconnect attempts of a failed connection
+        std::string heartbeatCommand = "IDN";
+        std::vector<std::string> replayableCommands{"RDP", "STR", "RSY", "IDN"};
+    };
+
+    /**
+     * @brief Constructor for FailoverClient.
+     * @param ioContext The Boost.Asio I/O context.
+     * @param config The failover settings.
+     */
+    FailoverClient(boost::asio::io_context& ioContext, Config config);
+
+    /**
+     * @brief Constructor for FailoverClient with default settings.
+     * @param ioContext The Boost.Asio I/O context.
+     */
+    explicit FailoverClient(boost::asio::io_context& ioContext);
+
+    ~FailoverClient() override;
+
+    FailoverClient(const FailoverClient&) = delete;
+    FailoverClient& operator=(const FailoverClient&) = delete;
+
+    /**
+     * @brief Connects both connections.
+     *
+     * A standby that fails to connect is retried in the background.
+     * @param host The host address to connect to.
+     * @param port The port number to connect to.
+     * @throws ConnectionException if neither connection can be established.
+     */
+    void connect(const std::string& host, const std::string& port) override;
+
+    /**
+     * @brief Connects both connections without throwing.
+     * @param host The host address to connect to.
+     * @param port The port number to connect to.
+     * @param error Set to the failure reason if neither connection can be established, cleared otherwise.
+     */
+    void connect(const std::string& host, const std::string& port, std::error_code& error) override;
+
+    /**
+     * @brief Connects both connections asynchronously on the I/O context.
+     * @param host The host address to connect to.
+     * @param port The port number to connect to.
+     * @param handler Called on the I/O thread once one connection is up, or with an error once both attempts fail.
+     */
+    void asyncConnect(const std::string& host, const std::string& port,
+                      std::function<void(const std::error_code&)> handler);
+
+    /**
+     * @brief Writes data on the active connection and tracks the commands it contains.
+     * @param data One or more CR/LF terminated command lines.
+     */
+    void asyncWrite(const std::string& data) override;
+
+    /**
+     * @brief Sets the callback for lines received on the active connection.
+     *
+     * Both read loops start when their connection comes up; call this before writing.
+     * @param callback The callback function to be called when a line is received.
+     */
+    void asyncRead(std::function<void(const std::string&)> callback) override;
+
+    /**
+     * @brief Returns when the line currently being delivered to the read callback was received.
+     * @return The receive time reported by the delivering connection.
+     */
+    std::int64_t receiveTimestampNs() const override { return deliveringTimestampNs_; }
+
+    /**
+     * @brief Sets the function called when both connections are lost.
+     * @param handler Called on the I/O thread with the error that ended the last connection.
+     */
+    void setDisconnectHandler(std::function<void(const std::error_code&)> handler) override;
+
+    /**
+     * @brief Treats the active connection as lost, failing over to the standby.
+     * @param reason The reason reported for the loss.
+     */
+    void dropConnection(const std::error_code& reason) override;
+
+    /**
+     * @brief Requests kernel receive timestamps on both connections. Call before connecting.
+     * @param enable True to request kernel timestamps.
+     */
+    void setKernelTimestamps(bool enable);
+
+    /**
+     * @brief Closes both connections and stops the heartbeat.
+     */
+    void close() override;
+
+    /**
+     * @brief Returns the number of failovers so far.
+     * @return The failover count.
+     */
+    std::uint64_t failovers() const { return failovers_.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Returns how long the last failover took, from detecting the failure to replaying on the standby.
+     * @return The duration in microseconds, or 0 if no failover has happened.
+     */
+    std::int64_t lastFailoverUs() const { return lastFailoverUs_.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Returns whether a healthy standby connection is available.
+     * @return True if the standby is connected and its heartbeat is answered.
+     */
+    bool standbyReady() const;
+
+private:
+    /**
+     * @struct Link
+     * @brief One of the two connections.
+     */
+    struct Link {
+        std::shared_ptr<TcpClient> client;
+        std::string host;
+        std::string port;
+        bool connected = false;
+        bool connecting = false;
+        bool healthy = false;                // Last heartbeat was answered
+        bool heartbeatPending = false;
+        std::chrono::steady_clock::time_point heartbeatSentAt;
+        std::chrono::steady_clock::time_point lastAttempt;
+    };
+
+    /**
+     * @struct Outstanding
+     * @brief A command written on the active connection that has not been answered yet.
+     */
+    struct Outstanding {
+        std::string line;        // The command line including CR/LF
+        std::string responseKey; // "<command><axis>", as echoed in the reply
+        bool replayable = false;
+    };
+
+    void setEndpoints(const std::string& host, const std::string& port);
+    void startLink(std::size_t index);
+    void startConnect(std::size_t index);
+    void onLinkConnected(std::size_t index, const std::error_code& error);
+    void onLine(std::size_t index, const std::string& line);
+    void onLinkLost(std::size_t index, const std::error_code& error);
+    void failOutstanding(bool keepReplayable, std::vector<std::string>& synthetic);
+    void deliverSynthetic(std::vector<std::string> lines);
+    void scheduleHeartbeat();
+    void onHeartbeat();
+    bool isReplayable(std::string_view responseKey) const;
+
+    boost::asio::io_context& ioContext_;
+    Config config_;
+    std::array<Link, 2> links_;
+    std::size_t active_ = 0;
+    std::deque<Outstanding> outstanding_;
+    std::function<void(const std::string&)> readCallback_;
+    std::function<void(const std::error_code&)> disconnectHandler_;
+    std::function<void(const std::error_code&)> connectHandler_; // Pending asyncConnect() handler
+    std::size_t connectAttemptsLeft_ = 0;
+    struct Impl;
+    std::unique_ptr<Impl> impl_;           // The heartbeat timer
+    bool heartbeatScheduled_ = false;
+    std::string heartbeatLine_;             // Heartbeat command with CR/LF
+    std::string heartbeatKey_;              // Response key of the heartbeat reply
+    bool closed_ = false;
+    std::int64_t deliveringTimestampNs_ = 0;
+    std::atomic<std::uint64_t> failovers_{0};
+    std::atomic<std::int64_t> lastFailoverUs_{0};
+    mutable std::mutex mutex_; // Protects links_, active_, outstanding_ and the handlers
+};
+
+#endif // FAILOVER_CLIENT_H
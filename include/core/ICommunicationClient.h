@@ -2,7 +2,9 @@
 #define I_COMMUNICATION_CLIENT_H
 
 #include <string>
+#include <cstdint>
 #include <functional>
+#include <system_error>
 
 /**
  * @interface ICommunicationClient
@@ -22,6 +24,14 @@ public:
      */
     virtual void connect(const std::string& host, const std::string& port) = 0;
 
+    /**
+     * @brief Method to connect to the controller without throwing.
+     * @param host The host address to connect to.
+     * @param port The port number to connect to.
+     * @param error Set to the failure reason, cleared on success.
+     */
+    virtual void connect(const std::string& host, const std::string& port, std::error_code& error) = 0;
+
     /**
      * @brief Method to send data asynchronously.
      * @param data The string data to be sent.
@@ -33,6 +43,38 @@ public:
      * @param callback The callback function to be called upon completion of receiving.
      */
     virtual void asyncRead(std::function<void(const std::string&)> callback) = 0;
+
+    /**
+     * @brief Returns when the line currently being delivered to the read callback was received.
+     *
+     * Only meaningful from inside the read callback.
+     * @return The receive time in nanoseconds since the epoch, or 0 if the client does not record one.
+     */
+    virtual std::int64_t receiveTimestampNs() const { return 0; }
+
+    /**
+     * @brief Sets the function called when an established connection is lost.
+     *
+     * Clients that cannot detect a lost connection ignore the handler.
+     * @param handler Called with the error that ended the connection.
+     */
+    virtual void setDisconnectHandler(std::function<void(const std::error_code&)> handler) { (void)handler; }
+
+    /**
+     * @brief Tears down the current connection as if the peer had closed it.
+     *
+     * Called when the connection is known to be dead (e.g. by ConnectionWatchdog); the
+     * client then runs its usual recovery. The default implementation does nothing.
+     * @param reason The reason reported for the loss.
+     */
+    virtual void dropConnection(const std::error_code& reason) { (void)reason; }
+
+    /**
+     * @brief Closes the connection without reporting a disconnect.
+     *
+     * Pending operations are cancelled. The default implementation does nothing.
+     */
+    virtual void close() {}
 };
 
 #endif // I_COMMUNICATION_CLIENT_H
\ No newline at end of file
@@ -2,14 +2,30 @@
 #define TCP_CLIENT_H
 
 #include "ICommunicationClient.h"
-#include <boost/asio.hpp>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <system_error>
+
+// Forward declarations keep Boost.Asio out of every translation unit that includes this header.
+namespace boost {
+namespace asio {
+class io_context;
+} // namespace asio
+namespace system {
+class error_code;
+} // namespace system
+} // namespace boost
 
 /**
  * @class TcpClient
  * @brief Handles TCP client communication using Boost.Asio.
  *
  * This class provides asynchronous read and write capabilities over a TCP
- * connection, abstracting the low-level socket operations.
+ * connection, abstracting the low-level socket operations. The socket and the
+ * rest of the Asio state live in a private implementation, so this header only
+ * needs forward declarations of the Boost types.
  */
 class TcpClient : public ICommunicationClient {
 public:
@@ -21,6 +37,8 @@ public:
      */
     TcpClient(boost::asio::io_context& ioContext, const std::string& host, const std::string& port);
 
+    ~TcpClient() override;
+
     // Disable copy constructor and assignment operator
     TcpClient(const TcpClient&) = delete;
     TcpClient& operator=(const TcpClient&) = delete;
@@ -29,9 +47,27 @@ public:
      * @brief Connects to the specified host and port.
      * @param host The host address to connect to.
      * @param port The port number to connect to.
+     * @throws ConnectionException if the connection fails.
      */
     void connect(const std::string& host, const std::string& port) override;
 
+    /**
+     * @brief Connects to the specified host and port without throwing.
+     * @param host The host address to connect to.
+     * @param port The port number to connect to.
+     * @param error Set to the failure reason, cleared on success.
+     */
+    void connect(const std::string& host, const std::string& port, std::error_code& error) override;
+
+    /**
+     * @brief Resolves and connects asynchronously on the I/O context.
+     * @param host The host address to connect to.
+     * @param port The port number to connect to.
+     * @param handler Called on the I/O thread with the result of the connection attempt.
+     */
+    void asyncConnect(const std::string& host, const std::string& port,
+                      std::function<void(const std::error_code&)> handler);
+
     /**
      * @brief Asynchronously reads data from the socket.
      * @param callback The callback function to be called when data is received.
@@ -44,10 +80,74 @@ public:
      */
     void asyncWrite(const std::string& data) override;
 
+    /**
+     * @brief Requests kernel software receive timestamps (SO_TIMESTAMPING) for incoming data.
+     *
+     * Call before connecting. Where the option is unavailable the client logs a warning
+     * and keeps stamping lines in user space.
+     * @param enable True to request kernel timestamps.
+     */
+    void setKernelTimestamps(bool enable);
+
+    /**
+     * @brief Returns whether the socket is delivering kernel receive timestamps.
+     * @return True if SO_TIMESTAMPING was applied to the connected socket.
+     */
+    bool kernelTimestampsActive() const;
+
+    /**
+     * @brief Returns when the line currently being delivered to the read callback was received.
+     * @return The kernel receive time in nanoseconds since the epoch, or 0 if kernel timestamps are off.
+     */
+    std::int64_t receiveTimestampNs() const override;
+
+    /**
+     * @brief Sets the function called when an established connection is lost.
+     *
+     * Called at most once per connection, after a failed read or write.
+     * @param handler Called on the I/O thread with the error that ended the connection.
+     */
+    void setDisconnectHandler(std::function<void(const std::error_code&)> handler) override;
+
+    /**
+     * @brief Closes the connection and stops reconnecting, without reporting a disconnect.
+     *
+     * Pending reads, writes and reconnect attempts are cancelled. The socket is closed on the
+     * I/O thread; called from another thread, close() waits for that, unless no thread is
+     * running the I/O context. The client can be connected again afterwards.
+     */
+    void close() override;
+
+    /**
+     * @brief Enables automatic reconnection after the connection is lost.
+     *
+     * The client retries the last address until it succeeds, then resumes the read loop
+     * with the callback last passed to asyncRead().
+     * @param intervalMs The delay between reconnect attempts in milliseconds, or 0 to disable.
+     */
+    void setAutoReconnect(int intervalMs);
+
+    /**
+     * @brief Tears down the connection on the I/O thread and reports it through the disconnect handler.
+     *
+     * Used when the peer is known to be dead but the socket has not noticed (e.g. a half-open connection).
+     * @param reason The reason passed to the disconnect handler.
+     */
+    void dropConnection(const std::error_code& reason) override;
+
 private:
-    boost::asio::ip::tcp::socket socket_;
-    boost::asio::ip::tcp::resolver resolver_;
-    boost::asio::streambuf responseBuffer_; // Buffer to handle fragmented reads
+    void readLoop(std::function<void(const std::string&)> callback);
+    void scheduleReconnect();
+    void handleReadError(const boost::system::error_code& error);
+    void notifyDisconnect(const std::error_code& error);
+    void resetReadState();
+    void applySocketOptions();
+    void readWithTimestamps(std::function<void(const std::string&)> callback);
+    void receiveWithTimestamp(boost::system::error_code& error);
+    bool extractTimestampedLine();
+
+    struct Impl;
+    std::unique_ptr<Impl> impl_;
 };
 
 #endif // TCP_CLIENT_H
\ No newline at end of file
@@ -0,0 +1,174 @@
+#ifndef COMMAND_MAILBOX_H
+#define COMMAND_MAILBOX_H
+
+#include "protocol/ProtocolHandler.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+
+struct MailboxMapping;
+
+/**
+ * @enum MailboxResult
+ * @brief Outcome of a command submitted through the mailbox.
+ */
+enum class MailboxResult : std::uint32_t {
+    completed = 0,        // The controller replied; the reply is in MailboxCompletion::response
+    malformedCommand = 1, // The command line could not be parsed and was not sent
+    truncated = 2         // The controller replied but the reply did not fit in the slot
+};
+
+/**
+ * @struct MailboxCompletion
+ * @brief The reply delivered to a mailbox client.
+ */
+struct MailboxCompletion {
+    MailboxResult result = MailboxResult::completed;
+    std::string response; // The raw reply line, parseable with ProtocolHandler::parseResponse
+};
+
+/**
+ * @class CommandMailboxServer
+ * @brief Serves a shared-memory command mailbox on behalf of other local processes.
+ *
+ * The mailbox is a named shared-memory segment holding a fixed number of
+ * slots and two lock-free index rings: one of free slots and one of submitted
+ * slots. Clients claim a free slot, write an encoded command line into it and
+ * publish it, all without a system call. The server thread polls the submitted
+ * ring, forwards everything it finds over the controller connection in one
+ * pipelined write, and writes each reply back into its slot.
+ *
+ * The segment is created by the constructor (replacing a stale one of the same
+ * name) and removed by the destructor. A client that dies while holding a slot
+ * leaks that slot until the server is restarted.
+ */
+class CommandMailboxServer {
+public:
+    /**
+     * @struct Config
+     * @brief Mailbox settings.
+     */
+    struct Config {
+        std::uint32_t slotCount = 64;   // Concurrent outstanding commands; rounded up to a power of two
+        std::uint32_t slotBytes = 256;  // Maximum command and reply line length
+        int pollIntervalUs = 200;       // Server sleep when the mailbox is idle
+    };
+
+    /**
+     * @brief Creates the shared-memory segment.
+     * @param name The segment name shared with clients.
+     * @param protocolHandler The handler used to send the commands.
+     * @param config The mailbox settings.
+     * @throws boost::interprocess::interprocess_exception if the segment cannot be created.
+     */
+    CommandMailboxServer(const std::string& name, std::shared_ptr<ProtocolHandler> protocolHandler, Config config);
+
+    /**
+     * @brief Creates the shared-memory segment with default settings.
+     * @param name The segment name shared with clients.
+     * @param protocolHandler The handler used to send the commands.
+     */
+    CommandMailboxServer(const std::string& name, std::shared_ptr<ProtocolHandler> protocolHandler);
+
+    ~CommandMailboxServer();
+
+    CommandMailboxServer(const CommandMailboxServer&) = delete;
+    CommandMailboxServer& operator=(const CommandMailboxServer&) = delete;
+
+    /**
+     * @brief Starts the server thread.
+     */
+    void start();
+
+    /**
+     * @brief Stops the server thread. Replies still in flight are delivered when they arrive.
+     */
+    void stop();
+
+    /**
+     * @brief Returns the number of commands forwarded to the controller.
+     * @return The forwarded command count.
+     */
+    std::uint64_t forwardedCommands() const { return forwarded_.load(std::memory_order_relaxed); }
+
+private:
+    void serverThreadFunction();
+
+    std::string name_;
+    std::shared_ptr<ProtocolHandler> protocolHandler_;
+    Config config_;
+    std::shared_ptr<MailboxMapping> mapping_; // Shared with reply callbacks so the mapping outlives them
+    std::atomic<bool> isRunning_{false};
+    std::atomic<std::uint64_t> forwarded_{0};
+    std::thread serverThread_;
+};
+
+/**
+ * @class CommandMailboxClient
+ * @brief Submits commands through a mailbox served by another process.
+ *
+ * submit() and poll() only touch shared memory. wait() spins briefly and then
+ * yields, so it costs no system calls while the reply is close.
+ * One client object may be used from several threads.
+ */
+class CommandMailboxClient {
+public:
+    /**
+     * @brief Opens an existing mailbox.
+     * @param name The segment name used by the server.
+     * @throws boost::interprocess::interprocess_exception if the segment does not exist.
+     * @throws std::runtime_error if the segment is not a compatible mailbox.
+     */
+    explicit CommandMailboxClient(const std::string& name);
+
+    ~CommandMailboxClient();
+
+    CommandMailboxClient(const CommandMailboxClient&) = delete;
+    CommandMailboxClient& operator=(const CommandMailboxClient&) = delete;
+
+    /**
+     * @brief Submits an encoded command line (e.g. "APS1/0/1000/0", without CR/LF).
+     * @param command The command line.
+     * @param ticket Receives the ticket used to collect the reply.
+     * @return False if the mailbox is full or the command does not fit in a slot.
+     */
+    bool submit(std::string_view command, std::uint32_t& ticket);
+
+    /**
+     * @brief Collects the reply for a ticket if it has arrived.
+     *
+     * On success the ticket is consumed and must not be used again.
+     * @param ticket The ticket returned by submit().
+     * @param completion Receives the reply.
+     * @return True if the reply was collected.
+     */
+    bool poll(std::uint32_t ticket, MailboxCompletion& completion);
+
+    /**
+     * @brief Waits for the reply for a ticket.
+     * @param ticket The ticket returned by submit().
+     * @param completion Receives the reply.
+     * @param timeout The maximum time to wait.
+     * @return True if the reply was collected, false on timeout (the ticket stays valid).
+     */
+    bool wait(std::uint32_t ticket, MailboxCompletion& completion, std::chrono::milliseconds timeout);
+
+    /**
+     * @brief Gives up on a ticket whose reply will not be collected.
+     *
+     * The slot returns to the mailbox as soon as the reply arrives (or at once if
+     * it already has), so a client that exits early does not leak slots.
+     * The ticket must not be used again.
+     * @param ticket The ticket returned by submit().
+     */
+    void release(std::uint32_t ticket);
+
+private:
+    std::shared_ptr<MailboxMapping> mapping_;
+};
+
+#endif // COMMAND_MAILBOX_H
@@ -0,0 +1,221 @@
+#ifndef BASIC_PROTOCOL_HANDLER_H
+#define BASIC_PROTOCOL_HANDLER_H
+
+#include "protocol/CommandFormat.h"
+#include "protocol/LatencyEstimator.h"
+#include "protocol/ProtocolHandler.h"
+#include "spdlog/spdlog.h"
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <initializer_list>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+/**
+ * @class BasicProtocolHandler
+ * @brief A ProtocolHandler whose transport and completion types are fixed at compile time.
+ *
+ * ProtocolHandler reaches its client through the virtual ICommunicationClient
+ * interface and stores every callback in a std::function. This template calls
+ * the transport and the completions directly, so the compiler can inline the
+ * send path and the read-parse-dispatch path (only the response parser stays
+ * an ordinary out-of-line call). Use it when the transport and the callback
+ * type are known up front, and ProtocolHandler when they are chosen at run time.
+ *
+ * Requirements:
+ * - Transport has void asyncWrite(const std::string& data). Received lines are
+ *   passed to handleRead(), either by the transport's own read loop or by
+ *   initialize() if the transport has asyncRead(callback) like TcpClient.
+ * - Completion is movable and callable as completion(const ProtocolResponse&).
+ *
+ * Replies are matched to commands per response key in send order, as in
+ * ProtocolHandler. Cancellation, shutdown, callback profiling and the
+ * watchdog counters are not provided.
+ *
+ * @tparam Transport The transport type.
+ * @tparam Completion The completion type.
+ */
+template <typename Transport, typename Completion>
+class BasicProtocolHandler {
+public:
+    using transport_type = Transport;
+    using completion_type = Completion;
+
+    /**
+     * @brief Constructs a handler on the given transport.
+     * @param transport The transport. Must outlive the handler.
+     */
+    explicit BasicProtocolHandler(Transport& transport) : transport_(transport) {}
+
+    BasicProtocolHandler(const BasicProtocolHandler&) = delete;
+    BasicProtocolHandler& operator=(const BasicProtocolHandler&) = delete;
+
+    /**
+     * @brief Routes the lines received by a transport with an asyncRead(callback) member to handleRead().
+     *
+     * Not needed when the transport's read loop calls handleRead() itself.
+     */
+    void initialize() {
+        transport_.asyncRead([this](const std::string& line) { handleRead(line); });
+    }
+
+    /**
+     * @brief Sends a command with integer parameters, formatted without temporary strings.
+     * @param baseCommand The command string (e.g., "APS", "RDP").
+     * @param axisNo The axis number, or -1 if the command takes none.
+     * @param params The integer parameters.
+     * @param completion Called with the response.
+     */
+    void sendCommand(std::string_view baseCommand, int axisNo, std::initializer_list<int> params, Completion completion) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        writeBuffer_.clear();
+        appendCommand(writeBuffer_, baseCommand, axisNo, params);
+        enqueue(baseCommand, axisNo, std::move(completion));
+    }
+
+    /**
+     * @brief Sends a command with string parameters.
+     * @param baseCommand The command string (e.g., "APS", "RDP").
+     * @param axisNo The axis number, or -1 if the command takes none.
+     * @param params A vector of string parameters.
+     * @param completion Called with the response.
+     */
+    void sendCommand(std::string_view baseCommand, int axisNo, const std::vector<std::string>& params, Completion completion) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        writeBuffer_.clear();
+        appendCommand(writeBuffer_, baseCommand, axisNo, params);
+        enqueue(baseCommand, axisNo, std::move(completion));
+    }
+
+    /**
+     * @brief Parses one received line and runs the completion of the command it answers.
+     *
+     * Called by the transport's read loop; the completion runs without the lock held.
+     * @param line The received line.
+     */
+    void handleRead(const std::string& line) {
+        const std::int64_t receivedNs = wallClockNs();
+        std::error_code error;
+        ProtocolResponse& response = scratchResponse_;
+        ProtocolHandler::parseResponse(line, response, error);
+        if (error) {
+            spdlog::error("Protocol error: {}", error.message());
+            return;
+        }
+        std::optional<Completion> completion;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            readKey_.clear();
+            appendResponseKey(readKey_, response.command, response.axisNo);
+            PendingQueue* queue = findQueue(readKey_);
+            if (queue && !queue->entries.empty()) {
+                Pending& pending = queue->entries.front();
+                response.sentNs = pending.sentNs;
+                response.receivedNs = receivedNs;
+                response.sampleNs = latencyEstimator_.estimate(pending.sentNs, receivedNs);
+                completion.emplace(std::move(pending.completion));
+                queue->entries.pop_front();
+                --pendingCommands_;
+            }
+        }
+        if (!completion) {
+            spdlog::warn("No matching command found for response: {}", line);
+            return;
+        }
+        (*completion)(response);
+    }
+
+    /**
+     * @brief Returns the number of commands waiting for a reply.
+     * @return The pending command count.
+     */
+    std::size_t pendingCommands() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return pendingCommands_;
+    }
+
+    /**
+     * @brief Returns the request latency estimate of this connection.
+     * @return The latency snapshot.
+     */
+    LatencySnapshot latency() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return latencyEstimator_.snapshot();
+    }
+
+    /**
+     * @brief Sets how the minimum round trip is split into an outbound and an inbound leg.
+     *
+     * Restarts the estimate of this connection (see ProtocolHandler::setLatencySplit()).
+     * @param outboundShare Fraction of the minimum round trip spent before the controller serves a request.
+     * @param windowSamples Number of samples after which the minimum round trip is re-measured.
+     */
+    void setLatencySplit(double outboundShare, std::size_t windowSamples = 1024) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        latencyEstimator_ = LatencyEstimator(outboundShare, windowSamples);
+    }
+
+    /**
+     * @brief Returns the transport.
+     * @return The transport.
+     */
+    Transport& transport() { return transport_; }
+
+private:
+    struct Pending {
+        std::int64_t sentNs = 0;
+        Completion completion;
+    };
+
+    struct PendingQueue {
+        std::string key;
+        std::deque<Pending> entries;
+    };
+
+    /**
+     * @brief Queues the completion of the command in writeBuffer_ and writes it. Called with mutex_ held.
+     */
+    void enqueue(std::string_view baseCommand, int axisNo, Completion completion) {
+        sendKey_.clear();
+        appendResponseKey(sendKey_, baseCommand, axisNo);
+        PendingQueue* queue = findQueue(sendKey_);
+        if (!queue) {
+            // Queues are kept once created: the set of keys is small.
+            queue = &queues_.emplace_back(PendingQueue{sendKey_, {}});
+        }
+        queue->entries.push_back(Pending{wallClockNs(), std::move(completion)});
+        ++pendingCommands_;
+        spdlog::debug("Sending command: {}", writeBuffer_);
+        transport_.asyncWrite(writeBuffer_);
+    }
+
+    /**
+     * @brief Returns the queue of a response key, or nullptr. A linear scan beats a map for a handful of keys.
+     */
+    PendingQueue* findQueue(std::string_view key) {
+        for (PendingQueue& queue : queues_) {
+            if (queue.key == key) {
+                return &queue;
+            }
+        }
+        return nullptr;
+    }
+
+    Transport& transport_;
+    std::deque<PendingQueue> queues_; // A deque keeps queue addresses stable as keys are added
+    std::size_t pendingCommands_ = 0;
+    std::string writeBuffer_;
+    std::string sendKey_;
+    std::string readKey_;
+    ProtocolResponse scratchResponse_; // Reused by handleRead on the read thread
+    LatencyEstimator latencyEstimator_;
+    std::mutex mutex_; // Protects the queues, the send buffers and latencyEstimator_
+};
+
+#endif // BASIC_PROTOCOL_HANDLER_H
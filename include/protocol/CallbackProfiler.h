@@ -0,0 +1,170 @@
+#ifndef CALLBACK_PROFILER_H
+#define CALLBACK_PROFILER_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+/**
+ * @struct CallSite
+ * @brief The source location that registered a callback.
+ *
+ * Used as a defaulted last parameter (CallSite site = CallSite::current()), so
+ * the location of the caller is recorded without changing call sites. The
+ * strings are literals and live for the whole program.
+ */
+struct CallSite {
+    const char* file = "";
+    const char* function = "";
+    int line = 0;
+
+    /**
+     * @brief Returns the location of the expression that evaluates the default argument.
+     * @return The caller's location.
+     */
+    static constexpr CallSite current(const char* file = __builtin_FILE(), const char* function = __builtin_FUNCTION(),
+                                      int line = __builtin_LINE()) {
+        return CallSite{file, function, line};
+    }
+
+    /**
+     * @brief Returns the file name without its directory.
+     * @return The base name of file.
+     */
+    std::string_view fileName() const;
+};
+
+/**
+ * @struct CallbackSiteStats
+ * @brief Timing of every callback registered at one call site.
+ *
+ * histogram[0] counts calls under 1 us; histogram[i] counts calls in
+ * [2^(i-1), 2^i) us. The last bucket also holds everything longer.
+ */
+struct CallbackSiteStats {
+    static constexpr std::size_t kBuckets = 20;
+
+    CallSite site;
+    std::uint64_t calls = 0;
+    std::uint64_t slowCalls = 0;  // Calls over the budget
+    std::int64_t totalNs = 0;
+    std::int64_t maxNs = 0;
+    std::array<std::uint64_t, kBuckets> histogram{};
+
+    /**
+     * @brief Returns the mean callback duration.
+     * @return The mean duration in nanoseconds.
+     */
+    double meanNs() const { return calls > 0 ? static_cast<double>(totalNs) / calls : 0.0; }
+
+    /**
+     * @brief Returns an upper bound of the given quantile of the callback duration.
+     * @param quantile The quantile, between 0 and 1.
+     * @return The upper edge of the histogram bucket holding the quantile, in microseconds.
+     */
+    std::int64_t quantileUs(double quantile) const;
+};
+
+/**
+ * @struct SlowCallback
+ * @brief One callback that ran longer than the budget.
+ */
+struct SlowCallback {
+    CallSite site;
+    std::string command;
+    int axisNo = -1;
+    std::int64_t durationNs = 0;
+};
+
+/**
+ * @class CallbackProfiler
+ * @brief Times reply callbacks and attributes them to the code that registered them.
+ *
+ * Callbacks run on the I/O thread, so one slow callback delays every reply
+ * behind it, on every controller served by that thread. ProtocolHandler
+ * records the duration of every callback it runs here. Durations are kept in
+ * a log2 histogram per registration site, and callbacks over the budget are
+ * reported with their command, axis and site: logged as a warning, or passed
+ * to the slow-callback handler if one is set.
+ *
+ * Several handlers may share one profiler (see ProtocolHandler::setCallbackProfiler()).
+ * Recording takes a short lock and does not allocate once a site has been seen.
+ */
+class CallbackProfiler {
+public:
+    /**
+     * @brief Constructs a profiler with the given budget.
+     * @param budget Callbacks running longer than this are reported.
+     */
+    explicit CallbackProfiler(std::chrono::microseconds budget = std::chrono::microseconds(1000));
+
+    /**
+     * @brief Changes the budget.
+     * @param budget Callbacks running longer than this are reported.
+     */
+    void setBudget(std::chrono::microseconds budget);
+
+    /**
+     * @brief Returns the budget.
+     * @return The budget.
+     */
+    std::chrono::microseconds budget() const;
+
+    /**
+     * @brief Sets a function called, instead of logging, for every callback over the budget.
+     *
+     * Runs on the thread that ran the callback; keep it short.
+     * @param handler The handler, or nullptr to log again.
+     */
+    void setSlowCallbackHandler(std::function<void(const SlowCallback&)> handler);
+
+    /**
+     * @brief Records one callback invocation.
+     * @param site Where the callback was registered.
+     * @param command The command the callback answered.
+     * @param axisNo The axis of the command, or -1.
+     * @param durationNs How long the callback ran.
+     */
+    void record(const CallSite& site, std::string_view command, int axisNo, std::int64_t durationNs);
+
+    /**
+     * @brief Returns the statistics of every call site, slowest maximum first.
+     * @return The per-site statistics.
+     */
+    std::vector<CallbackSiteStats> snapshot() const;
+
+    /**
+     * @brief Returns the number of callbacks over the budget so far.
+     * @return The slow callback count.
+     */
+    std::uint64_t slowCallbacks() const { return slowCallbacks_.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Clears the statistics of every call site.
+     */
+    void reset();
+
+private:
+    struct SiteKey {
+        std::string_view file;
+        int line = 0;
+
+        bool operator<(const SiteKey& other) const { return std::tie(line, file) < std::tie(other.line, other.file); }
+    };
+
+    std::atomic<std::int64_t> budgetNs_;
+    std::atomic<std::uint64_t> slowCallbacks_{0};
+    std::function<void(const SlowCallback&)> slowCallbackHandler_;
+    std::map<SiteKey, CallbackSiteStats> sites_;
+    mutable std::mutex mutex_; // Protects sites_ and slowCallbackHandler_
+};
+
+#endif // CALLBACK_PROFILER_H
@@ -0,0 +1,75 @@
+#ifndef COMMAND_FORMAT_H
+#define COMMAND_FORMAT_H
+
+#include <charconv>
+#include <initializer_list>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief Appends the response key of a command ("<command><axis>") to a string.
+ * @param out The string to append to.
+ * @param baseCommand The command string.
+ * @param axisNo The axis number, or -1 if the command takes none.
+ */
+template <typename String>
+void appendResponseKey(String& out, std::string_view baseCommand, int axisNo) {
+    out.append(baseCommand.data(), baseCommand.size());
+    if (axisNo != -1) {
+        char digits[16];
+        auto result = std::to_chars(digits, digits + sizeof(digits), axisNo);
+        out.append(digits, result.ptr);
+    }
+}
+
+/**
+ * @brief Appends a command line formatted according to the protocol to a string.
+ * @param out The string to append to.
+ * @param baseCommand The command string.
+ * @param axisNo The axis number, or -1 if the command takes none.
+ * @param params A vector of string parameters.
+ */
+template <typename String>
+void appendCommand(String& out, std::string_view baseCommand, int axisNo, const std::vector<std::string>& params) {
+    appendResponseKey(out, baseCommand, axisNo);
+
+    if (!params.empty()) {
+        if (axisNo != -1) {
+            out += '/';
+        }
+        for (size_t i = 0; i < params.size(); ++i) {
+            out.append(params[i].data(), params[i].size());
+            if (i < params.size() - 1) {
+                out += '/';
+            }
+        }
+    }
+    out += "\r\n";
+}
+
+/**
+ * @brief Appends a command line with integer parameters, formatting them in place.
+ * @param out The string to append to.
+ * @param baseCommand The command string.
+ * @param axisNo The axis number, or -1 if the command takes none.
+ * @param params The integer parameters.
+ */
+template <typename String>
+void appendCommand(String& out, std::string_view baseCommand, int axisNo, std::initializer_list<int> params) {
+    appendResponseKey(out, baseCommand, axisNo);
+
+    bool first = true;
+    for (int param : params) {
+        if (!first || axisNo != -1) {
+            out += '/';
+        }
+        first = false;
+        char digits[16];
+        auto result = std::to_chars(digits, digits + sizeof(digits), param);
+        out.append(digits, result.ptr);
+    }
+    out += "\r\n";
+}
+
+#endif // COMMAND_FORMAT_H
@@ -0,0 +1,206 @@
+#ifndef COMMAND_JOURNAL_H
+#define COMMAND_JOURNAL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+struct JournalSegment;
+
+/**
+ * @enum JournalRecordType
+ * @brief Kind of a journal record.
+ */
+enum class JournalRecordType : std::uint8_t {
+    submitted = 1, // A command was handed to the connection; text is the command line
+    completed = 2  // A command finished; reference is its submitted record, text the reply or failure reason
+};
+
+/**
+ * @struct JournalEntry
+ * @brief One record read back from a journal segment.
+ */
+struct JournalEntry {
+    std::uint64_t sequence = 0;
+    std::int64_t timestampNs = 0; // Nanoseconds since the system clock epoch
+    JournalRecordType type = JournalRecordType::submitted;
+    std::uint64_t reference = 0;  // completed: sequence of the submitted record
+    int axisNo = -1;
+    char status = 0;              // completed: the reply status ('C', 'E', ...)
+    std::string text;             // Truncated to CommandJournal::kTextBytes
+};
+
+/**
+ * @class CommandJournal
+ * @brief Append-only binary journal of submitted commands and their outcomes.
+ *
+ * Records are fixed-size and written in place into a preallocated,
+ * memory-mapped segment file, so appending is a short critical section and a
+ * 64-byte copy with no system call. Each record gets the next sequence number,
+ * which is stored last: a reader stops at the first record whose sequence is 0,
+ * so a record torn by a crash is never read. Full segments roll over to a new
+ * file named after its first sequence number, and sequence numbers continue
+ * across restarts.
+ *
+ * A background thread creates, maps and prefaults the next segment while the
+ * current one fills, so a roll-over only swaps in the prepared segment. Only if
+ * that segment is not ready yet does an append open one itself.
+ *
+ * Without syncing, written records survive a crash of the process (the kernel
+ * owns the mapped pages) but not of the machine. With a sync interval, the
+ * background thread flushes everything written since the previous flush in one
+ * msync, so the cost of durability is shared by all records of the interval.
+ */
+class CommandJournal {
+public:
+    static constexpr std::size_t kTextBytes = 32; ///< Command line or reply bytes kept per record
+
+    /**
+     * @struct Config
+     * @brief Journal settings.
+     */
+    struct Config {
+        std::string directory;                      // Directory receiving the segment files
+        std::uint64_t segmentBytes = 16ull << 20;   // Preallocated size of each segment file
+        int syncIntervalMs = 0;                     // Group-commit period; 0 leaves write-back to the kernel
+        std::vector<std::string> excludedCommands{"RDP", "STR", "IDN"}; // Polling reads that are not journalled
+    };
+
+    /**
+     * @brief Constructs a CommandJournal.
+     * @param config The journal settings.
+     */
+    explicit CommandJournal(Config config);
+
+    /**
+     * @brief Destructor. Stops the journal, syncing the current segment.
+     */
+    ~CommandJournal();
+
+    CommandJournal(const CommandJournal&) = delete;
+    CommandJournal& operator=(const CommandJournal&) = delete;
+
+    /**
+     * @brief Creates the directory, opens a new segment and starts the background thread.
+     *
+     * Sequence numbers continue after the last record found in the directory.
+     * Empty segments left by a previous run are removed; other existing segment
+     * files are never overwritten.
+     * @throws std::runtime_error or boost::interprocess::interprocess_exception if the segment cannot be created.
+     */
+    void start();
+
+    /**
+     * @brief Joins the background thread, then syncs and closes the current segment. Later appends are ignored.
+     */
+    void stop();
+
+    /**
+     * @brief Checks whether commands with the given response key or mnemonic are journalled.
+     * @param command The command mnemonic, optionally followed by the axis number (e.g. "APS1").
+     * @return False for the excluded commands.
+     */
+    bool journals(std::string_view command) const;
+
+    /**
+     * @brief Appends a submitted record.
+     * @param commandLine The command line as written, without CR/LF.
+     * @param axisNo The axis number, or -1.
+     * @return The record's sequence number, or 0 if the journal is not running.
+     */
+    std::uint64_t recordSubmitted(std::string_view commandLine, int axisNo);
+
+    /**
+     * @brief Appends a completed record.
+     * @param reference The sequence number of the command's submitted record.
+     * @param axisNo The axis number, or -1.
+     * @param status The reply status ('C', 'E', ...).
+     * @param detail The reply line or failure reason.
+     * @return The record's sequence number, or 0 if the journal is not running.
+     */
+    std::uint64_t recordCompleted(std::uint64_t reference, int axisNo, char status, std::string_view detail);
+
+    /**
+     * @brief Flushes every record written so far to disk and waits for it.
+     */
+    void sync();
+
+    /**
+     * @brief Returns the sequence number of the last record appended.
+     * @return The sequence number, 0 if none.
+     */
+    std::uint64_t lastSequence() const { return lastSequence_.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Returns the sequence number up to which records are known to be on disk.
+     * @return The sequence number, 0 if none.
+     */
+    std::uint64_t syncedSequence() const { return syncedSequence_.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Returns the number of records lost because no segment could be opened.
+     * @return The dropped record count.
+     */
+    std::uint64_t droppedRecords() const { return droppedRecords_.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Builds the file name of the segment whose first record has the given sequence number.
+     *
+     * Names sort in sequence order.
+     * @param firstSequence The sequence number of the segment's first record.
+     * @return The segment file name (without directory).
+     */
+    static std::string segmentFileName(std::uint64_t firstSequence);
+
+    /**
+     * @brief Reads the complete records of a segment file.
+     * @param path The segment file path.
+     * @return The records in sequence order, up to the first unwritten or torn one.
+     * @throws std::runtime_error if the file is not a journal segment.
+     */
+    static std::vector<JournalEntry> readSegment(const std::string& path);
+
+private:
+    /**
+     * @struct PendingFlush
+     * @brief Records of a rolled-over segment still to be flushed.
+     */
+    struct PendingFlush {
+        std::shared_ptr<JournalSegment> segment;
+        std::size_t begin = 0;
+        std::size_t end = 0;
+    };
+
+    std::uint64_t append(JournalRecordType type, std::uint64_t reference, int axisNo, char status, std::string_view text);
+    std::shared_ptr<JournalSegment> createSegment(std::uint64_t firstSequence) const;
+    void openSegment();
+    void discardSpare();
+    void workerThreadFunction();
+
+    Config config_;
+    std::shared_ptr<JournalSegment> segment_; // Shared with sync() so a roll-over cannot unmap a segment being flushed
+    std::shared_ptr<JournalSegment> spare_;   // Prepared segment that follows segment_, if ready
+    std::vector<PendingFlush> retired_;       // Rolled-over segments with records not yet flushed
+    std::size_t nextIndex_ = 0;               // Next free record of segment_
+    std::size_t syncedIndex_ = 0;             // Records of segment_ already flushed
+    std::uint64_t nextSequence_ = 1;
+    bool spareWanted_ = false;                // Asks the background thread to prepare spare_
+    bool preparing_ = false;                  // The background thread is creating spare_
+    std::atomic<std::uint64_t> lastSequence_{0};
+    std::atomic<std::uint64_t> syncedSequence_{0};
+    std::atomic<std::uint64_t> droppedRecords_{0};
+    std::atomic<bool> isRunning_{false};
+    std::unique_ptr<std::thread> workerThread_;
+    std::mutex mutex_;       // Protects the segments, the indexes, nextSequence_ and the flags
+    std::mutex syncMutex_;   // Serializes flushes
+    std::condition_variable workerCv_;
+    std::condition_variable spareCv_; // Signalled when preparing_ clears
+};
+
+#endif // COMMAND_JOURNAL_H
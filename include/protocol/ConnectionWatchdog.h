@@ -0,0 +1,123 @@
+#ifndef CONNECTION_WATCHDOG_H
+#define CONNECTION_WATCHDOG_H
+
+#include "core/ICommunicationClient.h"
+#include "protocol/ProtocolHandler.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+/**
+ * @class ConnectionWatchdog
+ * @brief Detects dead or stalled connections and hands them to the client's recovery logic.
+ *
+ * A half-open TCP connection accepts writes and never answers, so it looks
+ * healthy until commands time out. The watchdog samples the handler's
+ * ConnectionActivity from its own thread:
+ *
+ * - When the link has carried no traffic for idleHeartbeatMs, it sends one
+ *   heartbeat command, so an idle link is still probed.
+ * - When commands are waiting and no line has arrived for responseTimeoutMs,
+ *   it sends a heartbeat as a probe, since a long move sent with responseType 0
+ *   legitimately stays silent until it ends.
+ * - When the heartbeat, too, goes unanswered for responseTimeoutMs, the link
+ *   (or the read loop) has stopped making progress. The watchdog calls
+ *   ICommunicationClient::dropConnection(), which makes TcpClient fail the
+ *   waiting commands and reconnect (see TcpClient::setAutoReconnect) and makes
+ *   FailoverClient switch to its standby.
+ *
+ * A dead link is therefore detected within idleHeartbeatMs + responseTimeoutMs
+ * + checkIntervalMs when idle, and within twice responseTimeoutMs +
+ * checkIntervalMs with commands waiting. Because the checks run on their own
+ * thread, a stuck I/O thread is detected as well.
+ */
+class ConnectionWatchdog {
+public:
+    /**
+     * @struct Config
+     * @brief Watchdog settings.
+     */
+    struct Config {
+        int idleHeartbeatMs = 1000;    // Send a heartbeat after this long without traffic
+        int responseTimeoutMs = 2000;  // Declare the link dead after this long without progress
+        int checkIntervalMs = 100;     // How often the activity counters are sampled
+        std::string heartbeatCommand = "IDN";
+    };
+
+    /**
+     * @brief Constructs a watchdog for one connection.
+     * @param protocolHandler The handler whose activity is watched and which sends the heartbeat.
+     * @param client The client of that handler, told to drop the connection when it is dead.
+     * @param config The watchdog settings.
+     */
+    ConnectionWatchdog(std::shared_ptr<ProtocolHandler> protocolHandler, std::shared_ptr<ICommunicationClient> client,
+                       Config config);
+
+    /**
+     * @brief Constructs a watchdog for one connection with default settings.
+     * @param protocolHandler The handler whose activity is watched and which sends the heartbeat.
+     * @param client The client of that handler, told to drop the connection when it is dead.
+     */
+    ConnectionWatchdog(std::shared_ptr<ProtocolHandler> protocolHandler, std::shared_ptr<ICommunicationClient> client);
+
+    ~ConnectionWatchdog();
+
+    ConnectionWatchdog(const ConnectionWatchdog&) = delete;
+    ConnectionWatchdog& operator=(const ConnectionWatchdog&) = delete;
+
+    /**
+     * @brief Starts the watchdog thread.
+     */
+    void start();
+
+    /**
+     * @brief Stops the watchdog thread.
+     */
+    void stop();
+
+    /**
+     * @brief Sets a function called on the watchdog thread when a dead link is detected.
+     *
+     * Call before start().
+     * @param handler Called with a short description of the failure.
+     */
+    void setDeadLinkHandler(std::function<void(const std::string&)> handler) { deadLinkHandler_ = std::move(handler); }
+
+    /**
+     * @brief Returns the number of heartbeats sent.
+     * @return The heartbeat count.
+     */
+    std::uint64_t heartbeatsSent() const { return heartbeatsSent_.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Returns the number of times the link was declared dead.
+     * @return The dead link count.
+     */
+    std::uint64_t deadLinks() const { return deadLinks_.load(std::memory_order_relaxed); }
+
+private:
+    void watchdogThreadFunction();
+    void check();
+    void sendHeartbeat(std::int64_t now);
+
+    std::shared_ptr<ProtocolHandler> protocolHandler_;
+    std::shared_ptr<ICommunicationClient> client_;
+    Config config_;
+    std::function<void(const std::string&)> deadLinkHandler_;
+    std::int64_t heartbeatSentNs_ = 0;  // Watchdog thread only
+    std::int64_t declaredDeadNs_ = 0;   // Watchdog thread only
+    std::shared_ptr<std::atomic<bool>> heartbeatOutstanding_ = std::make_shared<std::atomic<bool>>(false);
+    std::atomic<bool> isRunning_{false};
+    std::atomic<std::uint64_t> heartbeatsSent_{0};
+    std::atomic<std::uint64_t> deadLinks_{0};
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::thread watchdogThread_;
+};
+
+#endif // CONNECTION_WATCHDOG_H
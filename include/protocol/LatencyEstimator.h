@@ -0,0 +1,90 @@
+#ifndef LATENCY_ESTIMATOR_H
+#define LATENCY_ESTIMATOR_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Returns the current wall-clock time in nanoseconds since the epoch.
+ * @return The time, on the same clock as AxisSample::timestampNs.
+ */
+inline std::int64_t wallClockNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @brief Returns the current monotonic time in nanoseconds.
+ * @return The time, suitable for measuring intervals but not for stamping samples.
+ */
+inline std::int64_t steadyClockNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @struct LatencySnapshot
+ * @brief The current request latency estimate of one connection.
+ */
+struct LatencySnapshot {
+    std::uint64_t samples = 0;
+    std::int64_t minRttNs = 0;   // Minimum round trip over the recent window
+    double meanRttNs = 0.0;      // Smoothed round trip
+    double jitterNs = 0.0;       // Smoothed absolute deviation of the round trip
+    std::int64_t outboundNs = 0; // Estimated send-to-service leg of the minimum round trip
+    std::int64_t inboundNs = 0;  // Estimated service-to-receive leg of the minimum round trip
+};
+
+/**
+ * @class LatencyEstimator
+ * @brief Estimates when the controller actually served a request from its send and receive times.
+ *
+ * Taking the receive time as the sample time is biased by the whole return
+ * leg, and any queueing in front of the request. The estimator tracks the
+ * minimum round trip over a sliding window as the pure wire-plus-processing
+ * latency and splits it into an outbound and an inbound leg. The controller
+ * served the request no earlier than send + outbound, no earlier than it
+ * answered the previous request on the same connection, and no later than
+ * receive - inbound; the estimate is the midpoint of that interval. For an
+ * isolated request this is the RTT midpoint; for pipelined requests it
+ * removes the time spent queued behind earlier commands.
+ *
+ * Not thread-safe: one estimator belongs to one connection's read path.
+ */
+class LatencyEstimator {
+public:
+    /**
+     * @brief Constructs an estimator.
+     * @param outboundShare Fraction of the minimum round trip spent before the controller serves a request.
+     * @param windowSamples Number of samples after which the minimum round trip is re-measured.
+     */
+    explicit LatencyEstimator(double outboundShare = 0.5, std::size_t windowSamples = 1024);
+
+    /**
+     * @brief Adds a round trip and returns the estimated service time of the request.
+     * @param sentNs Time the request was written, in nanoseconds since the epoch.
+     * @param receivedNs Time the reply was received, in nanoseconds since the epoch.
+     * @return The estimated time the controller served the request.
+     */
+    std::int64_t estimate(std::int64_t sentNs, std::int64_t receivedNs);
+
+    /**
+     * @brief Returns the current latency statistics.
+     * @return The snapshot.
+     */
+    LatencySnapshot snapshot() const;
+
+private:
+    double outboundShare_;
+    std::size_t windowSamples_;
+    std::int64_t minRttNs_;
+    std::int64_t windowMinRttNs_;
+    std::size_t windowCount_ = 0;
+    double meanRttNs_ = 0.0;
+    double jitterNs_ = 0.0;
+    std::uint64_t samples_ = 0;
+    std::int64_t lastReceivedNs_ = 0;
+};
+
+#endif // LATENCY_ESTIMATOR_H
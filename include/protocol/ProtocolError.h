@@ -0,0 +1,44 @@
+#ifndef PROTOCOL_ERROR_H
+#define PROTOCOL_ERROR_H
+
+#include <string_view>
+#include <system_error>
+
+/**
+ * @enum ProtocolErrc
+ * @brief Error conditions reported by the non-throwing protocol functions.
+ */
+enum class ProtocolErrc {
+    emptyResponse = 1,
+    missingCommandField,
+    invalidAxisNumber,
+    invalidNumber,
+};
+
+/**
+ * @brief Returns the error category of ProtocolErrc values.
+ * @return The protocol error category.
+ */
+const std::error_category& protocolErrorCategory() noexcept;
+
+/**
+ * @brief Makes ProtocolErrc values usable as std::error_code.
+ * @param error The protocol error.
+ * @return The corresponding error code.
+ */
+std::error_code make_error_code(ProtocolErrc error) noexcept;
+
+/**
+ * @brief Parses a decimal integer without throwing.
+ * @param text The text to parse. Surrounding spaces are not accepted.
+ * @param value Receives the parsed value on success.
+ * @return An empty error code on success, ProtocolErrc::invalidNumber otherwise.
+ */
+std::error_code parseInteger(std::string_view text, int& value) noexcept;
+
+namespace std {
+template <>
+struct is_error_code_enum<ProtocolErrc> : true_type {};
+} // namespace std
+
+#endif // PROTOCOL_ERROR_H
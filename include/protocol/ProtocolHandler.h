@@ -5,6 +5,10 @@
 #include "protocol/exceptions/ConnectionException.h"
 #include "protocol/exceptions/ProtocolException.h"
 #include "protocol/exceptions/TimeoutException.h"
+#include "protocol/ProtocolError.h"
+#include "protocol/LatencyEstimator.h"
+#include "protocol/CallbackProfiler.h"
+#include "protocol/CommandJournal.h"
 #include "common/ThreadSafeQueue.h"
 #include <functional>
 #include <string>
@@ -13,21 +17,227 @@
 #include <memory>
 #include <future>
 #include <atomic>
+#include <chrono>
+#include <thread>
+#include <condition_variable>
 #include <mutex>
+#include <system_error>
+#include <memory_resource>
+#include <string_view>
+#include <deque>
+#include <unordered_map>
 
 /**
  * @struct ProtocolResponse
  * @brief Data structure for a structured protocol response.
  *
  * This structure holds the parsed components of a response string, including
- * the status, command, axis number (if present), and parameters.
+ * the status, command, axis number (if present), and parameters. Responses
+ * delivered to a command callback also carry wall-clock timestamps in
+ * nanoseconds since the epoch; they are 0 for responses parsed directly.
  */
 struct ProtocolResponse {
-    char status;
-    int axisNo;
+    char status = '\0';
+    int axisNo = -1;
     std::string command;
     std::vector<std::string> params;
     std::string fullResponse;
+    std::int64_t sentNs = 0;     // When the command was written
+    std::int64_t receivedNs = 0; // When the reply was received
+    std::int64_t sampleNs = 0;   // Estimated time the controller served the command (see LatencyEstimator)
+};
+
+/**
+ * @struct CommandRequest
+ * @brief A single command queued for batched transmission with ProtocolHandler::sendCommands().
+ */
+struct CommandRequest {
+    std::string baseCommand;
+    int axisNo = -1;
+    std::vector<std::string> params;
+    std::function<void(const ProtocolResponse&)> callback;
+};
+
+/**
+ * @struct ConnectionActivity
+ * @brief Progress counters of one connection, read by ConnectionWatchdog.
+ *
+ * Times are steadyClockNs() values, or 0 if the event has not happened yet.
+ */
+struct ConnectionActivity {
+    std::int64_t lastSentNs = 0;        // Last command written
+    std::int64_t lastReceivedNs = 0;    // Last line received, matched or not
+    std::int64_t waitingSinceNs = 0;    // When the oldest run of unanswered commands started
+    std::size_t pendingCommands = 0;    // Commands waiting for a reply
+};
+
+/**
+ * @struct ShutdownReport
+ * @brief Outcome of an orderly shutdown.
+ */
+struct ShutdownReport {
+    bool drained = true;            // Every reply arrived before the deadline
+    std::size_t failedCommands = 0; // Commands completed with an error because their reply did not arrive
+    double elapsedMs = 0.0;
+};
+
+/**
+ * @struct FairQueueConfig
+ * @brief Settings of the per-submitter fair queueing in front of a connection (see ProtocolHandler::setFairQueueing()).
+ */
+struct FairQueueConfig {
+    std::size_t maxInFlight = 8; // Commands written but not yet answered; further commands wait in their submitter's queue
+    std::size_t quantum = 4;     // Commands a submitter may send per round; a batch costs its command count
+};
+
+/**
+ * @class SubmitterTagScope
+ * @brief Sets the fair-queueing tag of the commands submitted by the current thread while it is alive.
+ *
+ * Without a scope, each thread is its own submitter. A scope lets several
+ * threads share one queue (e.g. all workers of a bulk job) or lets one thread
+ * submit under several tags. Scopes nest; the previous tag is restored on exit.
+ */
+class SubmitterTagScope {
+public:
+    /**
+     * @brief Sets the tag of the current thread.
+     * @param tag The submitter tag.
+     */
+    explicit SubmitterTagScope(std::uint64_t tag);
+
+    /**
+     * @brief Restores the previous tag.
+     */
+    ~SubmitterTagScope();
+
+    SubmitterTagScope(const SubmitterTagScope&) = delete;
+    SubmitterTagScope& operator=(const SubmitterTagScope&) = delete;
+
+    /**
+     * @brief Returns the tag of the current thread.
+     * @return The tag set by the innermost scope, or a value derived from the thread id.
+     */
+    static std::uint64_t current();
+
+private:
+    std::uint64_t previousTag_;
+    bool previousSet_;
+};
+
+class ProtocolHandler;
+
+/**
+ * @class CommandHandle
+ * @brief Identifies one submitted command so its callback can be cancelled.
+ *
+ * Replies are matched to commands in send order, so a command that has
+ * already been written cannot be taken back: cancelling it detaches and
+ * destroys its callback, and the reply is discarded when it arrives. A command
+ * still waiting in a fair queue (see ProtocolHandler::setFairQueueing()) is
+ * removed from it instead and never written.
+ * Handles are small values; copies refer to the same command. A handle must
+ * not be used after its ProtocolHandler is destroyed.
+ */
+class CommandHandle {
+public:
+    CommandHandle() = default;
+
+    /**
+     * @brief Detaches the command's callback so it never runs, and withdraws the command if it is not written yet.
+     * @return True if the command was cancelled, false if its callback already ran, it was cancelled or the handle is empty.
+     */
+    bool cancel() const;
+
+    /**
+     * @brief Returns whether the handle refers to a submitted command.
+     * @return True unless default-constructed.
+     */
+    bool valid() const { return owner_ != nullptr; }
+
+private:
+    friend class ProtocolHandler;
+
+    CommandHandle(ProtocolHandler* owner, std::uint32_t slot, std::uint32_t generation)
+        : owner_(owner), slot_(slot), generation_(generation) {}
+
+    ProtocolHandler* owner_ = nullptr;
+    std::uint32_t slot_ = 0;
+    std::uint32_t generation_ = 0;
+};
+
+/**
+ * @class CommandBatch
+ * @brief Commands collected for a single pipelined write, allocated from a caller-supplied arena.
+ *
+ * The encoded command bytes and the per-command bookkeeping live in the given
+ * memory resource (typically a CycleArena), so building a batch does not touch
+ * the general-purpose heap. The batch must be destroyed before its arena is reset.
+ */
+class CommandBatch {
+public:
+    using Callback = std::function<void(const ProtocolResponse&)>;
+
+    /**
+     * @brief Constructs an empty batch.
+     * @param arena The memory resource used for the batch's storage.
+     */
+    explicit CommandBatch(std::pmr::memory_resource* arena = std::pmr::get_default_resource());
+
+    /**
+     * @brief Appends a command without parameters.
+     * @param baseCommand The command string (e.g., "RDP", "STR").
+     * @param axisNo The axis number, or -1 if the command takes none.
+     * @param callback The callback function to execute when the response is received.
+     * @param site Where the callback is registered, recorded by the CallbackProfiler.
+     */
+    void add(std::string_view baseCommand, int axisNo, Callback callback, CallSite site = CallSite::current());
+
+    /**
+     * @brief Appends a command with parameters.
+     * @param baseCommand The command string (e.g., "RSY").
+     * @param axisNo The axis number, or -1 if the command takes none.
+     * @param params A vector of string parameters.
+     * @param callback The callback function to execute when the response is received.
+     * @param site Where the callback is registered, recorded by the CallbackProfiler.
+     */
+    void add(std::string_view baseCommand, int axisNo, const std::vector<std::string>& params, Callback callback,
+             CallSite site = CallSite::current());
+
+    /**
+     * @brief Returns the number of commands in the batch.
+     * @return The command count.
+     */
+    std::size_t size() const { return entries_.size(); }
+
+    /**
+     * @brief Returns the cancellation handle of a command, valid once the batch has been sent.
+     * @param index The command's position in the batch.
+     * @return The handle, or an empty handle before sendBatch().
+     */
+    CommandHandle handle(std::size_t index) const { return entries_[index].handle; }
+
+    /**
+     * @brief Returns the encoded bytes of all commands.
+     * @return The encoded batch.
+     */
+    std::string_view encoded() const { return encoded_; }
+
+private:
+    friend class ProtocolHandler;
+
+    struct Entry {
+        std::pmr::string responseKey;
+        Callback callback;
+        CommandHandle handle;
+        CallSite site;
+        std::size_t lineBegin = 0; // The command's line in encoded_, without CR/LF
+        std::size_t lineEnd = 0;
+    };
+
+    std::pmr::memory_resource* arena_;
+    std::pmr::string encoded_;
+    std::pmr::vector<Entry> entries_;
 };
 
 /**
@@ -46,6 +256,14 @@ public:
      */
     explicit ProtocolHandler(std::shared_ptr<ICommunicationClient> client);
 
+    /**
+     * @brief Destructor. Detaches the client's callbacks; does not drain or close the connection.
+     */
+    ~ProtocolHandler();
+
+    ProtocolHandler(const ProtocolHandler&) = delete;
+    ProtocolHandler& operator=(const ProtocolHandler&) = delete;
+
     /**
      * @brief Initializes the protocol handler.
      */
@@ -57,18 +275,284 @@ public:
      * @param axisNo The axis number for the command. Use a special value (e.g., -1) if no axis number is required.
      * @param params A vector of string parameters.
      * @param callback The callback function to execute when a response is received.
+     * @param site Where the callback is registered, recorded by the CallbackProfiler.
+     * @return A handle that cancels the callback.
+     */
+    CommandHandle sendCommand(const std::string& baseCommand, int axisNo, const std::vector<std::string>& params, std::function<void(const ProtocolResponse&)> callback,
+                              CallSite site = CallSite::current());
+
+    /**
+     * @brief Sends several commands in a single write so they are pipelined on the connection.
+     *
+     * Callbacks are registered in order before the write is issued.
+     * @param requests The commands to send.
+     * @param site Where the callbacks are registered, recorded by the CallbackProfiler.
+     * @return One cancellation handle per request, in request order.
+     */
+    std::vector<CommandHandle> sendCommands(const std::vector<CommandRequest>& requests, CallSite site = CallSite::current());
+
+    /**
+     * @brief Sends every command of a batch in a single write.
+     *
+     * Callbacks are moved out of the batch, so it can be destroyed (and its arena reset) right after.
+     * The cancellation handles are left in the batch (see CommandBatch::handle()).
+     * @param batch The commands to send.
+     */
+    void sendBatch(CommandBatch& batch);
+
+    /**
+     * @brief Parses a response line into a ProtocolResponse without throwing.
+     * @param response The response string to parse.
+     * @param error Set to a ProtocolErrc value on failure, cleared on success.
+     * @return The parsed response. Only partially filled if error is set.
+     */
+    static ProtocolResponse parseResponse(const std::string& response, std::error_code& error);
+
+    /**
+     * @brief Parses a response line into a ProtocolResponse.
+     * @param response The response string to parse.
+     * @return The parsed response.
+     * @throws ProtocolException if the response is malformed.
+     */
+    static ProtocolResponse parseResponse(const std::string& response);
+
+    /**
+     * @brief Parses a response line into an existing ProtocolResponse without throwing.
+     *
+     * The string and vector capacity of parsed is reused, so a long-lived
+     * object makes steady-state parsing allocation-free.
+     * @param response The response string to parse.
+     * @param parsed Receives the parsed response. Only partially filled if error is set.
+     * @param error Set to a ProtocolErrc value on failure, cleared on success.
+     */
+    static void parseResponse(const std::string& response, ProtocolResponse& parsed, std::error_code& error);
+
+    /**
+     * @brief Returns the request latency estimate of this connection.
+     * @return The latency snapshot.
+     */
+    LatencySnapshot latency();
+
+    /**
+     * @brief Sets how the minimum round trip is split into an outbound and an inbound leg.
+     *
+     * The default even split suits a symmetric link; measure the legs of an asymmetric one and
+     * set its outbound share here. Restarts the estimate of this connection.
+     * @param outboundShare Fraction of the minimum round trip spent before the controller serves a request.
+     * @param windowSamples Number of samples after which the minimum round trip is re-measured.
+     */
+    void setLatencySplit(double outboundShare, std::size_t windowSamples = 1024);
+
+    /**
+     * @brief Returns the progress counters of this connection.
+     *
+     * Lock-free, so it can be called while the I/O thread is stuck.
+     * @return The activity snapshot.
      */
-    void sendCommand(const std::string& baseCommand, int axisNo, const std::vector<std::string>& params, std::function<void(const ProtocolResponse&)> callback);
+    ConnectionActivity activity() const;
+
+    /**
+     * @brief Completes every command still waiting for a reply with an error response.
+     *
+     * Called when the connection is lost, so callers are not left waiting for replies that
+     * will never arrive. Each callback receives status 'E' and the reason as its only parameter.
+     * @param reason The reason passed to the callbacks.
+     * @return The number of commands failed.
+     */
+    std::size_t failPendingCommands(const std::string& reason);
+
+    /**
+     * @brief Shuts the connection down in order, waiting at most the given time for replies in flight.
+     *
+     * Stops accepting commands (later ones complete at once with an 'E' "shutdown" response),
+     * waits for outstanding replies until the deadline, stops delivering reads to this handler,
+     * fails the commands still waiting and closes the client. Once it returns, no callback of
+     * this handler runs, except the one it is called from. Called on the I/O thread, which
+     * would have to deliver the replies, it fails outstanding commands without waiting.
+     * Later calls do nothing.
+     * @param deadline How long to wait for outstanding replies before failing them.
+     * @return What happened to the outstanding commands.
+     */
+    ShutdownReport shutdown(std::chrono::milliseconds deadline);
+
+    /**
+     * @brief Detaches the callback of a submitted command so it never runs.
+     *
+     * A written command's reply is still awaited and then dropped, to keep
+     * replies matched in order. A command still in a fair queue is marked
+     * withdrawn in place, in constant time, and left out when its write goes
+     * out; its journal record, if any, completes with an 'E' "cancelled" record.
+     * @param handle The handle returned when the command was submitted.
+     * @return True if the command was cancelled, false if its callback already ran or it was cancelled.
+     */
+    bool cancel(const CommandHandle& handle);
+
+    /**
+     * @brief Returns the number of callbacks detached by cancel().
+     * @return The cancelled command count.
+     */
+    std::uint64_t cancelledCommands() const { return cancelledCommands_.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Replaces the profiler that times this handler's callbacks, e.g. to share one between handlers.
+     *
+     * Call before initialize().
+     * @param profiler The profiler. Must not be null.
+     */
+    void setCallbackProfiler(std::shared_ptr<CallbackProfiler> profiler);
+
+    /**
+     * @brief Returns the profiler that times this handler's callbacks.
+     * @return The profiler.
+     */
+    const std::shared_ptr<CallbackProfiler>& callbackProfiler() const { return callbackProfiler_; }
+
+    /**
+     * @brief Records every command sent through this handler, and its outcome, in a journal.
+     *
+     * Commands the journal excludes (see CommandJournal::journals()) are skipped. The journal
+     * must be started by the caller. Call before sending commands; null stops journalling.
+     * @param journal The journal.
+     */
+    void setCommandJournal(std::shared_ptr<CommandJournal> journal) { commandJournal_ = std::move(journal); }
+
+    /**
+     * @brief Returns the journal commands are recorded in.
+     * @return The journal, null if none.
+     */
+    const std::shared_ptr<CommandJournal>& commandJournal() const { return commandJournal_; }
+
+    /**
+     * @brief Queues commands per submitter and writes them with deficit round-robin.
+     *
+     * At most maxInFlight commands are written and unanswered at a time. The rest wait in
+     * per-submitter queues (see SubmitterTagScope), which are served in turn with a quantum of
+     * commands per round, so one submitter's bulk job cannot delay another's commands by more
+     * than about one round. Replies are still matched in write order. Call before sending commands.
+     * @param config The queueing settings.
+     */
+    void setFairQueueing(FairQueueConfig config);
+
+    /**
+     * @brief Returns the number of commands waiting in the fair queues, not yet written.
+     * @return The queued command count.
+     */
+    std::size_t queuedCommands() const { return queuedCommands_.load(std::memory_order_relaxed); }
 
 private:
+    struct QueuedWrite;
+
+    /**
+     * @struct CallbackSlot
+     * @brief Storage for the callback of one outstanding command.
+     *
+     * Slots are recycled through a free list; the generation changes on every
+     * reuse so a stale CommandHandle cannot cancel a later command.
+     */
+    struct CallbackSlot {
+        std::function<void(const ProtocolResponse&)> callback;
+        CallSite site;
+        std::uint32_t generation = 0;
+        std::uint64_t journalSequence = 0;  // The command's submitted record, 0 if not journalled
+        QueuedWrite* queuedWrite = nullptr; // The fair-queued write holding the command, null once written
+        std::uint32_t queuedReply = 0;      // The command's index in queuedWrite->replies
+    };
+
+    /**
+     * @struct PendingCallback
+     * @brief A command waiting for its response: its callback slot and the time it was written.
+     */
+    struct PendingCallback {
+        std::uint32_t slot = 0;
+        std::int64_t sentNs = 0;
+    };
+
+    /**
+     * @struct QueuedReply
+     * @brief One command of a queued write: its response key, callback slot and line in the write's bytes.
+     */
+    struct QueuedReply {
+        std::string responseKey;
+        std::uint32_t slot = 0;
+        std::size_t lineBegin = 0; // The line, CR/LF included, ends where the next command's begins
+        bool withdrawn = false;    // Cancelled before being written; left out of the write
+    };
+
+    /**
+     * @struct QueuedWrite
+     * @brief One command or batch waiting in a fair queue: its bytes and the callback slot of each command.
+     *
+     * Writes stay at the same address while queued (see CallbackSlot::queuedWrite).
+     */
+    struct QueuedWrite {
+        std::string bytes;
+        std::vector<QueuedReply> replies;
+        std::size_t live = 0; // Replies not withdrawn; what the write costs in its submitter's round
+    };
+
+    /**
+     * @struct SubmitterQueue
+     * @brief The fair queue of one submitter tag.
+     */
+    struct SubmitterQueue {
+        std::deque<QueuedWrite> writes;
+        std::size_t deficit = 0;   // Commands the submitter may still send this round
+        bool granted = false;      // The quantum of the current round has been added
+        bool active = false;       // Listed in activeSubmitters_
+    };
+
+    /**
+     * @struct ReadGuard
+     * @brief Shared with the client's callbacks so they stop reaching this handler once it detaches.
+     */
+    struct ReadGuard {
+        std::mutex mutex;   // Held while a callback runs
+        bool attached = true;
+        std::atomic<std::thread::id> deliveringThread{}; // Thread holding mutex in a callback, if any
+        std::atomic<std::thread::id> readerThread{};     // Thread that last delivered a read (the I/O thread)
+    };
+
+    void detachFromClient();
+    void rejectCommand(std::string_view responseKey, const std::function<void(const ProtocolResponse&)>& callback, const CallSite& site);
+    CommandHandle registerCallback(std::string_view responseKey, std::function<void(const ProtocolResponse&)> callback, std::int64_t sentNs,
+                                   const CallSite& site);
+    CommandHandle allocateSlot(std::function<void(const ProtocolResponse&)> callback, const CallSite& site);
+    void expectReply(std::string_view responseKey, std::uint32_t slot, std::int64_t sentNs);
+    void queueWrite(QueuedWrite write);
+    void dispatchQueued();
+    std::string withdrawQueued(std::uint32_t slot);
+    std::function<void(const ProtocolResponse&)> releaseSlot(std::uint32_t slot, CallSite& site, std::uint64_t& journalSequence);
+    void journalSubmission(std::uint32_t slot, std::string_view responseKey, std::string_view line);
+    void invokeCallback(const std::function<void(const ProtocolResponse&)>& callback, const ProtocolResponse& response,
+                        const CallSite& site);
     void handleRead(const std::string& responseData);
     std::string generateResponseKey(const std::string& baseCommand, int axisNo);
-    ProtocolResponse parseResponse(const std::string& response);
 
     std::shared_ptr<ICommunicationClient> client_;
-    std::map<std::string, ThreadSafeQueue<std::function<void(const ProtocolResponse&)>>> responseCallbacks_;
+    // Queues are kept once created: the set of keys is small and recreating them costs allocations.
+    std::map<std::string, ThreadSafeQueue<PendingCallback>, std::less<>> responseCallbacks_;
+    std::vector<CallbackSlot> callbackSlots_;
+    std::vector<std::uint32_t> freeSlots_;
+    ProtocolResponse scratchResponse_; // Reused by handleRead on the I/O thread
+    std::string batchBuffer_; // Encoded batch passed to the transport; reused under callbackMutex_
+    LatencyEstimator latencyEstimator_;
+    std::shared_ptr<CallbackProfiler> callbackProfiler_;
+    std::shared_ptr<CommandJournal> commandJournal_;
     std::atomic<bool> isReading_ = false;
-    std::mutex callbackMutex_; // Protects the responseCallbacks_ map
+    std::atomic<std::int64_t> lastSentNs_{0};
+    std::atomic<std::int64_t> lastReceivedNs_{0};
+    std::atomic<std::int64_t> waitingSinceNs_{0};
+    std::atomic<std::size_t> pendingCommands_{0};
+    std::atomic<std::uint64_t> cancelledCommands_{0};
+    std::atomic<bool> acceptingCommands_{true};
+    bool fairQueueing_ = false;
+    FairQueueConfig fairQueueConfig_;
+    std::unordered_map<std::uint64_t, SubmitterQueue> submitterQueues_;
+    std::deque<std::uint64_t> activeSubmitters_; // Tags with queued writes, in round-robin order
+    std::atomic<std::size_t> queuedCommands_{0};
+    std::shared_ptr<ReadGuard> readGuard_;
+    std::condition_variable drainedCv_; // Signalled with callbackMutex_ when the last outstanding command is answered, failed or withdrawn
+    std::mutex callbackMutex_; // Protects the responseCallbacks_ map, the callback slots, the fair queues and latencyEstimator_
 };
 
 #endif // PROTOCOL_HANDLER_H
\ No newline at end of file
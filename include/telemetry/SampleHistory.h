@@ -0,0 +1,103 @@
+#ifndef SAMPLE_HISTORY_H
+#define SAMPLE_HISTORY_H
+
+#include "controller/AxisState.h"
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/**
+ * @struct SampleHistoryWindow
+ * @brief Contiguous, read-only view of the most recent samples of one axis.
+ *
+ * The pointers refer to library memory that stays valid for the lifetime of
+ * the SampleHistory. The view is live: newer samples overwrite the oldest
+ * entries of the window in place. Compare SampleHistory::totalSamples() before
+ * and after reading to find how many leading entries may have been overwritten.
+ */
+struct SampleHistoryWindow {
+    const std::int64_t* timestampsNs = nullptr;
+    const std::int32_t* positions = nullptr;
+    const std::uint32_t* statusWords = nullptr;
+    const std::uint8_t* hasPositions = nullptr; // 0 where the position is the -1 "unknown" placeholder
+    std::size_t size = 0;
+    std::uint64_t totalSamples = 0; // Samples recorded for the axis when the view was taken
+};
+
+/**
+ * @class SampleHistory
+ * @brief Keeps the most recent raw samples of every axis in columnar ring buffers.
+ *
+ * Each sample is written twice, at slot i and slot i + capacity, so the latest
+ * `capacity` samples always form one contiguous range. This lets callers (for
+ * example NumPy) view the history directly without copying or re-assembling
+ * the wrapped halves of the ring.
+ */
+class SampleHistory {
+public:
+    /**
+     * @brief Constructs a SampleHistory.
+     * @param capacity The number of recent samples retained per axis.
+     */
+    explicit SampleHistory(std::size_t capacity);
+
+    SampleHistory(const SampleHistory&) = delete;
+    SampleHistory& operator=(const SampleHistory&) = delete;
+
+    /**
+     * @brief Registers this history as a sample listener of the given AxisState.
+     *
+     * The history must outlive any further updates to the AxisState.
+     * @param axisState The state whose updates should be retained.
+     */
+    void attach(AxisState& axisState);
+
+    /**
+     * @brief Appends a sample to the history of its axis.
+     * @param sample The sample to append.
+     */
+    void addSample(const AxisSample& sample);
+
+    /**
+     * @brief Returns a contiguous view of the most recent samples of an axis, oldest first.
+     * @param axisNo The axis number.
+     * @return The view. Empty if the axis has no samples.
+     */
+    SampleHistoryWindow window(int axisNo);
+
+    /**
+     * @brief Returns the number of samples ever recorded for an axis.
+     * @param axisNo The axis number.
+     * @return The sample count.
+     */
+    std::uint64_t totalSamples(int axisNo);
+
+    /**
+     * @brief Returns the number of recent samples retained per axis.
+     * @return The capacity.
+     */
+    std::size_t capacity() const { return capacity_; }
+
+private:
+    struct AxisBuffer {
+        explicit AxisBuffer(std::size_t capacity)
+            : timestampsNs(2 * capacity), positions(2 * capacity), statusWords(2 * capacity), hasPositions(2 * capacity) {}
+
+        std::vector<std::int64_t> timestampsNs;
+        std::vector<std::int32_t> positions;
+        std::vector<std::uint32_t> statusWords;
+        std::vector<std::uint8_t> hasPositions;
+        std::atomic<std::uint64_t> total{0};
+    };
+
+    AxisBuffer* findBuffer(int axisNo);
+
+    std::size_t capacity_;
+    std::map<int, std::unique_ptr<AxisBuffer>> axes_; // Buffers are never freed, so views stay valid
+    std::mutex mutex_;
+};
+
+#endif // SAMPLE_HISTORY_H
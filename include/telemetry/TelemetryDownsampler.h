@@ -0,0 +1,122 @@
+#ifndef TELEMETRY_DOWNSAMPLER_H
+#define TELEMETRY_DOWNSAMPLER_H
+
+#include "controller/AxisState.h"
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <vector>
+
+/**
+ * @struct DownsampleBucket
+ * @brief Aggregated positions of one axis over a fixed time interval.
+ */
+struct DownsampleBucket {
+    std::int64_t startNs = 0; // Start of the interval, aligned to the bucket width
+    int min = 0;
+    int max = 0;
+    int last = 0;
+    std::uint32_t count = 0;      // Position readings folded in
+    std::int64_t sum = 0;
+
+    /**
+     * @brief Returns the mean of the position readings in the bucket.
+     * @return The mean position.
+     */
+    double mean() const { return count > 0 ? static_cast<double>(sum) / count : 0.0; }
+};
+
+/**
+ * @class TelemetryDownsampler
+ * @brief Maintains multi-resolution min/max/mean/last buckets of axis positions as samples arrive.
+ *
+ * Every level keeps a fixed-size ring of buckets per axis, so each sample costs
+ * O(number of levels) and memory is bounded. Plots over long ranges read a few
+ * hundred buckets from a coarse level instead of the raw samples. Samples that
+ * arrive out of order are folded into the current bucket of each level.
+ */
+class TelemetryDownsampler {
+public:
+    /**
+     * @struct Level
+     * @brief Bucket width and retained bucket count of one resolution level.
+     */
+    struct Level {
+        std::int64_t bucketNs;
+        std::size_t capacity;
+    };
+
+    /**
+     * @brief Returns the default levels: 1 s for 1 hour, 10 s for 1 day and 1 min for 1 week.
+     * @return The default level configuration.
+     */
+    static std::vector<Level> defaultLevels();
+
+    /**
+     * @brief Constructs a TelemetryDownsampler.
+     * @param levels The resolution levels, ordered from finest to coarsest.
+     */
+    explicit TelemetryDownsampler(std::vector<Level> levels = defaultLevels());
+
+    /**
+     * @brief Registers this downsampler as a sample listener of the given AxisState.
+     *
+     * The downsampler must outlive any further updates to the AxisState.
+     * @param axisState The state whose updates should be aggregated.
+     */
+    void attach(AxisState& axisState);
+
+    /**
+     * @brief Folds a sample into the current bucket of every level.
+     *
+     * Only samples carrying a new position reading (AxisSample::positionUpdated) are
+     * aggregated, so a status-only update does not count its axis's last position again.
+     * @param sample The sample to aggregate.
+     */
+    void addSample(const AxisSample& sample);
+
+    /**
+     * @brief Copies the buckets of one level that overlap a time range.
+     * @param axisNo The axis number.
+     * @param level The level index (0 is the finest).
+     * @param startNs Inclusive lower time bound.
+     * @param endNs Inclusive upper time bound.
+     * @param out The vector that receives the buckets in time order (appended).
+     * @return The number of buckets appended.
+     */
+    std::size_t getBuckets(int axisNo, std::size_t level, std::int64_t startNs, std::int64_t endNs,
+                           std::vector<DownsampleBucket>& out);
+
+    /**
+     * @brief Picks the finest level that covers a time range with at most maxPoints buckets.
+     * @param startNs Inclusive lower time bound.
+     * @param endNs Inclusive upper time bound.
+     * @param maxPoints The maximum number of buckets the caller wants to read.
+     * @return The level index; the coarsest level if none is coarse enough.
+     */
+    std::size_t selectLevel(std::int64_t startNs, std::int64_t endNs, std::size_t maxPoints) const;
+
+    /**
+     * @brief Returns the configured levels.
+     * @return The level configuration.
+     */
+    const std::vector<Level>& levels() const { return levels_; }
+
+private:
+    struct Ring {
+        std::vector<DownsampleBucket> buckets;
+        std::size_t head = 0;  // Index of the oldest bucket
+        std::size_t size = 0;
+
+        const DownsampleBucket& at(std::size_t logicalIndex) const {
+            return buckets[(head + logicalIndex) % buckets.size()];
+        }
+        DownsampleBucket& newest() { return buckets[(head + size - 1) % buckets.size()]; }
+    };
+
+    std::vector<Level> levels_;
+    std::map<int, std::vector<Ring>> axes_; // Per axis, one ring per level
+    std::mutex mutex_;
+};
+
+#endif // TELEMETRY_DOWNSAMPLER_H
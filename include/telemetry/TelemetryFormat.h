@@ -0,0 +1,156 @@
+#ifndef TELEMETRY_FORMAT_H
+#define TELEMETRY_FORMAT_H
+
+#include "controller/AxisState.h"
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <type_traits>
+
+/**
+ * @struct TelemetrySegmentHeader
+ * @brief Fixed header at offset 0 of every telemetry segment file.
+ *
+ * A segment file is this header followed by a sequence of self-contained blocks.
+ * All integers are stored in host (little-endian) byte order.
+ */
+struct TelemetrySegmentHeader {
+    static constexpr std::uint32_t kMagic = 0x47534B54; // "TKSG"
+    static constexpr std::uint32_t kVersion = 3;
+
+    std::uint32_t magic = kMagic;
+    std::uint32_t version = kVersion;
+    std::int64_t createdNs = 0;
+};
+
+/**
+ * @struct TelemetryBlockHeader
+ * @brief Header preceding each block of samples inside a segment.
+ *
+ * The block payload follows the header and holds four columns back to back:
+ * timestamps, axis numbers, positions and status words. Every block is
+ * decodable on its own, so readers can map and decode any block in isolation.
+ * Samples keep their arrival order, which is not strictly time order, so the
+ * time range of a block is its minimum and maximum timestamp, stored apart
+ * from the first timestamp that the timestamp deltas start from.
+ */
+struct TelemetryBlockHeader {
+    static constexpr std::uint32_t kMagic = 0x4B4C4254; // "TBLK"
+
+    std::uint32_t magic = kMagic;
+    std::uint32_t sampleCount = 0;
+    std::int64_t firstTimestampNs = 0;   // Timestamp of the first sample, the base of the timestamp deltas
+    std::int64_t minTimestampNs = 0;
+    std::int64_t maxTimestampNs = 0;
+    std::uint64_t axisMask = 0;          // Bit (axisNo % 64) is set for every axis present
+    std::uint32_t columnBytes[4] = {};   // Encoded sizes of the timestamp, axis, position and status columns
+
+    /**
+     * @brief Returns the total encoded size of the columns following the header.
+     * @return The payload size in bytes.
+     */
+    std::size_t payloadBytes() const {
+        return static_cast<std::size_t>(columnBytes[0]) + columnBytes[1] + columnBytes[2] + columnBytes[3];
+    }
+};
+
+/**
+ * @struct TelemetryIndexHeader
+ * @brief Fixed header at offset 0 of every segment index file.
+ *
+ * Each segment "segment-<ts>.kts" has a sidecar "segment-<ts>.kti" holding this
+ * header followed by one TelemetryIndexEntry per block, appended as blocks are
+ * written. The index is sparse: a single entry covers a whole block.
+ */
+struct TelemetryIndexHeader {
+    static constexpr std::uint32_t kMagic = 0x58494B54; // "TKIX"
+    static constexpr std::uint32_t kVersion = 2;
+
+    std::uint32_t magic = kMagic;
+    std::uint32_t version = kVersion;
+};
+
+/**
+ * @struct TelemetryIndexEntry
+ * @brief Location and coverage of a single block inside a segment.
+ */
+struct TelemetryIndexEntry {
+    std::int64_t minTimestampNs = 0;
+    std::int64_t maxTimestampNs = 0;
+    std::uint64_t axisMask = 0;
+    std::uint64_t offset = 0;       // Offset of the block header within the segment file
+    std::uint32_t blockBytes = 0;   // Header plus payload
+    std::uint32_t sampleCount = 0;
+};
+
+static_assert(std::is_trivially_copyable<TelemetrySegmentHeader>::value, "Segment header must be trivially copyable");
+static_assert(std::is_trivially_copyable<TelemetryBlockHeader>::value, "Block header must be trivially copyable");
+static_assert(sizeof(TelemetrySegmentHeader) == 16, "Unexpected segment header layout");
+static_assert(sizeof(TelemetryBlockHeader) == 56, "Unexpected block header layout");
+static_assert(sizeof(TelemetryIndexHeader) == 8, "Unexpected index header layout");
+static_assert(sizeof(TelemetryIndexEntry) == 40, "Unexpected index entry layout");
+
+/**
+ * @class TelemetryCodec
+ * @brief Encodes and decodes telemetry blocks.
+ *
+ * Columns are compressed with LEB128 varints:
+ * - timestamps as zigzag deltas from the previous sample,
+ * - axis numbers as zigzag values shifted left by one, the low bit set for a
+ *   sample without a position (AxisSample::hasPosition false),
+ * - positions as zigzag deltas from the previous known position of the same axis
+ *   (0 for a sample without a position),
+ * - status words XOR-ed with the previous word of the same axis.
+ * Steady-state samples therefore cost only a few bytes each.
+ */
+class TelemetryCodec {
+public:
+    /**
+     * @brief Encodes samples into a complete block (header and payload).
+     * @param samples The samples to encode, in arrival order. Must not be empty.
+     * @param out The buffer that receives the block (appended).
+     */
+    static void encodeBlock(const std::vector<AxisSample>& samples, std::vector<std::uint8_t>& out);
+
+    /**
+     * @brief Reads and validates the header of the block starting at data.
+     * @param data Pointer to the start of the block.
+     * @param size The number of readable bytes at data.
+     * @param header Receives the decoded header.
+     * @return True if a complete, well-formed block starts at data.
+     */
+    static bool readBlockHeader(const std::uint8_t* data, std::size_t size, TelemetryBlockHeader& header);
+
+    /**
+     * @brief Decodes every sample of the block starting at data.
+     * @param data Pointer to the start of the block.
+     * @param size The number of readable bytes at data.
+     * @param out The vector that receives the samples (appended).
+     * @return True on success, false if the block is truncated or corrupt.
+     */
+    static bool decodeBlock(const std::uint8_t* data, std::size_t size, std::vector<AxisSample>& out);
+
+    /**
+     * @brief Decodes the samples of a block that fall inside a time range and axis selection.
+     * @param data Pointer to the start of the block.
+     * @param size The number of readable bytes at data.
+     * @param startNs Inclusive lower time bound.
+     * @param endNs Inclusive upper time bound.
+     * @param axisMask Bit (axisNo % 64) is set for every selected axis; a quick filter ahead of axes.
+     * @param axes The selected axis numbers, sorted; empty selects every axis whose mask bit is set.
+     * @param out The vector that receives the matching samples (appended).
+     * @return True on success, false if the block is truncated or corrupt.
+     */
+    static bool decodeBlock(const std::uint8_t* data, std::size_t size, std::int64_t startNs, std::int64_t endNs,
+                            std::uint64_t axisMask, const std::vector<int>& axes, std::vector<AxisSample>& out);
+
+    /**
+     * @brief Builds the index entry describing a block.
+     * @param header The block header.
+     * @param offset The offset of the block within its segment file.
+     * @return The index entry.
+     */
+    static TelemetryIndexEntry makeIndexEntry(const TelemetryBlockHeader& header, std::uint64_t offset);
+};
+
+#endif // TELEMETRY_FORMAT_H
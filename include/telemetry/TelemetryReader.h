@@ -0,0 +1,85 @@
+#ifndef TELEMETRY_READER_H
+#define TELEMETRY_READER_H
+
+#include "telemetry/TelemetryFormat.h"
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * @struct TelemetryQuery
+ * @brief Selection of recorded samples by time range and axis.
+ */
+struct TelemetryQuery {
+    std::int64_t startNs = INT64_MIN;        // Inclusive lower time bound
+    std::int64_t endNs = INT64_MAX;          // Inclusive upper time bound
+    std::uint64_t axisMask = ~std::uint64_t{0}; // Bit (axisNo % 64) is set for every selected axis; prunes blocks
+    std::vector<int> axes;                   // Selected axis numbers, sorted; empty selects every axis
+
+    /**
+     * @brief Restricts the query to the given axes.
+     *
+     * Axis numbers of any size are selected exactly; axes sharing a mask bit
+     * only cost decoding blocks that turn out to hold none of the selected axes.
+     * @param axes The axis numbers to select; empty selects every axis.
+     * @return A reference to this query.
+     */
+    TelemetryQuery& selectAxes(const std::vector<int>& axes);
+};
+
+/**
+ * @class TelemetryReader
+ * @brief Answers time-range queries over the segments written by TelemetryRecorder.
+ *
+ * Segment indexes are loaded once and cached; the index of a segment that is
+ * still growing is extended on the next query. Only the blocks whose index
+ * entry overlaps the query are memory-mapped and decoded, so the cost of a
+ * query follows the size of its result rather than the size of the recording.
+ * A segment without a usable index is indexed by walking its block headers.
+ */
+class TelemetryReader {
+public:
+    /**
+     * @brief Constructs a TelemetryReader.
+     * @param directory The directory containing the segment files.
+     */
+    explicit TelemetryReader(std::string directory);
+
+    /**
+     * @brief Decodes every recorded sample matching the query.
+     * @param query The time range and axis selection.
+     * @param out The caller-provided buffer that receives the samples (appended).
+     *            Samples are ordered by segment and block, i.e. by recording order.
+     * @return The number of samples appended.
+     */
+    std::size_t query(const TelemetryQuery& query, std::vector<AxisSample>& out);
+
+    /**
+     * @brief Returns the time range covered by the recording.
+     * @param firstNs Receives the earliest recorded timestamp.
+     * @param lastNs Receives the latest recorded timestamp.
+     * @return False if no samples have been recorded.
+     */
+    bool timeRange(std::int64_t& firstNs, std::int64_t& lastNs);
+
+private:
+    struct Segment {
+        std::string path;
+        std::string indexPath;
+        std::vector<TelemetryIndexEntry> entries;
+        std::uint64_t indexedBytes = 0; // Segment bytes covered by entries
+        bool indexLoaded = false;
+        bool incompatible = false;      // Written in another format version; never decoded
+    };
+
+    void refreshSegments();
+    void updateIndex(Segment& segment);
+    void scanBlocks(Segment& segment, std::uint64_t fileSize);
+
+    std::string directory_;
+    std::map<std::pair<std::int64_t, unsigned>, Segment> segments_; // Keyed by the start time and collision suffix in the file name, i.e. in recording order
+};
+
+#endif // TELEMETRY_READER_H
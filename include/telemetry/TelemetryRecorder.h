@@ -0,0 +1,122 @@
+#ifndef TELEMETRY_RECORDER_H
+#define TELEMETRY_RECORDER_H
+
+#include "controller/AxisState.h"
+#include "common/BoundedQueue.h"
+#include "telemetry/TelemetryFormat.h"
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @class TelemetryRecorder
+ * @brief Streams axis samples into rolling, columnar segment files.
+ *
+ * Producers (typically AxisState listeners) only copy the sample into a bounded
+ * queue. A background thread batches samples into blocks, encodes them with
+ * TelemetryCodec and appends them to the current segment, rolling over to a new
+ * file once the segment reaches its size limit. Each block also gets an entry
+ * in the segment's sidecar index so readers can locate it without scanning.
+ * Samples that arrive while the queue is full are dropped and counted rather
+ * than stalling the caller.
+ */
+class TelemetryRecorder {
+public:
+    /**
+     * @struct Config
+     * @brief Recorder settings.
+     */
+    struct Config {
+        std::string directory;                     // Directory receiving the segment files
+        std::size_t queueCapacity = 65536;         // Samples buffered between producers and the writer
+        std::size_t samplesPerBlock = 4096;        // Samples encoded per block
+        std::uint64_t maxSegmentBytes = 64ull << 20; // Segment size that triggers a roll-over
+        int flushIntervalMs = 1000;                // Maximum age of an unwritten partial block
+    };
+
+    /**
+     * @brief Constructs a TelemetryRecorder.
+     * @param config The recorder settings.
+     */
+    explicit TelemetryRecorder(Config config);
+
+    ~TelemetryRecorder();
+
+    TelemetryRecorder(const TelemetryRecorder&) = delete;
+    TelemetryRecorder& operator=(const TelemetryRecorder&) = delete;
+
+    /**
+     * @brief Creates the output directory and starts the writer thread.
+     */
+    void start();
+
+    /**
+     * @brief Writes all queued samples, closes the current segment and joins the writer thread.
+     */
+    void stop();
+
+    /**
+     * @brief Registers this recorder as a sample listener of the given AxisState.
+     *
+     * The recorder must outlive any further updates to the AxisState.
+     * @param axisState The state whose updates should be recorded.
+     */
+    void attach(AxisState& axisState);
+
+    /**
+     * @brief Hands a sample to the writer thread without blocking.
+     * @param sample The sample to record.
+     * @return True if the sample was queued, false if it was dropped.
+     */
+    bool record(const AxisSample& sample);
+
+    /**
+     * @brief Returns the number of samples dropped because the queue was full.
+     * @return The dropped sample count.
+     */
+    std::uint64_t droppedSamples();
+
+    /**
+     * @brief Builds the file name of the segment whose first block starts at the given time.
+     *
+     * Names of different start times sort in time order; segments sharing a start time
+     * get a "-<n>" suffix in creation order (see TelemetryReader).
+     * @param startNs The earliest timestamp in the segment's first block.
+     * @param collision 0 for the first segment starting at startNs, n for the n-th one after it.
+     * @return The segment file name (without directory).
+     */
+    static std::string segmentFileName(std::int64_t startNs, unsigned collision = 0);
+
+    /**
+     * @brief Returns the index file name belonging to a segment file name.
+     * @param segmentFileName The segment file name.
+     * @return The index file name.
+     */
+    static std::string indexFileName(const std::string& segmentFileName);
+
+private:
+    static constexpr unsigned kMaxNameCollisions = 1000; ///< Segments that may share one start time
+
+    void writerThreadFunction();
+    void writeBlock();
+    void openSegment(std::int64_t startNs);
+    void closeSegment();
+
+    Config config_;
+    BoundedQueue<AxisSample> queue_;
+    std::atomic<bool> isRunning_{false};
+    std::unique_ptr<std::thread> writerThread_;
+
+    // Writer thread state
+    std::vector<AxisSample> pending_;
+    std::vector<std::uint8_t> encoded_;
+    std::ofstream segment_;
+    std::ofstream index_;
+    std::uint64_t segmentBytes_ = 0;
+};
+
+#endif // TELEMETRY_RECORDER_H
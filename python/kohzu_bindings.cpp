@@ -0,0 +1,295 @@
+#include "controller/KohzuController.h"
+#include "controller/AxisStatistics.h"
+#include "core/TcpClient.h"
+#include "telemetry/SampleHistory.h"
+#include "telemetry/TelemetryDownsampler.h"
+#include "telemetry/TelemetryReader.h"
+#include <pybind11/pybind11.h>
+#include <pybind11/numpy.h>
+#include <pybind11/stl.h>
+#include <boost/asio.hpp>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <thread>
+
+namespace py = pybind11;
+
+namespace {
+
+using ResponseCallback = std::function<void(const ProtocolResponse&)>;
+
+/**
+ * @brief Wraps a Python callable so it can be invoked from the I/O thread.
+ *
+ * The GIL is acquired for every call and for the final release of the callable.
+ * @param callback A Python callable taking a ProtocolResponse, or None.
+ * @return The wrapped callback (a no-op for None).
+ */
+ResponseCallback wrapCallback(py::object callback) {
+    if (callback.is_none()) {
+        return [](const ProtocolResponse&) {};
+    }
+    std::shared_ptr<py::object> holder(new py::object(std::move(callback)), [](py::object* object) {
+        py::gil_scoped_acquire gil;
+        delete object;
+    });
+    return [holder](const ProtocolResponse& response) {
+        py::gil_scoped_acquire gil;
+        try {
+            (*holder)(response);
+        } catch (py::error_already_set& e) {
+            e.discard_as_unraisable("kohzu response callback");
+        }
+    };
+}
+
+/**
+ * @brief Submits a command and blocks until its response arrives.
+ *
+ * Called with the GIL released.
+ * @param submit Function that sends the command with the given completion callback.
+ * @param timeoutSeconds The maximum time to wait for the response.
+ * @return The response.
+ */
+ProtocolResponse submitAndWait(const std::function<void(ResponseCallback)>& submit, double timeoutSeconds) {
+    auto promise = std::make_shared<std::promise<ProtocolResponse>>();
+    std::future<ProtocolResponse> future = promise->get_future();
+    submit([promise](const ProtocolResponse& response) {
+        promise->set_value(response);
+    });
+    if (future.wait_for(std::chrono::duration<double>(timeoutSeconds)) != std::future_status::ready) {
+        throw TimeoutException("No response within " + std::to_string(timeoutSeconds) + " s.");
+    }
+    return future.get();
+}
+
+/**
+ * @brief Hands a vector to NumPy without copying; the array owns the vector from then on.
+ * @param values The values to expose.
+ * @return A one-dimensional NumPy array viewing the vector's storage.
+ */
+template <typename T>
+py::array_t<T> toArray(std::vector<T>&& values) {
+    auto* owned = new std::vector<T>(std::move(values));
+    py::capsule owner(owned, [](void* pointer) {
+        delete static_cast<std::vector<T>*>(pointer);
+    });
+    return py::array_t<T>({static_cast<py::ssize_t>(owned->size())}, {static_cast<py::ssize_t>(sizeof(T))},
+                          owned->data(), owner);
+}
+
+/**
+ * @brief Creates a read-only NumPy view of library memory.
+ * @param data The first element.
+ * @param size The number of elements.
+ * @param base The Python object that keeps the memory alive.
+ * @return The view.
+ */
+template <typename T>
+py::array_t<T> viewArray(const T* data, std::size_t size, py::handle base) {
+    py::array_t<T> view({static_cast<py::ssize_t>(size)}, {static_cast<py::ssize_t>(sizeof(T))}, data, base);
+    view.attr("setflags")(py::arg("write") = false);
+    return view;
+}
+
+/**
+ * @class ControllerSession
+ * @brief Owns the full client stack for one controller and the thread running its I/O context.
+ */
+class ControllerSession {
+public:
+    ControllerSession(const std::string& host, const std::string& port, std::size_t historyCapacity)
+        : workGuard_(boost::asio::make_work_guard(ioContext_)),
+          history_(historyCapacity) {
+        auto client = std::make_shared<TcpClient>(ioContext_, host, port);
+        client->connect(host, port);
+        axisState_ = std::make_shared<AxisState>();
+        history_.attach(*axisState_);
+        statistics_.attach(*axisState_);
+        downsampler_.attach(*axisState_);
+        controller_ = std::make_shared<KohzuController>(std::make_shared<ProtocolHandler>(client), axisState_);
+        controller_->start();
+        ioThread_ = std::thread([this] { ioContext_.run(); });
+    }
+
+    ~ControllerSession() {
+        // Joining the I/O thread must not hold the GIL, or a pending Python callback would deadlock.
+        if (PyGILState_Check()) {
+            py::gil_scoped_release release;
+            close();
+        } else {
+            close();
+        }
+    }
+
+    void close() {
+        if (closed_) {
+            return;
+        }
+        closed_ = true;
+        // Drain while the I/O thread still runs, so replies in flight can arrive before the socket closes.
+        controller_->shutdown(std::chrono::milliseconds(kCloseDrainMs));
+        workGuard_.reset();
+        ioContext_.stop();
+        if (ioThread_.joinable()) {
+            ioThread_.join();
+        }
+    }
+
+    KohzuController& controller() { return *controller_; }
+    AxisState& axisState() { return *axisState_; }
+    SampleHistory& history() { return history_; }
+    AxisStatistics& statistics() { return statistics_; }
+    TelemetryDownsampler& downsampler() { return downsampler_; }
+
+private:
+    boost::asio::io_context ioContext_;
+    boost::asio::executor_work_guard<boost::asio::io_context::executor_type> workGuard_;
+    std::thread ioThread_;
+    std::shared_ptr<AxisState> axisState_;
+    std::shared_ptr<KohzuController> controller_;
+    SampleHistory history_;
+    AxisStatistics statistics_;
+    TelemetryDownsampler downsampler_;
+    bool closed_ = false;
+    static constexpr int kCloseDrainMs = 1000;
+};
+
+} // namespace
+
+PYBIND11_MODULE(kohzu, m) {
+    m.doc() = "Python bindings for the kohzu-controller library";
+
+    PYBIND11_NUMPY_DTYPE(AxisSample, timestampNs, axisNo, position, statusWord, hasPosition, positionUpdated);
+    PYBIND11_NUMPY_DTYPE(DownsampleBucket, startNs, min, max, last, count, sum);
+
+    py::register_exception<ConnectionException>(m, "ConnectionError", PyExc_ConnectionError);
+    py::register_exception<ProtocolException>(m, "ProtocolError", PyExc_RuntimeError);
+    py::register_exception<TimeoutException>(m, "TimeoutError", PyExc_TimeoutError);
+
+    py::class_<AxisStatus>(m, "AxisStatus")
+        .def_readonly("driving_state", &AxisStatus::drivingState)
+        .def_readonly("emg_signal", &AxisStatus::emgSignal)
+        .def_readonly("org_norg_signal", &AxisStatus::orgNorgSignal)
+        .def_readonly("cw_ccw_limit_signal", &AxisStatus::cwCcwLimitSignal)
+        .def_readonly("soft_limit_state", &AxisStatus::softLimitState)
+        .def_readonly("correction_allowable_range", &AxisStatus::correctionAllowableRange)
+        .def_static("from_word", &AxisStatus::fromWord);
+
+    py::class_<ProtocolResponse>(m, "ProtocolResponse")
+        .def_property_readonly("status", [](const ProtocolResponse& r) { return std::string(1, r.status); })
+        .def_readonly("axis_no", &ProtocolResponse::axisNo)
+        .def_readonly("command", &ProtocolResponse::command)
+        .def_readonly("params", &ProtocolResponse::params)
+        .def_readonly("full_response", &ProtocolResponse::fullResponse);
+
+    // A handle refers to its ProtocolHandler by pointer, so each one returned keeps its Controller alive.
+    py::class_<CommandHandle>(m, "CommandHandle")
+        .def("cancel", &CommandHandle::cancel, py::call_guard<py::gil_scoped_release>(),
+             "Withdraws the command's callback if its reply has not been handled yet; returns True if it was.")
+        .def_property_readonly("valid", &CommandHandle::valid);
+
+    py::class_<AxisStatisticsSnapshot>(m, "AxisStatistics")
+        .def_readonly("sample_count", &AxisStatisticsSnapshot::sampleCount)
+        .def_readonly("move_count", &AxisStatisticsSnapshot::moveCount)
+        .def_readonly("total_travel", &AxisStatisticsSnapshot::totalTravel)
+        .def_readonly("total_move_duration_ns", &AxisStatisticsSnapshot::totalMoveDurationNs)
+        .def_readonly("last_move_duration_ns", &AxisStatisticsSnapshot::lastMoveDurationNs)
+        .def_readonly("max_move_duration_ns", &AxisStatisticsSnapshot::maxMoveDurationNs)
+        .def_readonly("last_overshoot", &AxisStatisticsSnapshot::lastOvershoot)
+        .def_readonly("max_overshoot", &AxisStatisticsSnapshot::maxOvershoot)
+        .def_readonly("time_in_limit_ns", &AxisStatisticsSnapshot::timeInLimitNs)
+        .def_readonly("is_moving", &AxisStatisticsSnapshot::isMoving)
+        .def_property_readonly("mean_move_duration_ns", &AxisStatisticsSnapshot::meanMoveDurationNs);
+
+    py::class_<ControllerSession>(m, "Controller")
+        .def(py::init<const std::string&, const std::string&, std::size_t>(),
+             py::arg("host"), py::arg("port") = "12321", py::arg("history_capacity") = 65536,
+             py::call_guard<py::gil_scoped_release>())
+        .def("close", &ControllerSession::close, py::call_guard<py::gil_scoped_release>())
+        .def("start_monitoring", [](ControllerSession& s, const std::vector<int>& axes, int periodMs) {
+                 s.controller().startMonitoring(axes, periodMs);
+             }, py::arg("axes"), py::arg("period_ms") = 100, py::call_guard<py::gil_scoped_release>())
+        .def("stop_monitoring", [](ControllerSession& s) { s.controller().stopMonitoring(); },
+             py::call_guard<py::gil_scoped_release>())
+        .def("add_axis_to_monitor", [](ControllerSession& s, int axisNo) { s.controller().addAxisToMonitor(axisNo); })
+        .def("remove_axis_to_monitor", [](ControllerSession& s, int axisNo) { s.controller().removeAxisToMonitor(axisNo); })
+        .def("move_absolute", [](ControllerSession& s, int axisNo, int position, int speed, int responseType, py::object callback) {
+                 return s.controller().moveAbsolute(axisNo, position, speed, responseType, wrapCallback(std::move(callback)));
+             }, py::arg("axis"), py::arg("position"), py::arg("speed") = 0, py::arg("response_type") = 0,
+             py::arg("callback") = py::none(), py::keep_alive<0, 1>())
+        .def("move_relative", [](ControllerSession& s, int axisNo, int distance, int speed, int responseType, py::object callback) {
+                 return s.controller().moveRelative(axisNo, distance, speed, responseType, wrapCallback(std::move(callback)));
+             }, py::arg("axis"), py::arg("distance"), py::arg("speed") = 0, py::arg("response_type") = 0,
+             py::arg("callback") = py::none(), py::keep_alive<0, 1>())
+        .def("move_origin", [](ControllerSession& s, int axisNo, int speed, int responseType, py::object callback) {
+                 return s.controller().moveOrigin(axisNo, speed, responseType, wrapCallback(std::move(callback)));
+             }, py::arg("axis"), py::arg("speed") = 0, py::arg("response_type") = 0, py::arg("callback") = py::none(),
+             py::keep_alive<0, 1>())
+        .def("set_system", [](ControllerSession& s, int axisNo, int systemNo, int value, py::object callback) {
+                 return s.controller().setSystem(axisNo, systemNo, value, wrapCallback(std::move(callback)));
+             }, py::arg("axis"), py::arg("system_no"), py::arg("value"), py::arg("callback") = py::none(),
+             py::keep_alive<0, 1>())
+        .def("move_absolute_wait", [](ControllerSession& s, int axisNo, int position, int speed, int responseType, double timeout) {
+                 return submitAndWait([&](ResponseCallback done) {
+                     s.controller().moveAbsolute(axisNo, position, speed, responseType, std::move(done));
+                 }, timeout);
+             }, py::arg("axis"), py::arg("position"), py::arg("speed") = 0, py::arg("response_type") = 0,
+             py::arg("timeout") = 60.0, py::call_guard<py::gil_scoped_release>())
+        .def("move_relative_wait", [](ControllerSession& s, int axisNo, int distance, int speed, int responseType, double timeout) {
+                 return submitAndWait([&](ResponseCallback done) {
+                     s.controller().moveRelative(axisNo, distance, speed, responseType, std::move(done));
+                 }, timeout);
+             }, py::arg("axis"), py::arg("distance"), py::arg("speed") = 0, py::arg("response_type") = 0,
+             py::arg("timeout") = 60.0, py::call_guard<py::gil_scoped_release>())
+        .def("move_origin_wait", [](ControllerSession& s, int axisNo, int speed, int responseType, double timeout) {
+                 return submitAndWait([&](ResponseCallback done) {
+                     s.controller().moveOrigin(axisNo, speed, responseType, std::move(done));
+                 }, timeout);
+             }, py::arg("axis"), py::arg("speed") = 0, py::arg("response_type") = 0, py::arg("timeout") = 120.0,
+             py::call_guard<py::gil_scoped_release>())
+        .def("get_position", [](ControllerSession& s, int axisNo) { return s.axisState().getPosition(axisNo); })
+        .def("get_status", [](ControllerSession& s, int axisNo) { return s.axisState().getStatusDetails(axisNo); })
+        .def("any_moving", [](ControllerSession& s) { return s.axisState().anyMoving(); })
+        .def("any_limit_or_emg", [](ControllerSession& s) { return s.axisState().anyLimitOrEmg(); })
+        .def("all_homed", [](ControllerSession& s) { return s.axisState().allHomed(); })
+        .def("statistics", [](ControllerSession& s, int axisNo) { return s.statistics().snapshot(axisNo); })
+        .def("history", [](py::object self, int axisNo) {
+                 // Zero-copy views into the history ring; the arrays keep the session alive.
+                 SampleHistoryWindow window = self.cast<ControllerSession&>().history().window(axisNo);
+                 py::dict result;
+                 result["timestamps_ns"] = viewArray(window.timestampsNs, window.size, self);
+                 result["positions"] = viewArray(window.positions, window.size, self);
+                 result["status_words"] = viewArray(window.statusWords, window.size, self);
+                 result["has_position"] = viewArray(reinterpret_cast<const bool*>(window.hasPositions), window.size, self);
+                 result["total_samples"] = window.totalSamples;
+                 return result;
+             }, py::arg("axis"),
+             "Returns read-only NumPy views of the latest samples of an axis. The views are live: newer samples\n"
+             "overwrite the oldest entries, so compare 'total_samples' with history_total() or copy the arrays.")
+        .def("history_total", [](ControllerSession& s, int axisNo) { return s.history().totalSamples(axisNo); })
+        .def("buckets", [](ControllerSession& s, int axisNo, std::int64_t startNs, std::int64_t endNs, std::size_t maxPoints) {
+                 std::vector<DownsampleBucket> buckets;
+                 TelemetryDownsampler& downsampler = s.downsampler();
+                 downsampler.getBuckets(axisNo, downsampler.selectLevel(startNs, endNs, maxPoints), startNs, endNs, buckets);
+                 return toArray(std::move(buckets));
+             }, py::arg("axis"), py::arg("start_ns"), py::arg("end_ns"), py::arg("max_points") = 500);
+
+    py::class_<TelemetryReader>(m, "TelemetryReader")
+        .def(py::init<std::string>(), py::arg("directory"))
+        .def("query", [](TelemetryReader& reader, std::int64_t startNs, std::int64_t endNs, py::object axes) {
+                 TelemetryQuery query;
+                 query.startNs = startNs;
+                 query.endNs = endNs;
+                 if (!axes.is_none()) {
+                     query.selectAxes(axes.cast<std::vector<int>>());
+                 }
+                 std::vector<AxisSample> samples;
+                 {
+                     py::gil_scoped_release release;
+                     reader.query(query, samples);
+                 }
+                 return toArray(std::move(samples));
+             }, py::arg("start_ns") = INT64_MIN, py::arg("end_ns") = INT64_MAX, py::arg("axes") = py::none());
+}
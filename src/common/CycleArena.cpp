@@ -0,0 +1,56 @@
+#include "common/CycleArena.h"
+#include "common/RealtimeProfile.h"
+
+/**
+ * @brief Constructor for the CycleArena class.
+ * @param capacity The size of the preallocated buffer in bytes.
+ */
+CycleArena::CycleArena(std::size_t capacity)
+    : capacity_(capacity > 0 ? capacity : 1),
+      buffer_(new std::byte[capacity_]),
+      resource_(buffer_.get(), capacity_, &overflow_) {}
+
+/**
+ * @brief Releases everything allocated since the last reset.
+ */
+void CycleArena::reset() {
+    // Rewinds to the start of the initial buffer; only overflow chunks are returned to the heap.
+    resource_.release();
+}
+
+/**
+ * @brief Touches every page of the preallocated buffer so the first cycles do not page-fault.
+ */
+void CycleArena::prefault() {
+    RealtimeProfile::prefault(buffer_.get(), capacity_);
+}
+
+/**
+ * @brief Allocates memory from the heap when the arena buffer is exhausted.
+ * @param bytes The number of bytes.
+ * @param alignment The required alignment.
+ * @return The allocated memory.
+ */
+void* CycleArena::OverflowResource::do_allocate(std::size_t bytes, std::size_t alignment) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+}
+
+/**
+ * @brief Returns overflow memory to the heap.
+ * @param pointer The memory to free.
+ * @param bytes The number of bytes.
+ * @param alignment The alignment used for the allocation.
+ */
+void CycleArena::OverflowResource::do_deallocate(void* pointer, std::size_t bytes, std::size_t alignment) {
+    std::pmr::new_delete_resource()->deallocate(pointer, bytes, alignment);
+}
+
+/**
+ * @brief Compares two resources for interchangeability.
+ * @param other The other resource.
+ * @return True only for the same object.
+ */
+bool CycleArena::OverflowResource::do_is_equal(const std::pmr::memory_resource& other) const noexcept {
+    return this == &other;
+}
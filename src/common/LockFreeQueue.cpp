@@ -0,0 +1,2 @@
+#include "common/LockFreeQueue.h"
+// Implementation is included in the header file as it's a template class.
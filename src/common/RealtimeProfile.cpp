@@ -0,0 +1,231 @@
+#include "common/RealtimeProfile.h"
+#include "spdlog/spdlog.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <new>
+
+#if defined(__linux__)
+#include <alloca.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+namespace {
+
+#if defined(__linux__)
+std::size_t pageSize() {
+    static const std::size_t size = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+    return size;
+}
+
+/**
+ * @brief Returns how much of the calling thread's stack can safely be touched.
+ * @return The usable stack size in bytes, or 0 if unknown.
+ */
+std::size_t usableStackBytes() {
+    pthread_attr_t attr;
+    if (pthread_getattr_np(pthread_self(), &attr) != 0) {
+        return 0;
+    }
+    void* stackAddress = nullptr;
+    std::size_t stackSize = 0;
+    pthread_attr_getstack(&attr, &stackAddress, &stackSize);
+    pthread_attr_destroy(&attr);
+    // Leave room for the frames already on the stack and for the guard page.
+    constexpr std::size_t reserve = 64 * 1024;
+    return stackSize > reserve ? stackSize - reserve : 0;
+}
+
+/**
+ * @brief Grows the stack by the given amount and touches every page of it.
+ * @param bytes The number of bytes to touch.
+ */
+__attribute__((noinline)) void prefaultStack(std::size_t bytes) {
+    auto* stack = static_cast<unsigned char*>(alloca(bytes));
+    RealtimeProfile::prefault(stack, bytes);
+    // Keep the compiler from dropping the allocation.
+    asm volatile("" : : "r"(stack) : "memory");
+}
+#endif
+
+} // namespace
+
+/**
+ * @brief Writes the report to the log.
+ */
+void RealtimeReport::log() const {
+    spdlog::info("Realtime profile: memory {}, {} KiB heap pre-faulted.",
+                 memoryLocked ? "locked" : "not locked", heapPrefaultedBytes / 1024);
+    for (const std::string& fallback : fallbacks) {
+        spdlog::warn("Realtime profile fallback: {}", fallback);
+    }
+    for (const RealtimeThreadResult& thread : threads) {
+        spdlog::info("Realtime profile {}: {}, {}, {} KiB stack pre-faulted.", thread.name,
+                     thread.realtimeScheduling ? "SCHED_FIFO" : "default scheduling",
+                     thread.pinned ? "pinned" : "not pinned", thread.stackPrefaultedBytes / 1024);
+        for (const std::string& fallback : thread.fallbacks) {
+            spdlog::warn("Realtime profile {} fallback: {}", thread.name, fallback);
+        }
+    }
+}
+
+/**
+ * @brief Constructor for the RealtimeProfile class.
+ * @param config The profile settings.
+ */
+RealtimeProfile::RealtimeProfile(RealtimeProfileConfig config)
+    : config_(std::move(config)) {}
+
+/**
+ * @brief Applies the process-wide settings (memory locking and heap pre-faulting).
+ */
+void RealtimeProfile::applyProcess() {
+    if (!config_.lockMemory) {
+        return;
+    }
+    bool locked = false;
+    std::size_t heapBytes = 0;
+    std::vector<std::string> fallbacks;
+#if defined(__linux__)
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) == 0) {
+        locked = true;
+    } else {
+        fallbacks.push_back(std::string("mlockall failed: ") + std::strerror(errno));
+    }
+#if defined(__GLIBC__)
+    // Keep freed memory mapped so later allocations reuse pre-faulted pages
+    // instead of taking fresh faults from new mmaps or a regrown heap.
+    mallopt(M_TRIM_THRESHOLD, -1);
+    mallopt(M_MMAP_MAX, 0);
+#endif
+    if (config_.heapPrefaultBytes > 0) {
+        std::unique_ptr<unsigned char[]> heap(new (std::nothrow) unsigned char[config_.heapPrefaultBytes]);
+        if (heap) {
+            prefault(heap.get(), config_.heapPrefaultBytes);
+            heapBytes = config_.heapPrefaultBytes;
+        } else {
+            fallbacks.push_back("heap pre-fault allocation failed");
+        }
+    }
+#else
+    fallbacks.push_back("memory locking is not supported on this platform");
+#endif
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    report_.memoryLocked = locked;
+    report_.heapPrefaultedBytes = heapBytes;
+    report_.fallbacks.insert(report_.fallbacks.end(), fallbacks.begin(), fallbacks.end());
+}
+
+/**
+ * @brief Applies the I/O thread settings to the calling thread.
+ * @param name The thread name.
+ */
+void RealtimeProfile::applyIoThread(const std::string& name) {
+    applyThread(name, config_.ioThread);
+}
+
+/**
+ * @brief Applies the monitoring thread settings to the calling thread.
+ * @param name The thread name.
+ */
+void RealtimeProfile::applyMonitorThread(const std::string& name) {
+    applyThread(name, config_.monitorThread);
+}
+
+/**
+ * @brief Returns a copy of what has been applied so far.
+ * @return The report.
+ */
+RealtimeReport RealtimeProfile::report() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return report_;
+}
+
+/**
+ * @brief Touches every page of a buffer so later accesses do not fault.
+ * @param data The buffer.
+ * @param bytes The size of the buffer in bytes.
+ */
+void RealtimeProfile::prefault(void* data, std::size_t bytes) {
+    if (!data || bytes == 0) {
+        return;
+    }
+#if defined(__linux__)
+    const std::size_t step = pageSize();
+#else
+    const std::size_t step = 4096;
+#endif
+    volatile unsigned char* bytesPtr = static_cast<volatile unsigned char*>(data);
+    for (std::size_t offset = 0; offset < bytes; offset += step) {
+        bytesPtr[offset] = bytesPtr[offset];
+    }
+    bytesPtr[bytes - 1] = bytesPtr[bytes - 1];
+}
+
+/**
+ * @brief Applies one thread's settings to the calling thread and records the result.
+ * @param name The thread name.
+ * @param config The thread settings.
+ */
+void RealtimeProfile::applyThread(const std::string& name, const RealtimeThreadConfig& config) {
+    if (!config.enabled) {
+        return;
+    }
+    RealtimeThreadResult result;
+    result.name = name;
+#if defined(__linux__)
+    // Linux limits thread names to 15 characters.
+    pthread_setname_np(pthread_self(), name.substr(0, 15).c_str());
+
+    if (!config.cpus.empty()) {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        for (int cpu : config.cpus) {
+            if (cpu >= 0 && cpu < CPU_SETSIZE) {
+                CPU_SET(cpu, &cpus);
+            }
+        }
+        const int error = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+        if (error == 0) {
+            result.pinned = true;
+        } else {
+            result.fallbacks.push_back(std::string("CPU pinning failed: ") + std::strerror(error));
+        }
+    }
+
+    sched_param param{};
+    param.sched_priority = std::clamp(config.priority, sched_get_priority_min(SCHED_FIFO), sched_get_priority_max(SCHED_FIFO));
+    const int error = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+    if (error == 0) {
+        result.realtimeScheduling = true;
+    } else {
+        result.fallbacks.push_back(std::string("SCHED_FIFO priority ") + std::to_string(param.sched_priority) +
+                                   " not applied: " + std::strerror(error));
+    }
+
+    const std::size_t stackBytes = std::min(config.stackPrefaultBytes, usableStackBytes());
+    if (stackBytes > 0) {
+        prefaultStack(stackBytes);
+        result.stackPrefaultedBytes = stackBytes;
+    }
+#else
+    result.fallbacks.push_back("real-time scheduling is not supported on this platform");
+#endif
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = std::find_if(report_.threads.begin(), report_.threads.end(),
+                           [&name](const RealtimeThreadResult& thread) { return thread.name == name; });
+    if (it != report_.threads.end()) {
+        *it = std::move(result);
+    } else {
+        report_.threads.push_back(std::move(result));
+    }
+}
@@ -1,6 +1,249 @@
 #include "controller/AxisState.h"
+#include "protocol/ProtocolError.h"
+#include "protocol/LatencyEstimator.h"
 #include <stdexcept>
 #include "spdlog/spdlog.h"
+#include <chrono>
+#include <algorithm>
+
+/**
+ * @brief Packs the status fields into a single word, 4 bits per field in declaration order.
+ * @return The packed status word.
+ */
+std::uint32_t AxisStatus::toWord() const {
+    return (static_cast<std::uint32_t>(drivingState) & 0xF)
+         | (static_cast<std::uint32_t>(emgSignal) & 0xF) << 4
+         | (static_cast<std::uint32_t>(orgNorgSignal) & 0xF) << 8
+         | (static_cast<std::uint32_t>(cwCcwLimitSignal) & 0xF) << 12
+         | (static_cast<std::uint32_t>(softLimitState) & 0xF) << 16
+         | (static_cast<std::uint32_t>(correctionAllowableRange) & 0xF) << 20;
+}
+
+/**
+ * @brief Unpacks a status word produced by toWord().
+ * @param word The packed status word.
+ * @return The unpacked AxisStatus structure.
+ */
+AxisStatus AxisStatus::fromWord(std::uint32_t word) {
+    AxisStatus status;
+    status.drivingState = static_cast<int>(word & 0xF);
+    status.emgSignal = static_cast<int>((word >> 4) & 0xF);
+    status.orgNorgSignal = static_cast<int>((word >> 8) & 0xF);
+    status.cwCcwLimitSignal = static_cast<int>((word >> 12) & 0xF);
+    status.softLimitState = static_cast<int>((word >> 16) & 0xF);
+    status.correctionAllowableRange = static_cast<int>((word >> 20) & 0xF);
+    return status;
+}
+
+namespace {
+
+/**
+ * @brief Parses the six status fields of an STR response.
+ * @param axisNo The axis number, for logging.
+ * @param params The response parameters.
+ * @param status Receives the parsed status.
+ * @return True if the parameters were valid.
+ */
+bool parseStatus(int axisNo, const std::vector<std::string>& params, AxisStatus& status) {
+    if (params.size() < 6) {
+        spdlog::warn("Received insufficient status parameters for axis {}. Expected at least 6, got {}.", axisNo, params.size());
+        return false;
+    }
+    int* fields[] = {
+        &status.drivingState, &status.emgSignal, &status.orgNorgSignal,
+        &status.cwCcwLimitSignal, &status.softLimitState, &status.correctionAllowableRange
+    };
+    for (std::size_t i = 0; i < 6; ++i) {
+        if (std::error_code error = parseInteger(params[i], *fields[i])) {
+            spdlog::error("Failed to parse status parameters for axis {}: {}", axisNo, error.message());
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Returns the AxisCondition bits a status reports (all but conditionHomed).
+ */
+std::uint8_t statusConditions(const AxisStatus& status) {
+    std::uint8_t conditions = 0;
+    if (status.drivingState != 0) {
+        conditions |= conditionMoving;
+    }
+    if (status.emgSignal != 0 || status.cwCcwLimitSignal != 0 || status.softLimitState != 0) {
+        conditions |= conditionLimitOrEmg;
+    }
+    return conditions;
+}
+
+constexpr std::uint8_t kStatusConditions = conditionMoving | conditionLimitOrEmg;
+
+std::uint64_t packAggregates(const AxisAggregates& counts) {
+    return static_cast<std::uint64_t>(counts.axes & 0xFFFF)
+         | static_cast<std::uint64_t>(counts.moving & 0xFFFF) << 16
+         | static_cast<std::uint64_t>(counts.limitOrEmg & 0xFFFF) << 32
+         | static_cast<std::uint64_t>(counts.homed & 0xFFFF) << 48;
+}
+
+/**
+ * @brief Returns the index of a condition's bitset: its bit position.
+ * @throws std::invalid_argument if condition is not exactly one AxisCondition.
+ */
+int conditionIndex(AxisCondition condition) {
+    switch (condition) {
+    case conditionMoving:
+        return 0;
+    case conditionLimitOrEmg:
+        return 1;
+    case conditionHomed:
+        return 2;
+    }
+    throw std::invalid_argument("Unknown axis condition " + std::to_string(static_cast<int>(condition)) + ".");
+}
+
+} // namespace
+
+/**
+ * @brief Adds a position update.
+ * @param axisNo The axis number.
+ * @param position The new position value.
+ * @param timestampNs When the position was read, or 0 for the time the batch is applied.
+ */
+void AxisUpdateBatch::addPosition(int axisNo, int position, std::int64_t timestampNs) {
+    Update update;
+    update.axisNo = axisNo;
+    update.position = position;
+    update.timestampNs = timestampNs;
+    updates_.push_back(update);
+}
+
+/**
+ * @brief Parses and adds a status update from the parameters of an STR response.
+ * @param axisNo The axis number.
+ * @param params A vector of strings containing status parameters.
+ * @param timestampNs When the status was read, or 0 for the time the batch is applied.
+ * @return True if the parameters were valid and the update was added.
+ */
+bool AxisUpdateBatch::addStatus(int axisNo, const std::vector<std::string>& params, std::int64_t timestampNs) {
+    Update update;
+    if (!parseStatus(axisNo, params, update.status)) {
+        return false;
+    }
+    update.axisNo = axisNo;
+    update.isStatus = true;
+    update.timestampNs = timestampNs;
+    updates_.push_back(update);
+    return true;
+}
+
+/**
+ * @brief Registers a listener that receives a sample after every position or status update.
+ * @param listener The function to be called with each new sample.
+ */
+void AxisState::addSampleListener(SampleListener listener) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    sampleListeners_.push_back(std::move(listener));
+}
+
+/**
+ * @brief Registers a listener that receives all samples of an update in one call.
+ * @param listener The function to be called with the samples of each update.
+ */
+void AxisState::addSampleBatchListener(SampleBatchListener listener) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    sampleBatchListeners_.push_back(std::move(listener));
+}
+
+/**
+ * @brief Publishes the sample of a single update.
+ *
+ * Must be called with mutex_ held.
+ * @param axisNo The axis number.
+ * @param timestampNs The sample time, or 0 for the current time.
+ * @param positionUpdated True if the update is a position reading.
+ */
+void AxisState::publishSample(int axisNo, std::int64_t timestampNs, bool positionUpdated) {
+    version_.fetch_add(1, std::memory_order_release);
+    pendingSamples_.clear();
+    AxisSample sample;
+    sample.axisNo = axisNo;
+    sample.timestampNs = timestampNs;
+    sample.positionUpdated = positionUpdated;
+    pendingSamples_.push_back(sample);
+    publishSamples();
+}
+
+/**
+ * @brief Fills the samples in pendingSamples_ from the cached state and hands them to every listener.
+ *
+ * Must be called with mutex_ held. Each sample's axisNo and timestampNs must be set.
+ */
+void AxisState::publishSamples() {
+    if (sampleListeners_.empty() && sampleBatchListeners_.empty()) {
+        return;
+    }
+    std::int64_t nowNs = 0;
+    for (AxisSample& sample : pendingSamples_) {
+        if (sample.timestampNs == 0) {
+            if (nowNs == 0) {
+                nowNs = wallClockNs();
+            }
+            sample.timestampNs = nowNs;
+        }
+        auto positionIt = positions_.find(sample.axisNo);
+        sample.hasPosition = positionIt != positions_.end();
+        sample.position = sample.hasPosition ? positionIt->second : -1;
+        auto statusIt = statuses_.find(sample.axisNo);
+        sample.statusWord = statusIt != statuses_.end() ? statusIt->second.toWord() : 0;
+    }
+    for (const auto& listener : sampleListeners_) {
+        for (const AxisSample& sample : pendingSamples_) {
+            listener(sample);
+        }
+    }
+    for (const auto& listener : sampleBatchListeners_) {
+        listener(pendingSamples_);
+    }
+}
+
+/**
+ * @brief Stores every update of a batch under one lock and notifies the listeners once.
+ * @param batch The collected updates.
+ */
+void AxisState::apply(const AxisUpdateBatch& batch) {
+    if (batch.empty()) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    pendingSamples_.clear();
+    for (const AxisUpdateBatch::Update& update : batch.updates_) {
+        if (update.isStatus) {
+            statuses_[update.axisNo] = update.status;
+            updateConditions(update.axisNo, statusConditions(update.status), kStatusConditions);
+        } else {
+            positions_[update.axisNo] = update.position;
+        }
+        // One sample per axis; a batch touches a handful of axes, so a linear search is enough.
+        auto it = std::find_if(pendingSamples_.begin(), pendingSamples_.end(),
+                               [&update](const AxisSample& sample) { return sample.axisNo == update.axisNo; });
+        if (it == pendingSamples_.end()) {
+            AxisSample sample;
+            sample.axisNo = update.axisNo;
+            sample.timestampNs = update.timestampNs;
+            sample.positionUpdated = !update.isStatus;
+            pendingSamples_.push_back(sample);
+        } else if (!update.isStatus && !it->positionUpdated) {
+            // The sample's position is the one read, so it carries the time of that reading.
+            it->timestampNs = update.timestampNs;
+            it->positionUpdated = true;
+        } else if (update.isStatus == !it->positionUpdated) {
+            it->timestampNs = std::max(it->timestampNs, update.timestampNs);
+        }
+    }
+    version_.fetch_add(1, std::memory_order_release);
+    spdlog::debug("Applied {} updates to {} axes.", batch.size(), pendingSamples_.size());
+    publishSamples();
+}
 
 /**
  * @brief Updates the current position of a specific axis in a thread-safe manner.
@@ -8,9 +251,20 @@
  * @param position The new position value.
  */
 void AxisState::updatePosition(int axisNo, int position) {
+    updatePosition(axisNo, position, 0);
+}
+
+/**
+ * @brief Updates the current position of a specific axis, stamping the sample with a known time.
+ * @param axisNo The axis number.
+ * @param position The new position value.
+ * @param timestampNs When the position was read, or 0 for the current time.
+ */
+void AxisState::updatePosition(int axisNo, int position, std::int64_t timestampNs) {
     std::lock_guard<std::mutex> lock(mutex_);
     positions_[axisNo] = position;
     spdlog::debug("Position for axis {} updated to {}", axisNo, position);
+    publishSample(axisNo, timestampNs, true);
 }
 
 /**
@@ -19,24 +273,131 @@ void AxisState::updatePosition(int axisNo, int position) {
  * @param params A vector of strings containing status parameters.
  */
 void AxisState::updateStatus(int axisNo, const std::vector<std::string>& params) {
-    if (params.size() < 6) {
-        spdlog::warn("Received insufficient status parameters for axis {}. Expected at least 6, got {}.", axisNo, params.size());
+    updateStatus(axisNo, params, 0);
+}
+
+/**
+ * @brief Updates the detailed status of a specific axis, stamping the sample with a known time.
+ * @param axisNo The axis number.
+ * @param params A vector of strings containing status parameters.
+ * @param timestampNs When the status was read, or 0 for the current time.
+ */
+void AxisState::updateStatus(int axisNo, const std::vector<std::string>& params, std::int64_t timestampNs) {
+    AxisStatus newStatus;
+    if (!parseStatus(axisNo, params, newStatus)) {
         return;
     }
     std::lock_guard<std::mutex> lock(mutex_);
-    AxisStatus newStatus;
-    try {
-        newStatus.drivingState = std::stoi(params[0]);
-        newStatus.emgSignal = std::stoi(params[1]);
-        newStatus.orgNorgSignal = std::stoi(params[2]);
-        newStatus.cwCcwLimitSignal = std::stoi(params[3]);
-        newStatus.softLimitState = std::stoi(params[4]);
-        newStatus.correctionAllowableRange = std::stoi(params[5]);
-        statuses_[axisNo] = newStatus;
-        spdlog::debug("Status for axis {} updated.", axisNo);
-    } catch (const std::exception& e) {
-        spdlog::error("Failed to parse status parameters for axis {}: {}", axisNo, e.what());
+    statuses_[axisNo] = newStatus;
+    updateConditions(axisNo, statusConditions(newStatus), kStatusConditions);
+    spdlog::debug("Status for axis {} updated.", axisNo);
+    publishSample(axisNo, timestampNs, false);
+}
+
+/**
+ * @brief Records the conditions of an axis and adjusts the aggregates and bitsets by the change.
+ *
+ * Must be called with mutex_ held; writers are serialized, readers only load.
+ * @param axisNo The axis number.
+ * @param conditions The new AxisCondition bits.
+ * @param mask The bits of conditions that are being set; the others keep their value.
+ */
+void AxisState::updateConditions(int axisNo, std::uint8_t conditions, std::uint8_t mask) {
+    auto [it, inserted] = conditions_.try_emplace(axisNo, 0);
+    if (inserted && conditions_.size() > static_cast<std::size_t>(kMaxAggregateAxes)) {
+        // One more axis would wrap the 16-bit counts; it stays out of the aggregates instead.
+        conditions_.erase(it);
+        spdlog::error("Axis {} not counted in the aggregates: more than {} axes.", axisNo, kMaxAggregateAxes);
+        return;
+    }
+    const std::uint8_t previous = it->second;
+    const std::uint8_t current = static_cast<std::uint8_t>((previous & ~mask) | (conditions & mask));
+    const std::uint8_t changed = previous ^ current;
+    if (!inserted && changed == 0) {
+        return;
+    }
+    it->second = current;
+
+    AxisAggregates counts = aggregates();
+    counts.axes += inserted ? 1 : 0;
+    std::uint32_t* const lanes[kConditionCount] = {&counts.moving, &counts.limitOrEmg, &counts.homed};
+    for (int i = 0; i < kConditionCount; ++i) {
+        const std::uint8_t bit = static_cast<std::uint8_t>(1u << i);
+        if (!(changed & bit)) {
+            continue;
+        }
+        *lanes[i] += (current & bit) ? 1 : static_cast<std::uint32_t>(-1);
+        if (axisNo >= 0 && axisNo < kMaxConditionAxes) {
+            std::atomic<std::uint64_t>& word = conditionBits_[i][static_cast<std::size_t>(axisNo) / 64];
+            const std::uint64_t axisBit = std::uint64_t{1} << (axisNo % 64);
+            if (current & bit) {
+                word.fetch_or(axisBit, std::memory_order_release);
+            } else {
+                word.fetch_and(~axisBit, std::memory_order_release);
+            }
+        }
     }
+    // All counts change in one store, so a reader never sees moving and homed from different updates.
+    aggregates_.store(packAggregates(counts), std::memory_order_release);
+}
+
+/**
+ * @brief Marks whether an axis has completed an origin return.
+ * @param axisNo The axis number.
+ * @param homed True once the axis is homed, false if its origin is lost.
+ */
+void AxisState::setHomed(int axisNo, bool homed) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    updateConditions(axisNo, homed ? conditionHomed : 0, conditionHomed);
+    spdlog::debug("Axis {} marked {}.", axisNo, homed ? "homed" : "not homed");
+}
+
+/**
+ * @brief Returns the machine-wide condition counts.
+ * @return The counts, all taken from the same update.
+ */
+AxisAggregates AxisState::aggregates() const {
+    const std::uint64_t packed = aggregates_.load(std::memory_order_acquire);
+    AxisAggregates counts;
+    counts.axes = static_cast<std::uint32_t>(packed & 0xFFFF);
+    counts.moving = static_cast<std::uint32_t>((packed >> 16) & 0xFFFF);
+    counts.limitOrEmg = static_cast<std::uint32_t>((packed >> 32) & 0xFFFF);
+    counts.homed = static_cast<std::uint32_t>((packed >> 48) & 0xFFFF);
+    return counts;
+}
+
+/**
+ * @brief Checks a condition of one axis.
+ * @param axisNo The axis number.
+ * @param condition The condition.
+ * @return True if the axis is in the condition.
+ * @throws std::invalid_argument if condition is not exactly one AxisCondition.
+ */
+bool AxisState::hasCondition(int axisNo, AxisCondition condition) const {
+    if (axisNo < 0 || axisNo >= kMaxConditionAxes) {
+        return false;
+    }
+    const std::uint64_t word = conditionBits_[conditionIndex(condition)][static_cast<std::size_t>(axisNo) / 64].load(std::memory_order_acquire);
+    return (word >> (axisNo % 64)) & 1;
+}
+
+/**
+ * @brief Lists the axes in a condition by scanning its bitset.
+ * @param condition The condition.
+ * @return The axis numbers, ascending.
+ * @throws std::invalid_argument if condition is not exactly one AxisCondition.
+ */
+std::vector<int> AxisState::axesWithCondition(AxisCondition condition) const {
+    std::vector<int> axes;
+    const auto& bits = conditionBits_[conditionIndex(condition)];
+    for (std::size_t i = 0; i < kConditionWords; ++i) {
+        std::uint64_t word = bits[i].load(std::memory_order_acquire);
+        while (word != 0) {
+            axes.push_back(static_cast<int>(i * 64) + __builtin_ctzll(word));
+            word &= word - 1; // Clear the lowest set bit
+        }
+    }
+    return axes;
 }
 
 /**
@@ -68,3 +429,32 @@ AxisStatus AxisState::getStatusDetails(int axisNo) {
     return AxisStatus();
     // Return default status if not found
 }
+
+/**
+ * @brief Caches the value of a system parameter of a specific axis in a thread-safe manner.
+ * @param axisNo The axis number.
+ * @param systemNo The system parameter number.
+ * @param value The parameter value.
+ */
+void AxisState::updateSystemParameter(int axisNo, int systemNo, int value) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    systemParameters_[{axisNo, systemNo}] = value;
+    spdlog::debug("System parameter {} for axis {} updated to {}", systemNo, axisNo, value);
+}
+
+/**
+ * @brief Retrieves the cached value of a system parameter of a specific axis in a thread-safe manner.
+ * @param axisNo The axis number.
+ * @param systemNo The system parameter number.
+ * @param value Receives the cached value.
+ * @return True if the parameter has been read before, false otherwise.
+ */
+bool AxisState::getSystemParameter(int axisNo, int systemNo, int& value) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = systemParameters_.find({axisNo, systemNo});
+    if (it == systemParameters_.end()) {
+        return false;
+    }
+    value = it->second;
+    return true;
+}
@@ -0,0 +1,121 @@
+#include "controller/AxisStatistics.h"
+#include <algorithm>
+#include <cstdlib>
+
+/**
+ * @brief Registers this object as a sample listener of the given AxisState.
+ * @param axisState The state whose updates should be accumulated.
+ */
+void AxisStatistics::attach(AxisState& axisState) {
+    axisState.addSampleListener([this](const AxisSample& sample) {
+        this->addSample(sample);
+    });
+}
+
+/**
+ * @brief Folds a sample into the statistics of its axis.
+ * @param sample The sample to accumulate.
+ */
+void AxisStatistics::addSample(const AxisSample& sample) {
+    const AxisStatus status = AxisStatus::fromWord(sample.statusWord);
+    const bool moving = status.drivingState != 0;
+    const bool inLimit = status.cwCcwLimitSignal != 0 || status.softLimitState != 0;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    Accumulator& axis = axes_[sample.axisNo];
+    AxisStatisticsSnapshot& stats = axis.stats;
+    ++stats.sampleCount;
+
+    if (axis.hasPrevious && axis.inLimit && sample.timestampNs > axis.lastTimestampNs) {
+        stats.timeInLimitNs += sample.timestampNs - axis.lastTimestampNs;
+    }
+    // A sample of an axis whose position has not been read yet carries no position to fold in.
+    if (sample.hasPosition && axis.hasPosition) {
+        stats.totalTravel += std::abs(static_cast<std::int64_t>(sample.position) - axis.lastPosition);
+    }
+
+    if (moving && !stats.isMoving) {
+        // A move starts from the last position known before the axis began driving.
+        axis.moveStartNs = sample.timestampNs;
+        axis.moveHasPosition = axis.hasPosition;
+        axis.moveStartPosition = axis.lastPosition;
+        axis.moveMinPosition = axis.lastPosition;
+        axis.moveMaxPosition = axis.lastPosition;
+    }
+    if ((moving || stats.isMoving) && sample.hasPosition) {
+        if (!axis.moveHasPosition) {
+            // No position was known when the move began; it is measured from the first one.
+            axis.moveHasPosition = true;
+            axis.moveStartPosition = sample.position;
+            axis.moveMinPosition = sample.position;
+            axis.moveMaxPosition = sample.position;
+        }
+        axis.moveMinPosition = std::min(axis.moveMinPosition, sample.position);
+        axis.moveMaxPosition = std::max(axis.moveMaxPosition, sample.position);
+    }
+    if (stats.isMoving && !moving) {
+        const std::int64_t duration = sample.timestampNs - axis.moveStartNs;
+        ++stats.moveCount;
+        stats.totalMoveDurationNs += duration;
+        stats.lastMoveDurationNs = duration;
+        stats.maxMoveDurationNs = std::max(stats.maxMoveDurationNs, duration);
+
+        // Without a final position the overshoot of the move is unknown and left out.
+        if (sample.hasPosition) {
+            const int finalPosition = sample.position;
+            int overshoot = 0;
+            if (finalPosition > axis.moveStartPosition) {
+                overshoot = axis.moveMaxPosition - finalPosition;
+            } else if (finalPosition < axis.moveStartPosition) {
+                overshoot = finalPosition - axis.moveMinPosition;
+            }
+            stats.lastOvershoot = overshoot;
+            stats.maxOvershoot = std::max(stats.maxOvershoot, overshoot);
+        }
+    }
+
+    stats.isMoving = moving;
+    axis.inLimit = inLimit;
+    axis.hasPrevious = true;
+    axis.lastTimestampNs = sample.timestampNs;
+    if (sample.hasPosition) {
+        axis.hasPosition = true;
+        axis.lastPosition = sample.position;
+    }
+}
+
+/**
+ * @brief Returns the statistics of a single axis.
+ * @param axisNo The axis number.
+ * @return The snapshot. Default-constructed if the axis has no samples.
+ */
+AxisStatisticsSnapshot AxisStatistics::snapshot(int axisNo) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = axes_.find(axisNo);
+    if (it != axes_.end()) {
+        return it->second.stats;
+    }
+    return AxisStatisticsSnapshot();
+}
+
+/**
+ * @brief Returns the statistics of every axis seen so far.
+ * @return The snapshots keyed by axis number.
+ */
+std::map<int, AxisStatisticsSnapshot> AxisStatistics::snapshotAll() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::map<int, AxisStatisticsSnapshot> result;
+    for (const auto& entry : axes_) {
+        result.emplace(entry.first, entry.second.stats);
+    }
+    return result;
+}
+
+/**
+ * @brief Clears the statistics of a single axis, e.g. after maintenance.
+ * @param axisNo The axis number.
+ */
+void AxisStatistics::reset(int axisNo) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    axes_.erase(axisNo);
+}
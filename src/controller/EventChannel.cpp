@@ -0,0 +1,115 @@
+#include "controller/EventChannel.h"
+#include "spdlog/spdlog.h"
+#include <algorithm>
+#include <cerrno>
+#include <system_error>
+
+#if defined(__linux__)
+#include <sys/eventfd.h>
+#include <unistd.h>
+#endif
+
+/**
+ * @brief Constructor for the EventChannel class.
+ * @param capacity The maximum number of undrained events.
+ */
+EventChannel::EventChannel(std::size_t capacity) : queue_(capacity) {
+#if defined(__linux__)
+    fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (fd_ < 0) {
+        throw std::system_error(errno, std::generic_category(), "eventfd");
+    }
+#else
+    throw std::system_error(std::make_error_code(std::errc::function_not_supported), "EventChannel requires eventfd");
+#endif
+}
+
+/**
+ * @brief Destructor. Closes the eventfd.
+ */
+EventChannel::~EventChannel() {
+#if defined(__linux__)
+    if (fd_ >= 0) {
+        ::close(fd_);
+    }
+#endif
+}
+
+/**
+ * @brief Queues an event and signals the descriptor.
+ * @param event The event.
+ * @return True if the event was queued, false if the queue was full.
+ */
+bool EventChannel::publish(const ControllerEvent& event) {
+    if (!queue_.tryPush(event)) {
+        return false;
+    }
+    // Only the first event after a drain writes; the rest ride on the same wakeup.
+    if (!signalled_.exchange(true, std::memory_order_acq_rel)) {
+#if defined(__linux__)
+        const std::uint64_t one = 1;
+        if (::write(fd_, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+            spdlog::error("EventChannel: eventfd write failed: {}", std::generic_category().message(errno));
+        }
+#endif
+    }
+    return true;
+}
+
+/**
+ * @brief Clears the descriptor and moves every queued event into the output vector.
+ * @param out The vector that receives the events (appended).
+ * @return The number of events moved.
+ */
+std::size_t EventChannel::drain(std::vector<ControllerEvent>& out) {
+#if defined(__linux__)
+    std::uint64_t count = 0;
+    if (::read(fd_, &count, sizeof(count)) < 0 && errno != EAGAIN) {
+        spdlog::error("EventChannel: eventfd read failed: {}", std::generic_category().message(errno));
+    }
+#endif
+    // Cleared before popping: an event pushed from here on either is popped below or signals again.
+    signalled_.exchange(false, std::memory_order_acq_rel);
+    std::size_t drained = 0;
+    ControllerEvent event;
+    while (queue_.tryPop(event)) {
+        out.push_back(event);
+        ++drained;
+    }
+    return drained;
+}
+
+/**
+ * @brief Publishes an axisUpdate event for every sample of the given AxisState.
+ * @param axisState The state whose updates should be published.
+ */
+void EventChannel::attach(AxisState& axisState) {
+    axisState.addSampleListener([this](const AxisSample& sample) {
+        ControllerEvent event;
+        event.type = ControllerEventType::axisUpdate;
+        event.axisNo = sample.axisNo;
+        event.timestampNs = sample.timestampNs;
+        event.position = sample.position;
+        event.statusWord = sample.statusWord;
+        publish(event);
+    });
+}
+
+/**
+ * @brief Returns a command callback that publishes a commandCompleted event.
+ * @param tag A caller-chosen value copied into the event.
+ * @return The callback.
+ */
+std::function<void(const ProtocolResponse&)> EventChannel::completion(std::uint64_t tag) {
+    return [this, tag](const ProtocolResponse& response) {
+        ControllerEvent event;
+        event.type = ControllerEventType::commandCompleted;
+        event.status = response.status;
+        const std::size_t length = std::min(response.command.size(), sizeof(event.command) - 1);
+        std::copy_n(response.command.data(), length, event.command);
+        event.axisNo = response.axisNo;
+        event.timestampNs = response.receivedNs != 0 ? response.receivedNs : wallClockNs();
+        event.tag = tag;
+        publish(event);
+    };
+}
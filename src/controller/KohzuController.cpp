@@ -1,4 +1,5 @@
 #include "controller/KohzuController.h"
+#include "common/CycleArena.h"
 #include "spdlog/spdlog.h"
 #include <memory>
 #include <stdexcept>
@@ -11,19 +12,84 @@
  * @param axisState A shared pointer to the AxisState object.
  */
 KohzuController::KohzuController(std::shared_ptr<ProtocolHandler> protocolHandler, std::shared_ptr<AxisState> axisState)
-    : protocolHandler_(protocolHandler), axisState_(axisState) {
-    if (!protocolHandler_ || !axisState_) {
+    : KohzuController(protocolHandler, protocolHandler, axisState) {}
+
+/**
+ * @brief Constructor for a KohzuController with separate command and monitoring connections.
+ * @param commandHandler The ProtocolHandler of the connection used for motion and configuration commands.
+ * @param monitoringHandler The ProtocolHandler of the connection used for periodic reads.
+ * @param axisState A shared pointer to the AxisState object.
+ */
+KohzuController::KohzuController(std::shared_ptr<ProtocolHandler> commandHandler,
+                                 std::shared_ptr<ProtocolHandler> monitoringHandler,
+                                 std::shared_ptr<AxisState> axisState)
+    : protocolHandler_(commandHandler), monitoringHandler_(monitoringHandler), axisState_(axisState),
+      initialStateArena_(std::make_unique<CycleArena>(kMonitorArenaBytes)) {
+    if (!protocolHandler_ || !monitoringHandler_ || !axisState_) {
         throw std::invalid_argument("ProtocolHandler or AxisState object is not valid.");
     }
-    spdlog::info("KohzuController object created.");
+    monitorCycle_->controller = this;
+    monitorCycle_->guard = callbackGuard_;
+    spdlog::info("KohzuController object created ({}).",
+                 protocolHandler_ == monitoringHandler_ ? "single connection" : "separate monitoring connection");
 }
 
 /**
  * @brief Destructor for the KohzuController class.
- * @brief Ensures the monitoring thread is properly stopped and joined.
+ *
+ * Stops the monitoring thread and detaches the controller's own reply callbacks. The handlers
+ * are not shut down, since they may be shared.
  */
 KohzuController::~KohzuController() {
     stopMonitoring();
+    callbackGuard_->detach();
+    // A cycle still in flight outlives the controller until its last reply; withdraw the replies not yet received.
+    MonitorCycle& cycle = *monitorCycle_;
+    std::size_t withdrawn = 0;
+    for (const CommandHandle& handle : cycle.handles) {
+        if (handle.cancel()) {
+            ++withdrawn;
+        }
+    }
+    if (withdrawn > 0 && cycle.remaining.fetch_sub(withdrawn) == withdrawn) {
+        cycle.finish();
+    }
+}
+
+/**
+ * @brief Keeps later callbacks away from the controller, waiting for one running on another thread.
+ *
+ * Called from within a guarded callback, the guard is already held by this thread and is not locked again.
+ */
+void KohzuController::CallbackGuard::detach() {
+    if (runningThread.load() == std::this_thread::get_id()) {
+        attached = false;
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    attached = false;
+}
+
+/**
+ * @brief Shuts the controller down in order within a deadline.
+ * @param deadline The total time allowed for replies in flight.
+ * @return The combined outcome for both connections.
+ */
+ShutdownReport KohzuController::shutdown(std::chrono::milliseconds deadline) {
+    const auto start = std::chrono::steady_clock::now();
+    // Stop the only internal source of new commands first.
+    stopMonitoring();
+
+    ShutdownReport report = protocolHandler_->shutdown(deadline);
+    if (monitoringHandler_ != protocolHandler_) {
+        const auto remaining = std::max(std::chrono::milliseconds(0), deadline -
+            std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start));
+        const ShutdownReport monitoring = monitoringHandler_->shutdown(remaining);
+        report.drained = report.drained && monitoring.drained;
+        report.failedCommands += monitoring.failedCommands;
+    }
+    report.elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return report;
 }
 
 /**
@@ -31,6 +97,9 @@ KohzuController::~KohzuController() {
  */
 void KohzuController::start() {
     protocolHandler_->initialize();
+    if (monitoringHandler_ != protocolHandler_) {
+        monitoringHandler_->initialize();
+    }
     spdlog::info("Starting KohzuController.");
 }
 
@@ -60,6 +129,10 @@ void KohzuController::stopMonitoring() {
     }
     isMonitoringRunning_.store(false);
     monitorCv_.notify_one(); // Wake up the thread if it's waiting
+    {
+        std::lock_guard<std::mutex> lock(monitorCycle_->doneMutex);
+    }
+    monitorCycle_->doneCv.notify_one(); // Or waiting for the previous cycle
     if (monitoringThread_ && monitoringThread_->joinable()) {
         monitoringThread_->join();
     }
@@ -67,6 +140,26 @@ void KohzuController::stopMonitoring() {
     spdlog::info("Stopped periodic monitoring thread.");
 }
 
+/**
+ * @brief Sets the real-time profile applied by the monitoring thread when it starts.
+ * @param profile The shared profile, or nullptr to run with default settings.
+ */
+void KohzuController::setRealtimeProfile(std::shared_ptr<RealtimeProfile> profile) {
+    realtimeProfile_ = std::move(profile);
+}
+
+/**
+ * @brief Sets the latency split of the command and monitoring connections.
+ * @param outboundShare Fraction of the minimum round trip spent before the controller serves a request.
+ * @param windowSamples Number of samples after which the minimum round trip is re-measured.
+ */
+void KohzuController::setLatencySplit(double outboundShare, std::size_t windowSamples) {
+    protocolHandler_->setLatencySplit(outboundShare, windowSamples);
+    if (monitoringHandler_ != protocolHandler_) {
+        monitoringHandler_->setLatencySplit(outboundShare, windowSamples);
+    }
+}
+
 /**
  * @brief Adds a single axis to the monitoring list in a thread-safe manner.
  * @param axisNo The axis number to add.
@@ -100,63 +193,194 @@ void KohzuController::removeAxisToMonitor(int axisNo) {
  * @param periodMs The monitoring period in milliseconds.
  */
 void KohzuController::monitorThreadFunction(int periodMs) {
+    // Per-cycle scratch memory: everything built for one polling cycle is released at once.
+    CycleArena arena(kMonitorArenaBytes);
+    if (realtimeProfile_) {
+        realtimeProfile_->applyMonitorThread();
+        if (realtimeProfile_->prefaultsBuffers()) {
+            arena.prefault();
+        }
+    }
     while (isMonitoringRunning_.load()) {
-        std::vector<int> current_axes;
         {
-            std::unique_lock<std::mutex> lock(monitorMutex_);
-            monitorCv_.wait(lock, [this] {
-                return !isMonitoringRunning_.load() || !axesToMonitor_.empty();
-            });
+            std::pmr::vector<int> current_axes(arena.resource());
+            {
+                std::unique_lock<std::mutex> lock(monitorMutex_);
+                monitorCv_.wait(lock, [this] {
+                    return !isMonitoringRunning_.load() || !axesToMonitor_.empty();
+                });
 
-            if (!isMonitoringRunning_.load()) {
-                break; // Exit if stopped while waiting
+                if (!isMonitoringRunning_.load()) {
+                    break; // Exit if stopped while waiting
+                }
+
+                // Copy the axes to a local variable to minimize lock time
+                current_axes.assign(axesToMonitor_.begin(), axesToMonitor_.end());
             }
 
-            // Copy the axes to a local variable to minimize lock time
-            current_axes = axesToMonitor_;
-        }
+            // Perform monitoring outside the lock, pipelining every read of the cycle in one write.
+            // The cycle's replies arrive one after another, so they fill one update batch without locking;
+            // it reaches axisState in one step once every reply, error replies included, has been counted.
+            MonitorCycle& cycle = *monitorCycle_;
+            {
+                std::unique_lock<std::mutex> lock(cycle.doneMutex);
+                cycle.doneCv.wait(lock, [this, &cycle] { return cycle.done || !isMonitoringRunning_.load(); });
+                if (!isMonitoringRunning_.load()) {
+                    break;
+                }
+                cycle.done = false;
+            }
+            cycle.self = monitorCycle_;
+            cycle.updates.clear();
+            cycle.handles.clear();
+            cycle.remaining.store(2 * current_axes.size());
 
-        // Perform monitoring outside the lock
-        for (int axis_no : current_axes) {
-            readPosition(axis_no);
-            readStatus(axis_no);
+            CommandBatch batch(arena.resource());
+            MonitorCycle* const target = &cycle;
+            for (const int axis_no : current_axes) {
+                batch.add("RDP", axis_no, [target, axis_no](const ProtocolResponse& response) {
+                    target->onReply(axis_no, response, false);
+                });
+                batch.add("STR", axis_no, [target, axis_no](const ProtocolResponse& response) {
+                    target->onReply(axis_no, response, true);
+                });
+            }
+            monitoringHandler_->sendBatch(batch);
+            for (std::size_t i = 0; i < batch.size(); ++i) {
+                cycle.handles.push_back(batch.handle(i));
+            }
         }
+        arena.reset();
 
         std::this_thread::sleep_for(std::chrono::milliseconds(periodMs));
     }
 }
 
 /**
- * @brief Reads the current position of a specific axis and update axisState.
+ * @brief Adds a reply of the cycle to its updates and completes the cycle on the last one.
  * @param axisNo The axis number.
+ * @param response The RDP or STR response.
+ * @param isStatus True for an STR response.
  */
-void KohzuController::readPosition(int axisNo) {
-    protocolHandler_->sendCommand("RDP", axisNo, {},
-        [this, axisNo](const ProtocolResponse& response) {
-            if (response.status == 'C' && !response.params.empty()) {
-                try {
-                    int position = std::stoi(response.params[0]);
-                    this->axisState_->updatePosition(axisNo, position);
-                    spdlog::debug("Monitoring: Position of axis {} updated to {}.", axisNo, position);
-                } catch (const std::exception& e) {
-                    spdlog::error("Monitoring: Failed to parse RDP position for axis {}: {}", axisNo, e.what());
-                }
-            }
-        });
+void KohzuController::MonitorCycle::onReply(int axisNo, const ProtocolResponse& response, bool isStatus) {
+    guard->run([&] {
+        if (isStatus) {
+            controller->handleStatusResponse(axisNo, response, &updates);
+        } else {
+            controller->handlePositionResponse(axisNo, response, &updates);
+        }
+    });
+    if (remaining.fetch_sub(1) == 1) {
+        finish();
+    }
+}
+
+/**
+ * @brief Applies the cycle's updates, unless the controller is gone, and lets the next cycle start.
+ *
+ * Drops the cycle's reference to itself last, which may destroy it.
+ */
+void KohzuController::MonitorCycle::finish() {
+    guard->run([this] { controller->completeMonitorCycle(updates); });
+    std::shared_ptr<MonitorCycle> keep = std::move(self);
+    {
+        std::lock_guard<std::mutex> lock(doneMutex);
+        done = true;
+    }
+    doneCv.notify_one();
+}
+
+/**
+ * @brief Applies the updates of a completed monitoring cycle, counts the cycle and publishes it to the event channel, if any.
+ * @param updates The position and status updates collected from the cycle's replies.
+ */
+void KohzuController::completeMonitorCycle(const AxisUpdateBatch& updates) {
+    axisState_->apply(updates);
+    spdlog::debug("Monitoring: {} axis updates applied.", updates.size());
+    const std::uint64_t cycle = monitorCycles_.fetch_add(1, std::memory_order_relaxed) + 1;
+    if (eventChannel_) {
+        ControllerEvent event;
+        event.type = ControllerEventType::monitorCycle;
+        event.timestampNs = wallClockNs();
+        event.tag = cycle;
+        eventChannel_->publish(event);
+    }
+}
+
+/**
+ * @brief Publishes axis updates and monitoring cycles to an event channel.
+ * @param channel The channel.
+ */
+void KohzuController::setEventChannel(std::shared_ptr<EventChannel> channel) {
+    if (!channel) {
+        throw std::invalid_argument("EventChannel object is not valid.");
+    }
+    channel->attach(*axisState_);
+    eventChannel_ = std::move(channel);
 }
 
 /**
- * @brief Reads the detailed status of a specific axis and update axisState.
+ * @brief Stores the position carried by an RDP response in axisState.
  * @param axisNo The axis number.
+ * @param response The RDP response.
+ * @param updates If set, the position is added to this batch instead of being stored at once.
+ * @return True if the position was updated.
  */
-void KohzuController::readStatus(int axisNo) {
-    protocolHandler_->sendCommand("STR", axisNo, {},
-        [this, axisNo](const ProtocolResponse& response) {
-            if (response.status == 'C' && response.params.size() >= 6) {
-                this->axisState_->updateStatus(axisNo, response.params);
-                spdlog::debug("Monitoring: Status of axis {} updated.", axisNo);
-            }
-        });
+bool KohzuController::handlePositionResponse(int axisNo, const ProtocolResponse& response, AxisUpdateBatch* updates) {
+    if (response.status != 'C' || response.params.empty()) {
+        return false;
+    }
+    int position;
+    if (std::error_code error = parseInteger(response.params[0], position)) {
+        spdlog::error("Failed to parse RDP position for axis {}: {}", axisNo, error.message());
+        return false;
+    }
+    if (updates) {
+        updates->addPosition(axisNo, position, response.sampleNs);
+    } else {
+        axisState_->updatePosition(axisNo, position, response.sampleNs);
+    }
+    return true;
+}
+
+/**
+ * @brief Stores the status carried by an STR response in axisState.
+ * @param axisNo The axis number.
+ * @param response The STR response.
+ * @param updates If set, the status is added to this batch instead of being stored at once.
+ * @return True if the status was updated.
+ */
+bool KohzuController::handleStatusResponse(int axisNo, const ProtocolResponse& response, AxisUpdateBatch* updates) {
+    if (response.status != 'C' || response.params.size() < 6) {
+        return false;
+    }
+    if (updates) {
+        return updates->addStatus(axisNo, response.params, response.sampleNs);
+    }
+    axisState_->updateStatus(axisNo, response.params, response.sampleNs);
+    return true;
+}
+
+/**
+ * @brief Stores the value carried by an RSY response in axisState.
+ *
+ * The value is the last parameter of the response.
+ * @param axisNo The axis number.
+ * @param systemNo The system parameter number that was read.
+ * @param response The RSY response.
+ * @return True if the parameter was updated.
+ */
+bool KohzuController::handleSystemResponse(int axisNo, int systemNo, const ProtocolResponse& response) {
+    if (response.status != 'C' || response.params.empty()) {
+        return false;
+    }
+    int value;
+    if (std::error_code error = parseInteger(response.params.back(), value)) {
+        spdlog::error("Failed to parse RSY{} value for axis {}: {}", systemNo, axisNo, error.message());
+        return false;
+    }
+    axisState_->updateSystemParameter(axisNo, systemNo, value);
+    return true;
 }
 
 /**
@@ -166,9 +390,11 @@ void KohzuController::readStatus(int axisNo) {
  * @param speed The movement speed. Defaults to 0 if not provided.
  * @param responseType The response type. Defaults to 0 if not provided.
  * @param callback A function to be called when the command completes.
+ * @param site Where the callback is registered.
+ * @return A handle that cancels the callback.
  */
-void KohzuController::moveAbsolute(int axisNo, int position, int speed, int responseType,
-                                   std::function<void(const ProtocolResponse&)> callback) {
+CommandHandle KohzuController::moveAbsolute(int axisNo, int position, int speed, int responseType,
+                                            std::function<void(const ProtocolResponse&)> callback, CallSite site) {
     // According to the manual, the parameter order is: speed, position, response_type.
     std::vector<std::string> params = {
         std::to_string(speed),
@@ -176,7 +402,7 @@ void KohzuController::moveAbsolute(int axisNo, int position, int speed, int resp
         std::to_string(responseType)
     };
     // Use the provided callback directly
-    protocolHandler_->sendCommand("APS", axisNo, params, callback);
+    return protocolHandler_->sendCommand("APS", axisNo, params, callback, site);
 }
 
 /**
@@ -186,9 +412,11 @@ void KohzuController::moveAbsolute(int axisNo, int position, int speed, int resp
  * @param speed The movement speed. Defaults to 0 if not provided.
  * @param responseType The response type. Defaults to 0 if not provided.
  * @param callback A function to be called when the command completes.
+ * @param site Where the callback is registered.
+ * @return A handle that cancels the callback.
  */
-void KohzuController::moveRelative(int axisNo, int distance, int speed, int responseType,
-                                   std::function<void(const ProtocolResponse&)> callback) {
+CommandHandle KohzuController::moveRelative(int axisNo, int distance, int speed, int responseType,
+                                            std::function<void(const ProtocolResponse&)> callback, CallSite site) {
     // According to the manual, the parameter order is: speed, distance, response_type.
     std::vector<std::string> params = {
         std::to_string(speed),
@@ -196,23 +424,42 @@ void KohzuController::moveRelative(int axisNo, int distance, int speed, int resp
         std::to_string(responseType)
     };
     // Use the provided callback directly
-    protocolHandler_->sendCommand("RPS", axisNo, params, callback);
+    return protocolHandler_->sendCommand("RPS", axisNo, params, callback, site);
 }
 
     /**
      * @brief Commands the specified axis to perform an origin return operation.
+     *
+     * The axis counts as not homed from now on; with responseType 0 it is marked homed
+     * in axisState when the origin return completes.
      * @param axisNo The axis number to move.
      * @param speed The movement speed (0-9).
      * @param responseType The response type (e.g., 0 for completion response).
      * @param callback A function to be called when the command completes.
+     * @param site Where the callback is registered.
+     * @return A handle that cancels the callback.
      */
-void KohzuController::moveOrigin(int axisNo, int speed, int responseType,
-                                 std::function<void(const ProtocolResponse&)> callback) {
+CommandHandle KohzuController::moveOrigin(int axisNo, int speed, int responseType,
+                                          std::function<void(const ProtocolResponse&)> callback, CallSite site) {
     std::vector<std::string> params = {
         std::to_string(speed),
         std::to_string(responseType)
     };
-    protocolHandler_->sendCommand("ORG", axisNo, params, callback);
+    axisState_->setHomed(axisNo, false);
+    if (responseType != 0) {
+        // The reply only acknowledges the command; the caller marks the axis homed once it knows.
+        return protocolHandler_->sendCommand("ORG", axisNo, params, callback, site);
+    }
+    // Holds the AxisState rather than the controller, so the homed flag is kept even if the controller is gone.
+    return protocolHandler_->sendCommand("ORG", axisNo, params,
+        [axisState = axisState_, axisNo, callback](const ProtocolResponse& response) {
+            if (response.status == 'C') {
+                axisState->setHomed(axisNo, true);
+            }
+            if (callback) {
+                callback(response);
+            }
+        }, site);
 }
 
 /**
@@ -221,12 +468,97 @@ void KohzuController::moveOrigin(int axisNo, int speed, int responseType,
      * @param systemNo The system parameter number.
      * @param value The value to set for the parameter.
      * @param callback A function to be called when the command completes.
+     * @param site Where the callback is registered.
+     * @return A handle that cancels the callback.
      */
-void KohzuController::setSystem(int axisNo, int systemNo, int value,
-                                std::function<void(const ProtocolResponse&)> callback) {
+CommandHandle KohzuController::setSystem(int axisNo, int systemNo, int value,
+                                         std::function<void(const ProtocolResponse&)> callback, CallSite site) {
     std::vector<std::string> params = {
         std::to_string(systemNo),
         std::to_string(value)
     };
-    protocolHandler_->sendCommand("WSY", axisNo, params, callback);
+    return protocolHandler_->sendCommand("WSY", axisNo, params, callback, site);
+}
+
+/**
+ * @brief Reads a system parameter value of a specified axis and caches it in AxisState. (RSY command)
+ * @param axisNo The axis number to query.
+ * @param systemNo The system parameter number.
+ * @param callback A function to be called when the command completes.
+ * @param site Where the callback is registered.
+ * @return A handle that cancels the callback.
+ */
+CommandHandle KohzuController::readSystem(int axisNo, int systemNo,
+                                          std::function<void(const ProtocolResponse&)> callback, CallSite site) {
+    return protocolHandler_->sendCommand("RSY", axisNo, {std::to_string(systemNo)},
+        [this, axisNo, systemNo, callback, guard = callbackGuard_](const ProtocolResponse& response) {
+            guard->run([&] { this->handleSystemResponse(axisNo, systemNo, response); });
+            if (callback) {
+                callback(response);
+            }
+        }, site);
+}
+
+/**
+ * @brief Reads position, status and the given system parameters of every axis in one pipelined burst.
+ * @param axes The axis numbers to read.
+ * @param systemNos The system parameter numbers to read for each axis.
+ * @param callback Called with the number of replies that did not complete successfully.
+ */
+void KohzuController::acquireInitialState(const std::vector<int>& axes, const std::vector<int>& systemNos,
+                                          std::function<void(std::size_t failedReplies)> callback) {
+    struct Progress {
+        std::atomic<std::size_t> remaining{0};
+        std::atomic<std::size_t> failed{0};
+        AxisUpdateBatch updates; // Filled by the replies one at a time, applied after the last one
+    };
+    auto progress = std::make_shared<Progress>();
+    // Holds the AxisState rather than the controller, so the caller learns the outcome even if the controller is gone.
+    auto complete = [axisState = axisState_, progress, callback](bool succeeded) {
+        if (!succeeded) {
+            progress->failed.fetch_add(1);
+        }
+        if (progress->remaining.fetch_sub(1) == 1) {
+            axisState->apply(progress->updates);
+            if (callback) {
+                callback(progress->failed.load());
+            }
+        }
+    };
+
+    std::lock_guard<std::mutex> arenaLock(initialStateMutex_);
+    CycleArena& arena = *initialStateArena_;
+    arena.reset(); // Nothing from the previous call is alive: its batch was handed over when it was sent
+    CommandBatch batch(arena.resource());
+    std::vector<std::string> systemParams(1);
+    for (int axisNo : axes) {
+        batch.add("RDP", axisNo, [this, axisNo, progress, complete, guard = callbackGuard_](const ProtocolResponse& response) {
+            bool updated = false;
+            guard->run([&] { updated = this->handlePositionResponse(axisNo, response, &progress->updates); });
+            complete(updated);
+        });
+        batch.add("STR", axisNo, [this, axisNo, progress, complete, guard = callbackGuard_](const ProtocolResponse& response) {
+            bool updated = false;
+            guard->run([&] { updated = this->handleStatusResponse(axisNo, response, &progress->updates); });
+            complete(updated);
+        });
+        for (int systemNo : systemNos) {
+            systemParams[0] = std::to_string(systemNo);
+            batch.add("RSY", axisNo, systemParams,
+                [this, axisNo, systemNo, complete, guard = callbackGuard_](const ProtocolResponse& response) {
+                    bool updated = false;
+                    guard->run([&] { updated = this->handleSystemResponse(axisNo, systemNo, response); });
+                    complete(updated);
+                });
+        }
+    }
+
+    if (batch.size() == 0) {
+        if (callback) {
+            callback(0);
+        }
+        return;
+    }
+    progress->remaining.store(batch.size());
+    monitoringHandler_->sendBatch(batch);
 }
@@ -0,0 +1,237 @@
+#include "controller/PlantStartup.h"
+#include "spdlog/spdlog.h"
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+
+constexpr int kReconnectIntervalMs = 1000; // Retry period of watched plain connections
+
+/**
+ * @brief Closes every connection of an endpoint that will not be started.
+ */
+void closeConnections(PlantStartup::StartedController& started) {
+    if (started.failoverClient) {
+        started.failoverClient->close();
+    }
+    if (started.client) {
+        started.client->close();
+    }
+    if (started.monitoringClient) {
+        started.monitoringClient->close();
+    }
+}
+
+} // namespace
+
+/**
+ * @brief Writes the report to the log.
+ */
+void StartupReport::log() const {
+    std::size_t ready = 0;
+    for (const ControllerStartupResult& result : controllers) {
+        if (result.ready) {
+            ++ready;
+            spdlog::debug("Startup {}: connected at {:.1f} ms, ready at {:.1f} ms ({} failed replies).",
+                          result.name, result.connectedMs, result.readyMs, result.failedReplies);
+        } else {
+            spdlog::warn("Startup {}: not ready ({}).", result.name,
+                         result.error.empty() ? "initial state incomplete" : result.error);
+        }
+    }
+    spdlog::info("Startup: {}/{} controllers ready. connect phase {:.1f} ms, acquire phase {:.1f} ms, time to ready {:.1f} ms.",
+                 ready, controllers.size(), connectPhaseMs, acquirePhaseMs, timeToReadyMs);
+}
+
+/**
+ * @brief Constructor for the PlantStartup class.
+ * @param ioContext The Boost.Asio I/O context used by all clients.
+ * @param endpoints The controllers to bring up.
+ * @param systemParameters System parameter numbers read for every axis during startup.
+ */
+PlantStartup::PlantStartup(boost::asio::io_context& ioContext, std::vector<ControllerEndpoint> endpoints,
+                           std::vector<int> systemParameters)
+    : ioContext_(ioContext), systemParameters_(std::move(systemParameters)) {
+    controllers_.resize(endpoints.size());
+    results_.resize(endpoints.size());
+    pendingConnections_.resize(endpoints.size());
+    for (std::size_t i = 0; i < endpoints.size(); ++i) {
+        results_[i].name = endpoints[i].name;
+        controllers_[i].endpoint = std::move(endpoints[i]);
+    }
+}
+
+/**
+ * @brief Connects all controllers and acquires their initial state.
+ * @param timeout The deadline for the whole startup.
+ * @return The startup report. It is also logged.
+ */
+StartupReport PlantStartup::run(std::chrono::milliseconds timeout) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (hasRun_) {
+            throw std::logic_error("PlantStartup::run() can only be called once.");
+        }
+        hasRun_ = true;
+    }
+    startTime_ = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < controllers_.size(); ++i) {
+        StartedController& started = controllers_[i];
+        if (started.endpoint.hotStandby) {
+            started.failoverClient = std::make_shared<FailoverClient>(ioContext_);
+        } else {
+            started.client = std::make_shared<TcpClient>(ioContext_, started.endpoint.host, started.endpoint.port);
+        }
+        if (started.endpoint.separateMonitoringConnection) {
+            started.monitoringClient = std::make_shared<TcpClient>(ioContext_, started.endpoint.host, started.endpoint.port);
+        }
+        if (started.endpoint.livenessWatchdog) {
+            // The watchdog drops dead links; plain connections then come back on their own.
+            if (started.client) {
+                started.client->setAutoReconnect(kReconnectIntervalMs);
+            }
+            if (started.monitoringClient) {
+                started.monitoringClient->setAutoReconnect(kReconnectIntervalMs);
+            }
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            pendingConnections_[i] = started.monitoringClient ? 2 : 1;
+        }
+        auto connected = [this, i](const std::error_code& error) {
+            this->onConnected(i, error);
+        };
+        if (started.failoverClient) {
+            started.failoverClient->asyncConnect(started.endpoint.host, started.endpoint.port, connected);
+        } else {
+            started.client->asyncConnect(started.endpoint.host, started.endpoint.port, connected);
+        }
+        if (started.monitoringClient) {
+            started.monitoringClient->asyncConnect(started.endpoint.host, started.endpoint.port, connected);
+        }
+    }
+
+    StartupReport report;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        finishedCv_.wait_until(lock, startTime_ + timeout, [this] {
+            return finished_ == controllers_.size();
+        });
+        // From here on controllers_ belongs to the caller: later connections are closed, and
+        // controllers being built right now are finished before it is handed over.
+        runFinished_ = true;
+        finishedCv_.wait(lock, [this] { return starting_ == 0; });
+        report.controllers = results_;
+        report.timeToReadyMs = elapsedMs();
+    }
+
+    report.allReady = true;
+    for (const ControllerStartupResult& result : report.controllers) {
+        report.allReady = report.allReady && result.ready;
+        if (result.connected) {
+            report.connectPhaseMs = std::max(report.connectPhaseMs, result.connectedMs);
+        }
+        if (result.ready) {
+            report.acquirePhaseMs = std::max(report.acquirePhaseMs, result.readyMs - result.connectedMs);
+        }
+    }
+    report.log();
+    return report;
+}
+
+/**
+ * @brief Returns the time elapsed since run() started.
+ * @return The elapsed time in milliseconds.
+ */
+double PlantStartup::elapsedMs() const {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime_).count();
+}
+
+/**
+ * @brief Starts the controller of a freshly connected endpoint and issues its initial reads.
+ *
+ * Called once per connection; the controller starts when the endpoint's last connection completes.
+ * @param index The endpoint index.
+ * @param error The result of the connection attempt.
+ */
+void PlantStartup::onConnected(std::size_t index, const std::error_code& error) {
+    StartedController& started = controllers_[index];
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        ControllerStartupResult& result = results_[index];
+        if (error && result.error.empty()) {
+            result.error = "Connection failed: " + error.message();
+        }
+        if (--pendingConnections_[index] > 0) {
+            return; // Wait for the endpoint's other connection
+        }
+        if (runFinished_ || !result.error.empty()) {
+            // The endpoint will not start, so a connection that did come up must not linger.
+            if (!runFinished_) {
+                result.connectedMs = elapsedMs();
+                ++finished_;
+                finishedCv_.notify_all();
+            }
+            lock.unlock();
+            closeConnections(started);
+            return;
+        }
+        result.connectedMs = elapsedMs();
+        result.connected = true;
+        ++starting_;
+    }
+
+    if (started.failoverClient) {
+        started.protocolHandler = std::make_shared<ProtocolHandler>(started.failoverClient);
+    } else {
+        started.protocolHandler = std::make_shared<ProtocolHandler>(started.client);
+    }
+    started.axisState = std::make_shared<AxisState>();
+    if (started.monitoringClient) {
+        started.monitoringHandler = std::make_shared<ProtocolHandler>(started.monitoringClient);
+        started.controller = std::make_shared<KohzuController>(started.protocolHandler, started.monitoringHandler,
+                                                               started.axisState);
+    } else {
+        started.controller = std::make_shared<KohzuController>(started.protocolHandler, started.axisState);
+    }
+    started.controller->setLatencySplit(started.endpoint.latencyOutboundShare);
+    started.controller->start();
+    if (started.endpoint.livenessWatchdog) {
+        std::shared_ptr<ICommunicationClient> client = started.failoverClient;
+        if (!client) {
+            client = started.client;
+        }
+        started.watchdog = std::make_shared<ConnectionWatchdog>(started.protocolHandler, client);
+        started.watchdog->start();
+        if (started.monitoringHandler) {
+            started.monitoringWatchdog = std::make_shared<ConnectionWatchdog>(started.monitoringHandler,
+                                                                              started.monitoringClient);
+            started.monitoringWatchdog->start();
+        }
+    }
+    const std::shared_ptr<KohzuController> controller = started.controller;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        --starting_;
+    }
+    finishedCv_.notify_all();
+    controller->acquireInitialState(started.endpoint.axes, systemParameters_,
+        [this, index](std::size_t failedReplies) {
+            this->onReady(index, failedReplies);
+        });
+}
+
+/**
+ * @brief Records that every initial reply of an endpoint has arrived.
+ * @param index The endpoint index.
+ * @param failedReplies The number of unsuccessful replies.
+ */
+void PlantStartup::onReady(std::size_t index, std::size_t failedReplies) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ControllerStartupResult& result = results_[index];
+    result.ready = true;
+    result.readyMs = elapsedMs();
+    result.failedReplies = failedReplies;
+    ++finished_;
+    finishedCv_.notify_all();
+}
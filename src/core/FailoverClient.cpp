@@ -0,0 +1,547 @@
+#include "core/FailoverClient.h"
+#include "protocol/exceptions/ConnectionException.h"
+#include "spdlog/spdlog.h"
+#include <boost/asio.hpp>
+#include <algorithm>
+#include <cctype>
+
+namespace {
+
+/**
+ * @brief Returns the response key of a command line ("APS1/0/1000/0\r\n" -> "APS1").
+ * @param line The command line.
+ * @return The command mnemonic followed by the axis number, if any.
+ */
+std::string_view commandKey(std::string_view line) {
+    const std::size_t end = line.find_first_of("/\r\n");
+    return line.substr(0, end == std::string_view::npos ? line.size() : end);
+}
+
+/**
+ * @brief Returns the response key of a reply line (the second tab-separated field).
+ * @param line The reply line.
+ * @return The key, or an empty view if the line has no command field.
+ */
+std::string_view replyKey(std::string_view line) {
+    const std::size_t start = line.find('\t');
+    if (start == std::string_view::npos) {
+        return {};
+    }
+    const std::size_t end = line.find_first_of("\t\r\n", start + 1);
+    return line.substr(start + 1, end == std::string_view::npos ? std::string_view::npos : end - start - 1);
+}
+
+/**
+ * @brief Builds the reply delivered in place of one that will never arrive.
+ * @param responseKey The response key of the abandoned command.
+ * @return An error reply line that ProtocolHandler matches to the command's callback.
+ */
+std::string syntheticFailure(std::string_view responseKey) {
+    std::string line = "E\t";
+    line.append(responseKey.data(), responseKey.size());
+    line += "\tfailover\r\n";
+    return line;
+}
+
+} // namespace
+
+/**
+ * @struct FailoverClient::Impl
+ * @brief The Asio objects of a FailoverClient.
+ */
+struct FailoverClient::Impl {
+    explicit Impl(boost::asio::io_context& ioContext) : heartbeatTimer(ioContext) {}
+
+    boost::asio::steady_timer heartbeatTimer;
+};
+
+/**
+ * @brief Constructor for FailoverClient.
+ * @param ioContext The Boost.Asio I/O context.
+ * @param config The failover settings.
+ */
+FailoverClient::FailoverClient(boost::asio::io_context& ioContext, Config config)
+    : ioContext_(ioContext),
+      config_(std::move(config)),
+      impl_(std::make_unique<Impl>(ioContext)) {
+    heartbeatLine_ = config_.heartbeatCommand + "\r\n";
+    heartbeatKey_ = std::string(commandKey(heartbeatLine_));
+    for (Link& link : links_) {
+        link.client = std::make_shared<TcpClient>(ioContext_, config_.standbyHost, config_.standbyPort);
+    }
+}
+
+/**
+ * @brief Constructor for FailoverClient with default settings.
+ * @param ioContext The Boost.Asio I/O context.
+ */
+FailoverClient::FailoverClient(boost::asio::io_context& ioContext)
+    : FailoverClient(ioContext, Config{}) {}
+
+/**
+ * @brief Destructor. Closes both connections.
+ */
+FailoverClient::~FailoverClient() {
+    close();
+}
+
+/**
+ * @brief Records the primary and standby addresses.
+ * @param host The primary host.
+ * @param port The primary port.
+ */
+void FailoverClient::setEndpoints(const std::string& host, const std::string& port) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    closed_ = false;
+    links_[0].host = host;
+    links_[0].port = port;
+    links_[1].host = config_.standbyHost.empty() ? host : config_.standbyHost;
+    links_[1].port = config_.standbyPort.empty() ? port : config_.standbyPort;
+    for (Link& link : links_) {
+        link.client->setDisconnectHandler([this, index = static_cast<std::size_t>(&link - links_.data())](const std::error_code& error) {
+            this->onLinkLost(index, error);
+        });
+    }
+}
+
+/**
+ * @brief Connects both connections.
+ * @param host The host address to connect to.
+ * @param port The port number to connect to.
+ */
+void FailoverClient::connect(const std::string& host, const std::string& port) {
+    std::error_code error;
+    connect(host, port, error);
+    if (error) {
+        throw ConnectionException("Connection failed: " + error.message());
+    }
+}
+
+/**
+ * @brief Connects both connections without throwing.
+ * @param host The host address to connect to.
+ * @param port The port number to connect to.
+ * @param error Set to the failure reason if neither connection can be established, cleared otherwise.
+ */
+void FailoverClient::connect(const std::string& host, const std::string& port, std::error_code& error) {
+    setEndpoints(host, port);
+    std::array<std::error_code, 2> errors;
+    for (std::size_t i = 0; i < links_.size(); ++i) {
+        links_[i].client->connect(links_[i].host, links_[i].port, errors[i]);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto now = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < links_.size(); ++i) {
+        links_[i].connected = !errors[i];
+        links_[i].lastAttempt = now;
+    }
+    if (errors[0] && errors[1]) {
+        error = errors[0];
+        return;
+    }
+    error.clear();
+    active_ = errors[0] ? 1 : 0;
+    if (errors[1 - active_]) {
+        spdlog::warn("Standby connection to {}:{} failed ({}); retrying in the background.",
+                     links_[1 - active_].host, links_[1 - active_].port, errors[1 - active_].message());
+    }
+    for (std::size_t i = 0; i < links_.size(); ++i) {
+        if (links_[i].connected) {
+            startLink(i);
+        }
+    }
+    scheduleHeartbeat();
+}
+
+/**
+ * @brief Connects both connections asynchronously on the I/O context.
+ * @param host The host address to connect to.
+ * @param port The port number to connect to.
+ * @param handler Called once one connection is up, or with an error once both attempts fail.
+ */
+void FailoverClient::asyncConnect(const std::string& host, const std::string& port,
+                                  std::function<void(const std::error_code&)> handler) {
+    setEndpoints(host, port);
+    std::lock_guard<std::mutex> lock(mutex_);
+    connectHandler_ = std::move(handler);
+    connectAttemptsLeft_ = links_.size();
+    for (std::size_t i = 0; i < links_.size(); ++i) {
+        startConnect(i);
+    }
+    scheduleHeartbeat();
+}
+
+/**
+ * @brief Writes data on the active connection and tracks the commands it contains.
+ * @param data One or more CR/LF terminated command lines.
+ */
+void FailoverClient::asyncWrite(const std::string& data) {
+    std::vector<std::string> synthetic;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const std::string_view text = data;
+        std::size_t start = 0;
+        while (start < text.size()) {
+            std::size_t end = text.find('\n', start);
+            end = end == std::string_view::npos ? text.size() : end + 1;
+            const std::string_view line = text.substr(start, end - start);
+            const std::string_view key = commandKey(line);
+            if (!key.empty()) {
+                outstanding_.push_back(Outstanding{std::string(line), std::string(key), isReplayable(key)});
+            }
+            start = end;
+        }
+
+        if (links_[active_].connected) {
+            links_[active_].client->asyncWrite(data);
+            return;
+        }
+        // Both connections are down: nothing will answer, so fail the commands right away.
+        failOutstanding(false, synthetic);
+    }
+    deliverSynthetic(std::move(synthetic));
+}
+
+/**
+ * @brief Sets the callback for lines received on the active connection.
+ * @param callback The callback function to be called when a line is received.
+ */
+void FailoverClient::asyncRead(std::function<void(const std::string&)> callback) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    readCallback_ = std::move(callback);
+}
+
+/**
+ * @brief Sets the function called when both connections are lost.
+ * @param handler Called on the I/O thread with the error that ended the last connection.
+ */
+void FailoverClient::setDisconnectHandler(std::function<void(const std::error_code&)> handler) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    disconnectHandler_ = std::move(handler);
+}
+
+/**
+ * @brief Requests kernel receive timestamps on both connections.
+ * @param enable True to request kernel timestamps.
+ */
+void FailoverClient::setKernelTimestamps(bool enable) {
+    for (Link& link : links_) {
+        link.client->setKernelTimestamps(enable);
+    }
+}
+
+/**
+ * @brief Closes both connections and stops the heartbeat.
+ */
+void FailoverClient::close() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed_ = true;
+        impl_->heartbeatTimer.cancel();
+        for (Link& link : links_) {
+            link.connected = false;
+            link.healthy = false;
+            link.heartbeatPending = false;
+        }
+    }
+    // Outside the lock: TcpClient::close() waits for the I/O thread, whose handlers take mutex_.
+    for (Link& link : links_) {
+        link.client->close();
+    }
+}
+
+/**
+ * @brief Treats the active connection as lost, failing over to the standby.
+ * @param reason The reason reported for the loss.
+ */
+void FailoverClient::dropConnection(const std::error_code& reason) {
+    boost::asio::post(ioContext_, [this, reason]() {
+        std::size_t active = 0;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (closed_ || !links_[active_].connected) {
+                return;
+            }
+            active = active_;
+        }
+        this->onLinkLost(active, reason);
+    });
+}
+
+/**
+ * @brief Returns whether a healthy standby connection is available.
+ * @return True if the standby is connected and its heartbeat is answered.
+ */
+bool FailoverClient::standbyReady() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const Link& standby = links_[1 - active_];
+    return standby.connected && standby.healthy;
+}
+
+/**
+ * @brief Starts the read loop of a connected link. Called with the mutex held.
+ * @param index The link index.
+ */
+void FailoverClient::startLink(std::size_t index) {
+    links_[index].healthy = false;
+    links_[index].heartbeatPending = false;
+    links_[index].client->asyncRead([this, index](const std::string& line) {
+        this->onLine(index, line);
+    });
+}
+
+/**
+ * @brief Starts an asynchronous connection attempt. Called with the mutex held.
+ * @param index The link index.
+ */
+void FailoverClient::startConnect(std::size_t index) {
+    Link& link = links_[index];
+    link.connecting = true;
+    link.lastAttempt = std::chrono::steady_clock::now();
+    link.client->asyncConnect(link.host, link.port, [this, index](const std::error_code& error) {
+        this->onLinkConnected(index, error);
+    });
+}
+
+/**
+ * @brief Handles the completion of a connection attempt.
+ * @param index The link index.
+ * @param error The result of the attempt.
+ */
+void FailoverClient::onLinkConnected(std::size_t index, const std::error_code& error) {
+    std::function<void(const std::error_code&)> handler;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Link& link = links_[index];
+        link.connecting = false;
+        link.lastAttempt = std::chrono::steady_clock::now();
+        if (closed_) {
+            link.client->close();
+            return;
+        }
+        if (!error) {
+            link.connected = true;
+            if (!links_[active_].connected) {
+                active_ = index;
+            }
+            spdlog::info("{} connection to {}:{} is up.", index == active_ ? "Active" : "Standby", link.host, link.port);
+            startLink(index);
+        }
+        if (connectHandler_) {
+            --connectAttemptsLeft_;
+            if (!error || connectAttemptsLeft_ == 0) {
+                handler = std::move(connectHandler_);
+                connectHandler_ = nullptr;
+            }
+        }
+    }
+    if (handler) {
+        handler(error);
+    }
+}
+
+/**
+ * @brief Handles a line received on either connection.
+ * @param index The link the line arrived on.
+ * @param line The received line.
+ */
+void FailoverClient::onLine(std::size_t index, const std::string& line) {
+    std::function<void(const std::string&)> callback;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Link& link = links_[index];
+        const std::string_view key = replyKey(line);
+        // A heartbeat sent before this link became active is answered before anything replayed on it.
+        if (link.heartbeatPending && key == heartbeatKey_) {
+            link.heartbeatPending = false;
+            link.healthy = true;
+            return;
+        }
+        if (index != active_) {
+            spdlog::debug("Ignoring unexpected line on the standby connection: {}", line);
+            return;
+        }
+        auto it = std::find_if(outstanding_.begin(), outstanding_.end(),
+                               [key](const Outstanding& command) { return command.responseKey == key; });
+        if (it != outstanding_.end()) {
+            outstanding_.erase(it);
+        }
+        callback = readCallback_;
+    }
+    if (callback) {
+        deliveringTimestampNs_ = links_[index].client->receiveTimestampNs();
+        callback(line);
+    }
+}
+
+/**
+ * @brief Handles the loss of a connection, failing over if it was the active one.
+ * @param index The link that was lost.
+ * @param error The error that ended the connection.
+ */
+void FailoverClient::onLinkLost(std::size_t index, const std::error_code& error) {
+    const auto detectedAt = std::chrono::steady_clock::now();
+    std::vector<std::string> synthetic;
+    std::function<void(const std::error_code&)> disconnectHandler;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (closed_) {
+            return;
+        }
+        Link& link = links_[index];
+        link.client->close();
+        link.connected = false;
+        link.healthy = false;
+        link.heartbeatPending = false;
+        link.lastAttempt = detectedAt;
+        if (index != active_) {
+            spdlog::warn("Standby connection to {}:{} lost: {}", link.host, link.port, error.message());
+            return;
+        }
+
+        const std::size_t standby = 1 - index;
+        if (!links_[standby].connected) {
+            spdlog::error("Connection to {}:{} lost with no standby available: {}", link.host, link.port, error.message());
+            disconnectHandler = disconnectHandler_;
+            if (disconnectHandler) {
+                outstanding_.clear(); // The handler fails the waiting commands (see ProtocolHandler::initialize)
+            } else {
+                failOutstanding(false, synthetic);
+            }
+        } else {
+            active_ = standby;
+            const std::size_t abandoned = synthetic.size();
+            failOutstanding(true, synthetic);
+            std::string replay;
+            for (const Outstanding& command : outstanding_) {
+                replay += command.line;
+            }
+            if (!replay.empty()) {
+                links_[standby].client->asyncWrite(replay);
+            }
+            const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - detectedAt).count();
+            failovers_.fetch_add(1, std::memory_order_relaxed);
+            lastFailoverUs_.store(elapsed, std::memory_order_relaxed);
+            spdlog::warn("Connection to {}:{} lost ({}); failed over to {}:{} in {} us, {} reads replayed, {} commands failed.",
+                         link.host, link.port, error.message(), links_[standby].host, links_[standby].port, elapsed,
+                         outstanding_.size(), synthetic.size() - abandoned);
+        }
+    }
+    deliverSynthetic(std::move(synthetic));
+    if (disconnectHandler) {
+        disconnectHandler(error);
+    }
+}
+
+/**
+ * @brief Removes outstanding commands that will never be answered. Called with the mutex held.
+ * @param keepReplayable True to keep the commands that will be replayed.
+ * @param synthetic Receives one synthetic error reply per removed command.
+ */
+void FailoverClient::failOutstanding(bool keepReplayable, std::vector<std::string>& synthetic) {
+    auto kept = std::stable_partition(outstanding_.begin(), outstanding_.end(),
+                                      [keepReplayable](const Outstanding& command) {
+                                          return keepReplayable && command.replayable;
+                                      });
+    for (auto it = kept; it != outstanding_.end(); ++it) {
+        synthetic.push_back(syntheticFailure(it->responseKey));
+    }
+    outstanding_.erase(kept, outstanding_.end());
+}
+
+/**
+ * @brief Delivers synthetic replies to the read callback on the I/O context.
+ *
+ * Posting keeps callers that hold their own locks (e.g. ProtocolHandler::sendCommand) from re-entering.
+ * @param lines The reply lines.
+ */
+void FailoverClient::deliverSynthetic(std::vector<std::string> lines) {
+    if (lines.empty()) {
+        return;
+    }
+    boost::asio::post(ioContext_, [this, lines = std::move(lines)]() {
+        std::function<void(const std::string&)> callback;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            callback = readCallback_;
+        }
+        if (!callback) {
+            return;
+        }
+        deliveringTimestampNs_ = 0;
+        for (const std::string& line : lines) {
+            callback(line);
+        }
+    });
+}
+
+/**
+ * @brief Arms the heartbeat timer if it is not already running. Called with the mutex held.
+ */
+void FailoverClient::scheduleHeartbeat() {
+    if (heartbeatScheduled_) {
+        return;
+    }
+    heartbeatScheduled_ = true;
+    impl_->heartbeatTimer.expires_after(std::chrono::milliseconds(config_.heartbeatIntervalMs));
+    impl_->heartbeatTimer.async_wait([this](const boost::system::error_code& error) {
+        if (!error) {
+            this->onHeartbeat();
+        } else {
+            std::lock_guard<std::mutex> lock(mutex_);
+            heartbeatScheduled_ = false;
+        }
+    });
+}
+
+/**
+ * @brief Checks the standby heartbeat and reconnects failed connections.
+ */
+void FailoverClient::onHeartbeat() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    heartbeatScheduled_ = false;
+    if (closed_) {
+        return;
+    }
+    const auto now = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < links_.size(); ++i) {
+        Link& link = links_[i];
+        if (link.connected) {
+            if (i == active_) {
+                continue; // The active connection's own traffic shows whether it is alive
+            }
+            if (!link.heartbeatPending) {
+                link.client->asyncWrite(heartbeatLine_);
+                link.heartbeatPending = true;
+                link.heartbeatSentAt = now;
+            } else if (now - link.heartbeatSentAt > std::chrono::milliseconds(config_.heartbeatTimeoutMs)) {
+                spdlog::warn("Standby connection to {}:{} missed its heartbeat; reconnecting.", link.host, link.port);
+                link.client->close();
+                link.connected = false;
+                link.healthy = false;
+                link.heartbeatPending = false;
+                link.lastAttempt = now;
+            }
+        } else if (!link.connecting && now - link.lastAttempt >= std::chrono::milliseconds(config_.reconnectIntervalMs)) {
+            startConnect(i);
+        }
+    }
+    scheduleHeartbeat();
+}
+
+/**
+ * @brief Returns whether a command may be sent again after a failover.
+ * @param responseKey The command's response key.
+ * @return True if the command's mnemonic is in the replayable list.
+ */
+bool FailoverClient::isReplayable(std::string_view responseKey) const {
+    std::size_t length = 0;
+    while (length < responseKey.size() && std::isalpha(static_cast<unsigned char>(responseKey[length]))) {
+        ++length;
+    }
+    const std::string_view mnemonic = responseKey.substr(0, length);
+    return std::find(config_.replayableCommands.begin(), config_.replayableCommands.end(), mnemonic) !=
+           config_.replayableCommands.end();
+}
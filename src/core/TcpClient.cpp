@@ -2,8 +2,62 @@
 #include "spdlog/spdlog.h"
 #include "protocol/exceptions/ConnectionException.h"
 #include <iostream>
+#include <chrono>
+#include <cstring>
+#include <atomic>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <utility>
+#include <vector>
 #include <boost/asio.hpp>
 
+#if defined(__linux__)
+#include <linux/errqueue.h>
+#include <linux/net_tstamp.h>
+#include <sys/socket.h>
+#endif
+
+namespace {
+
+constexpr std::size_t kReceiveChunkBytes = 4096;
+constexpr std::size_t kSpareWriteBuffers = 8; // Kept for reuse; more only while that many writes are in flight
+
+} // namespace
+
+/**
+ * @struct TcpClient::Impl
+ * @brief The Asio objects and connection state of a TcpClient.
+ */
+struct TcpClient::Impl {
+    Impl(boost::asio::io_context& ioContext, const std::string& host, const std::string& port)
+        : socket(ioContext), resolver(ioContext), reconnectTimer(ioContext), host(host), port(port) {}
+
+    boost::asio::ip::tcp::socket socket;
+    boost::asio::ip::tcp::resolver resolver;
+    boost::asio::streambuf responseBuffer; // Buffer to handle fragmented reads
+    std::string lineBuffer;                // Last received line, reused across reads
+    bool kernelTimestampsRequested = false;
+    bool kernelTimestampsActive = false;
+    std::int64_t lineTimestampNs = 0;      // Receive time of lineBuffer
+    std::uint64_t receivedBytes = 0;       // Stream offsets used to match lines to receive timestamps
+    std::uint64_t consumedBytes = 0;
+    std::deque<std::pair<std::uint64_t, std::int64_t>> chunkTimestamps; // (stream offset after the chunk, receive time)
+    std::mutex handlerMutex;               // Protects disconnectHandler
+    std::function<void(const std::error_code&)> disconnectHandler;
+    std::atomic<bool> disconnectNotified{false};
+    boost::asio::steady_timer reconnectTimer;
+    std::string host;                      // Last address, used to reconnect
+    std::string port;
+    std::function<void(const std::string&)> readCallback;
+    int reconnectIntervalMs = 0;
+    bool reconnectScheduled = false;       // I/O thread only
+    std::atomic<bool> closed{false};       // Set by close() to stop reconnecting
+    std::atomic<bool> connected{false};    // Cleared as soon as a loss is detected
+    std::mutex writeBufferMutex;           // Protects spareWriteBuffers
+    std::vector<std::unique_ptr<std::string>> spareWriteBuffers; // Buffers of completed writes, capacity kept
+};
+
 /**
  * @brief Constructor for TcpClient.
  * @param ioContext The Boost.Asio I/O context.
@@ -11,23 +65,100 @@
  * @param port The port number to connect to.
  */
 TcpClient::TcpClient(boost::asio::io_context& ioContext, const std::string& host, const std::string& port)
-    : socket_(ioContext),
-      resolver_(ioContext) {
+    : impl_(std::make_unique<Impl>(ioContext, host, port)) {
     spdlog::info("TcpClient object created: {}:{}", host, port);
 }
 
+/**
+ * @brief Destructor. Defined here, where Impl is complete.
+ */
+TcpClient::~TcpClient() = default;
+
+/**
+ * @brief Returns whether the socket is delivering kernel receive timestamps.
+ * @return True if SO_TIMESTAMPING was applied to the connected socket.
+ */
+bool TcpClient::kernelTimestampsActive() const {
+    return impl_->kernelTimestampsActive;
+}
+
+/**
+ * @brief Returns when the line currently being delivered to the read callback was received.
+ * @return The kernel receive time in nanoseconds since the epoch, or 0 if kernel timestamps are off.
+ */
+std::int64_t TcpClient::receiveTimestampNs() const {
+    return impl_->lineTimestampNs;
+}
+
 /**
  * @brief Connects to the specified host and port.
  * @param host The hostname or IP address.
  * @param port The port number.
  */
 void TcpClient::connect(const std::string& host, const std::string& port) {
-    try {
-        boost::asio::connect(socket_, resolver_.resolve(host, port));
-        spdlog::info("Successfully connected to the server: {}:{}", host, port);
-    } catch (const boost::system::system_error& e) {
-        throw ConnectionException("Connection failed: " + std::string(e.what()));
+    std::error_code error;
+    connect(host, port, error);
+    if (error) {
+        throw ConnectionException("Connection failed: " + error.message());
+    }
+}
+
+/**
+ * @brief Connects to the specified host and port without throwing.
+ * @param host The hostname or IP address.
+ * @param port The port number.
+ * @param error Set to the failure reason, cleared on success.
+ */
+void TcpClient::connect(const std::string& host, const std::string& port, std::error_code& error) {
+    impl_->host = host;
+    impl_->port = port;
+    impl_->closed.store(false);
+    boost::system::error_code asioError;
+    auto endpoints = impl_->resolver.resolve(host, port, asioError);
+    if (!asioError) {
+        boost::asio::connect(impl_->socket, endpoints, asioError);
+    }
+    error = asioError;
+    if (error) {
+        spdlog::error("Connection to {}:{} failed: {}", host, port, error.message());
+        return;
     }
+    spdlog::info("Successfully connected to the server: {}:{}", host, port);
+    resetReadState();
+    applySocketOptions();
+}
+
+/**
+ * @brief Resolves and connects asynchronously on the I/O context.
+ * @param host The hostname or IP address.
+ * @param port The port number.
+ * @param handler Called on the I/O thread with the result of the connection attempt.
+ */
+void TcpClient::asyncConnect(const std::string& host, const std::string& port,
+                             std::function<void(const std::error_code&)> handler) {
+    impl_->host = host;
+    impl_->port = port;
+    impl_->closed.store(false);
+    impl_->resolver.async_resolve(host, port,
+        [this, host, port, handler](const boost::system::error_code& error,
+                                    boost::asio::ip::tcp::resolver::results_type results) {
+            if (error) {
+                spdlog::error("Failed to resolve {}:{}: {}", host, port, error.message());
+                handler(error);
+                return;
+            }
+            boost::asio::async_connect(impl_->socket, results,
+                [this, host, port, handler](const boost::system::error_code& error, const boost::asio::ip::tcp::endpoint&) {
+                    if (error) {
+                        spdlog::error("Connection to {}:{} failed: {}", host, port, error.message());
+                    } else {
+                        spdlog::info("Successfully connected to the server: {}:{}", host, port);
+                        resetReadState();
+                        applySocketOptions();
+                    }
+                    handler(error);
+                });
+        });
 }
 
 /**
@@ -35,43 +166,375 @@ void TcpClient::connect(const std::string& host, const std::string& port) {
  * @param callback The callback function to be called when data is received.
  */
 void TcpClient::asyncRead(std::function<void(const std::string&)> callback) {
+    // Kept so the read loop can resume after an automatic reconnect.
+    impl_->readCallback = callback;
+    readLoop(std::move(callback));
+}
+
+/**
+ * @brief Reads lines until the connection fails, passing each to the callback.
+ * @param callback The callback function to be called when data is received.
+ */
+void TcpClient::readLoop(std::function<void(const std::string&)> callback) {
+    if (impl_->kernelTimestampsActive) {
+        readWithTimestamps(std::move(callback));
+        return;
+    }
     // Start a new async read operation
-    boost::asio::async_read_until(socket_, responseBuffer_, '\n',
+    boost::asio::async_read_until(impl_->socket, impl_->responseBuffer, '\n',
         [this, callback](const boost::system::error_code& error, std::size_t bytesTransferred) {
             if (!error) {
-                std::string receivedData;
-                // Move data from the buffer to the string until the delimiter is found
-                std::istream is(&responseBuffer_);
-                std::getline(is, receivedData);
-                
+                // Move data from the buffer to the line buffer until the delimiter is found.
+                // The line buffer is a member so its capacity is reused across reads.
+                std::istream is(&impl_->responseBuffer);
+                std::getline(is, impl_->lineBuffer);
+
                 // Add the delimiter back to the string
-                receivedData += '\n';
+                impl_->lineBuffer += '\n';
 
                 // Call the user-provided callback
-                callback(receivedData);
+                callback(impl_->lineBuffer);
 
                 // Continue reading
-                this->asyncRead(callback);
-            } else if (error == boost::asio::error::eof || error == boost::asio::error::connection_reset) {
-                // Handle disconnection
-                spdlog::warn("Server connection closed.");
+                this->readLoop(callback);
             } else {
-                spdlog::error("Asynchronous read error: {}", error.message());
+                this->handleReadError(error);
             }
         });
 }
 
+/**
+ * @brief Logs a failed read and reports the lost connection.
+ * @param error The read error.
+ */
+void TcpClient::handleReadError(const boost::system::error_code& error) {
+    if (error == boost::asio::error::operation_aborted || impl_->closed.load()) {
+        return; // Cancelled by close()
+    }
+    if (error == boost::asio::error::eof || error == boost::asio::error::connection_reset) {
+        // Handle disconnection
+        spdlog::warn("Server connection closed.");
+    } else {
+        spdlog::error("Asynchronous read error: {}", error.message());
+    }
+    notifyDisconnect(error);
+}
+
+/**
+ * @brief Calls the disconnect handler once per connection.
+ * @param error The reason the connection was lost.
+ */
+void TcpClient::notifyDisconnect(const std::error_code& error) {
+    impl_->connected.store(false);
+    if (impl_->disconnectNotified.exchange(true)) {
+        return;
+    }
+    std::function<void(const std::error_code&)> handler;
+    {
+        std::lock_guard<std::mutex> lock(impl_->handlerMutex);
+        handler = impl_->disconnectHandler;
+    }
+    if (handler) {
+        handler(error);
+    }
+    if (impl_->reconnectIntervalMs > 0 && !impl_->closed.load()) {
+        boost::asio::post(impl_->socket.get_executor(), [this]() { this->scheduleReconnect(); });
+    }
+}
+
+/**
+ * @brief Enables automatic reconnection after the connection is lost.
+ * @param intervalMs The delay between reconnect attempts in milliseconds, or 0 to disable.
+ */
+void TcpClient::setAutoReconnect(int intervalMs) {
+    impl_->reconnectIntervalMs = intervalMs;
+}
+
+/**
+ * @brief Arms the reconnect timer unless an attempt is already scheduled. Runs on the I/O thread.
+ */
+void TcpClient::scheduleReconnect() {
+    if (impl_->reconnectScheduled || impl_->closed.load()) {
+        return;
+    }
+    impl_->reconnectScheduled = true;
+    impl_->reconnectTimer.expires_after(std::chrono::milliseconds(impl_->reconnectIntervalMs));
+    impl_->reconnectTimer.async_wait([this](const boost::system::error_code& error) {
+        if (error || impl_->closed.load()) {
+            impl_->reconnectScheduled = false;
+            return;
+        }
+        spdlog::info("Reconnecting to {}:{}.", impl_->host, impl_->port);
+        boost::system::error_code ignored;
+        impl_->socket.close(ignored);
+        asyncConnect(impl_->host, impl_->port, [this](const std::error_code& connectError) {
+            impl_->reconnectScheduled = false;
+            if (connectError) {
+                scheduleReconnect();
+            } else if (impl_->readCallback) {
+                readLoop(impl_->readCallback);
+            }
+        });
+    });
+}
+
+/**
+ * @brief Tears down the connection and reports it as lost.
+ * @param reason The reason passed to the disconnect handler.
+ */
+void TcpClient::dropConnection(const std::error_code& reason) {
+    boost::asio::post(impl_->socket.get_executor(), [this, reason]() {
+        spdlog::warn("Dropping connection to {}:{}: {}", impl_->host, impl_->port, reason.message());
+        boost::system::error_code ignored;
+        impl_->socket.shutdown(boost::asio::ip::tcp::socket::shutdown_both, ignored);
+        impl_->socket.close(ignored);
+        // Report even if the loss was already reported: commands written since then are still waiting.
+        impl_->disconnectNotified.store(false);
+        notifyDisconnect(reason);
+    });
+}
+
+/**
+ * @brief Sets the function called when an established connection is lost.
+ * @param handler Called on the I/O thread with the error that ended the connection.
+ */
+void TcpClient::setDisconnectHandler(std::function<void(const std::error_code&)> handler) {
+    std::lock_guard<std::mutex> lock(impl_->handlerMutex);
+    impl_->disconnectHandler = std::move(handler);
+}
+
+/**
+ * @brief Closes the connection and stops reconnecting, without reporting a disconnect.
+ */
+void TcpClient::close() {
+    impl_->closed.store(true);
+    impl_->connected.store(false);
+    impl_->disconnectNotified.store(true);
+    // The socket and the timer are not thread-safe, so they are torn down on the I/O thread.
+    auto done = std::make_shared<std::promise<void>>();
+    auto started = std::make_shared<std::atomic<bool>>(false);
+    auto teardown = [this, done, started]() {
+        if (started->exchange(true)) {
+            return;
+        }
+        impl_->reconnectTimer.cancel();
+        boost::system::error_code ignored;
+        impl_->socket.shutdown(boost::asio::ip::tcp::socket::shutdown_both, ignored);
+        impl_->socket.close(ignored);
+        done->set_value();
+    };
+    auto& ioContext = static_cast<boost::asio::io_context&>(impl_->socket.get_executor().context());
+    if (ioContext.get_executor().running_in_this_thread()) {
+        teardown();
+        return;
+    }
+    boost::asio::post(ioContext, teardown);
+    // Without a thread running the I/O context, nothing else touches the socket: tear it down here.
+    std::future<void> finished = done->get_future();
+    while (finished.wait_for(std::chrono::milliseconds(10)) != std::future_status::ready) {
+        if (ioContext.stopped()) {
+            teardown();
+        }
+    }
+}
+
+/**
+ * @brief Discards buffered data from a previous connection and marks the client connected.
+ */
+void TcpClient::resetReadState() {
+    impl_->responseBuffer.consume(impl_->responseBuffer.size());
+    impl_->receivedBytes = 0;
+    impl_->consumedBytes = 0;
+    impl_->chunkTimestamps.clear();
+    impl_->lineTimestampNs = 0;
+    impl_->disconnectNotified.store(false);
+    impl_->connected.store(true);
+}
+
 /**
  * @brief Asynchronously writes data to the socket.
  * @param data The string data to be sent.
  */
 void TcpClient::asyncWrite(const std::string& data) {
-    boost::asio::async_write(socket_, boost::asio::buffer(data),
-        [this, data](const boost::system::error_code& error, std::size_t bytesTransferred) {
+    if (!impl_->connected.load()) {
+        // Nothing written now would be answered; report it so waiting commands fail instead of timing out.
+        boost::asio::post(impl_->socket.get_executor(), [this]() {
+            if (!impl_->connected.load() && !impl_->closed.load()) {
+                impl_->disconnectNotified.store(false);
+                notifyDisconnect(std::make_error_code(std::errc::not_connected));
+            }
+        });
+        return;
+    }
+    // The buffer must stay alive until the write completes, so the handler owns it. Buffers are
+    // handed back for reuse, so steady traffic copies into existing capacity instead of allocating.
+    std::unique_ptr<std::string> payload;
+    {
+        std::lock_guard<std::mutex> lock(impl_->writeBufferMutex);
+        if (!impl_->spareWriteBuffers.empty()) {
+            payload = std::move(impl_->spareWriteBuffers.back());
+            impl_->spareWriteBuffers.pop_back();
+        }
+    }
+    if (!payload) {
+        payload = std::make_unique<std::string>();
+    }
+    payload->assign(data);
+    const boost::asio::const_buffer buffer = boost::asio::buffer(*payload);
+    boost::asio::async_write(impl_->socket, buffer,
+        [this, payload = std::move(payload)](const boost::system::error_code& error, std::size_t bytesTransferred) mutable {
+            {
+                std::lock_guard<std::mutex> lock(impl_->writeBufferMutex);
+                if (impl_->spareWriteBuffers.size() < kSpareWriteBuffers) {
+                    impl_->spareWriteBuffers.push_back(std::move(payload));
+                }
+            }
             if (!error) {
                 spdlog::debug("Successfully transmitted {} bytes of data.", bytesTransferred);
-            } else {
+            } else if (error != boost::asio::error::operation_aborted) {
                 spdlog::error("Asynchronous write error: {}", error.message());
+                this->notifyDisconnect(error);
             }
         });
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Requests kernel software receive timestamps for incoming data.
+ * @param enable True to request kernel timestamps.
+ */
+void TcpClient::setKernelTimestamps(bool enable) {
+    impl_->kernelTimestampsRequested = enable;
+    if (impl_->socket.is_open()) {
+        applySocketOptions();
+    }
+}
+
+/**
+ * @brief Applies the requested socket options to a freshly connected socket.
+ */
+void TcpClient::applySocketOptions() {
+    impl_->kernelTimestampsActive = false;
+    if (!impl_->kernelTimestampsRequested) {
+        return;
+    }
+#if defined(__linux__)
+    const int flags = SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE;
+    if (::setsockopt(impl_->socket.native_handle(), SOL_SOCKET, SO_TIMESTAMPING, &flags, sizeof(flags)) == 0) {
+        impl_->kernelTimestampsActive = true;
+        spdlog::info("Kernel receive timestamps enabled.");
+    } else {
+        spdlog::warn("Kernel receive timestamps unavailable ({}); using user-space timestamps.", std::strerror(errno));
+    }
+#else
+    spdlog::warn("Kernel receive timestamps are not supported on this platform; using user-space timestamps.");
+#endif
+}
+
+/**
+ * @brief Read loop used when kernel timestamps are active.
+ *
+ * Waits for readability, receives with recvmsg to collect the timestamp,
+ * then delivers every complete line with the timestamp of the data that completed it.
+ * @param callback The callback function to be called for each received line.
+ */
+void TcpClient::readWithTimestamps(std::function<void(const std::string&)> callback) {
+    impl_->socket.async_wait(boost::asio::ip::tcp::socket::wait_read,
+        [this, callback](const boost::system::error_code& waitError) {
+            boost::system::error_code error = waitError;
+            if (!error) {
+                receiveWithTimestamp(error);
+                if (error == boost::asio::error::would_block || error == boost::asio::error::try_again) {
+                    this->readWithTimestamps(callback);
+                    return;
+                }
+            }
+            if (!error) {
+                while (extractTimestampedLine()) {
+                    callback(impl_->lineBuffer);
+                }
+                this->readWithTimestamps(callback);
+            } else {
+                this->handleReadError(error);
+            }
+        });
+}
+
+/**
+ * @brief Receives available data into the response buffer and records its kernel timestamp.
+ * @param error Set to the failure reason, cleared on success.
+ */
+void TcpClient::receiveWithTimestamp(boost::system::error_code& error) {
+    error.clear();
+    std::int64_t timestampNs = 0;
+    std::size_t received = 0;
+#if defined(__linux__)
+    auto buffer = impl_->responseBuffer.prepare(kReceiveChunkBytes);
+    iovec iov{buffer.data(), buffer.size()};
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(scm_timestamping))];
+    msghdr message{};
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+    const ssize_t result = ::recvmsg(impl_->socket.native_handle(), &message, MSG_DONTWAIT);
+    if (result < 0) {
+        error = boost::system::error_code(errno, boost::system::system_category());
+        return;
+    }
+    if (result == 0) {
+        error = boost::asio::error::eof;
+        return;
+    }
+    received = static_cast<std::size_t>(result);
+    for (cmsghdr* header = CMSG_FIRSTHDR(&message); header != nullptr; header = CMSG_NXTHDR(&message, header)) {
+        if (header->cmsg_level == SOL_SOCKET && header->cmsg_type == SO_TIMESTAMPING) {
+            scm_timestamping stamps;
+            std::memcpy(&stamps, CMSG_DATA(header), sizeof(stamps));
+            // ts[0] is the software timestamp, on CLOCK_REALTIME like the rest of the library.
+            timestampNs = static_cast<std::int64_t>(stamps.ts[0].tv_sec) * 1000000000 + stamps.ts[0].tv_nsec;
+        }
+    }
+#else
+    received = impl_->socket.read_some(impl_->responseBuffer.prepare(kReceiveChunkBytes), error);
+    if (error) {
+        return;
+    }
+#endif
+    if (timestampNs == 0) {
+        timestampNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+    impl_->responseBuffer.commit(received);
+    impl_->receivedBytes += received;
+    impl_->chunkTimestamps.emplace_back(impl_->receivedBytes, timestampNs);
+}
+
+/**
+ * @brief Moves the next complete line out of the response buffer, with its receive timestamp.
+ * @return True if a line was extracted into the line buffer.
+ */
+bool TcpClient::extractTimestampedLine() {
+    const auto data = impl_->responseBuffer.data();
+    const char* begin = static_cast<const char*>(data.data());
+    const void* newline = std::memchr(begin, '\n', data.size());
+    if (newline == nullptr) {
+        return false;
+    }
+    const std::size_t length = static_cast<const char*>(newline) - begin + 1;
+    impl_->lineBuffer.assign(begin, length);
+    impl_->responseBuffer.consume(length);
+
+    // The line is complete once its final byte has arrived, so it takes the timestamp of that chunk.
+    const std::uint64_t lastByte = impl_->consumedBytes + length - 1;
+    impl_->consumedBytes += length;
+    for (const auto& chunk : impl_->chunkTimestamps) {
+        if (chunk.first > lastByte) {
+            impl_->lineTimestampNs = chunk.second;
+            break;
+        }
+    }
+    while (!impl_->chunkTimestamps.empty() && impl_->chunkTimestamps.front().first <= impl_->consumedBytes) {
+        impl_->chunkTimestamps.pop_front();
+    }
+    return true;
+}
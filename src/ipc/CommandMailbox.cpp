@@ -0,0 +1,485 @@
+#include "ipc/CommandMailbox.h"
+#include "common/CycleArena.h"
+#include "common/LockFreeQueue.h"
+#include "protocol/ProtocolError.h"
+#include "spdlog/spdlog.h"
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/interprocess/shared_memory_object.hpp>
+#include <algorithm>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <vector>
+
+namespace bip = boost::interprocess;
+
+namespace {
+
+constexpr std::uint32_t kMailboxMagic = 0x58424D4B; // "KMBX"
+constexpr std::uint32_t kMailboxVersion = 2;
+constexpr std::size_t kCacheLine = 64;
+constexpr std::size_t kArenaBytes = 16 * 1024;
+
+// Atomics shared between processes must not fall back to a process-local lock.
+static_assert(std::atomic<std::uint64_t>::is_always_lock_free, "64-bit atomics must be lock-free");
+static_assert(std::atomic<std::uint32_t>::is_always_lock_free, "32-bit atomics must be lock-free");
+
+enum SlotState : std::uint32_t {
+    slotFree = 0,
+    slotSubmitted = 1,
+    slotInFlight = 2,
+    slotCompleted = 3
+};
+
+/**
+ * @brief Fixed part of the segment, written once by the server.
+ */
+struct alignas(kCacheLine) MailboxHeader {
+    std::uint32_t magic;
+    std::uint32_t version;
+    std::uint32_t slotCount;
+    std::uint32_t slotBytes;
+    std::atomic<std::uint32_t> ready; // Set last, once the layout is initialized
+};
+
+/**
+ * @brief Positions of one index ring, each on its own cache line.
+ */
+struct RingHeader {
+    alignas(kCacheLine) std::atomic<std::uint64_t> enqueuePos;
+    alignas(kCacheLine) std::atomic<std::uint64_t> dequeuePos;
+};
+
+struct RingCell {
+    std::atomic<std::uint64_t> sequence;
+    std::uint32_t value;
+    std::uint32_t reserved;
+};
+
+/**
+ * @brief Per-slot header, followed by slotBytes of command or reply text.
+ */
+struct SlotHeader {
+    std::atomic<std::uint32_t> state;
+    std::uint32_t result;
+    std::uint32_t length;
+    std::atomic<std::uint32_t> abandoned; // Set by release(); whoever clears it frees the slot
+};
+
+std::size_t alignUp(std::size_t value, std::size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+std::uint32_t roundUpToPowerOfTwo(std::uint32_t value) {
+    std::uint32_t result = 1;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+
+/**
+ * @class IndexRing
+ * @brief Queue of slot indexes kept in the mailbox segment.
+ *
+ * An MpmcRing over a RingHeader and its RingCells in shared memory, so the
+ * server and every client process push and pop the same ring.
+ */
+class IndexRing {
+public:
+    IndexRing() = default;
+    IndexRing(RingHeader* header, RingCell* cells, std::uint32_t capacity)
+        : header_(header), cells_(cells), ring_(&header->enqueuePos, &header->dequeuePos, cells, capacity) {}
+
+    /**
+     * @brief Constructs the header and cells in the fresh segment and empties the ring. Server only.
+     * @param capacity The number of cells.
+     */
+    void initialize(std::uint32_t capacity) {
+        new (header_) RingHeader();
+        for (std::uint32_t i = 0; i < capacity; ++i) {
+            new (&cells_[i]) RingCell();
+        }
+        ring_.initialize();
+    }
+
+    bool push(std::uint32_t value) { return ring_.tryPush(value); }
+    bool pop(std::uint32_t& value) { return ring_.tryPop(value); }
+
+private:
+    RingHeader* header_ = nullptr;
+    RingCell* cells_ = nullptr;
+    MpmcRing<RingCell, std::uint64_t> ring_;
+};
+
+/**
+ * @brief Splits an encoded command line into command, axis number and parameters.
+ * @param line The command line, with or without a trailing CR/LF.
+ * @param baseCommand Receives the command mnemonic.
+ * @param axisNo Receives the axis number, or -1 if there is none.
+ * @param params Receives the parameters.
+ * @return False if the line is not a valid command.
+ */
+bool parseCommandLine(std::string_view line, std::string_view& baseCommand, int& axisNo, std::vector<std::string>& params) {
+    while (!line.empty() && (line.back() == '\n' || line.back() == '\r')) {
+        line.remove_suffix(1);
+    }
+    std::size_t pos = 0;
+    while (pos < line.size() && line[pos] >= 'A' && line[pos] <= 'Z') {
+        ++pos;
+    }
+    if (pos == 0) {
+        return false;
+    }
+    baseCommand = line.substr(0, pos);
+
+    const std::size_t digitsStart = pos;
+    while (pos < line.size() && line[pos] >= '0' && line[pos] <= '9') {
+        ++pos;
+    }
+    axisNo = -1;
+    if (pos > digitsStart && parseInteger(line.substr(digitsStart, pos - digitsStart), axisNo)) {
+        return false;
+    }
+
+    params.clear();
+    if (pos == line.size()) {
+        return true;
+    }
+    if (line[pos] == '/') {
+        ++pos;
+    }
+    std::string_view rest = line.substr(pos);
+    for (;;) {
+        const std::size_t slash = rest.find('/');
+        params.emplace_back(rest.substr(0, slash));
+        if (slash == std::string_view::npos) {
+            break;
+        }
+        rest.remove_prefix(slash + 1);
+    }
+    return true;
+}
+
+} // namespace
+
+/**
+ * @struct MailboxMapping
+ * @brief The mapped mailbox segment and the addresses of its parts in this process.
+ */
+struct MailboxMapping {
+    bip::shared_memory_object segment;
+    bip::mapped_region region;
+    MailboxHeader* header = nullptr;
+    IndexRing freeSlots;
+    IndexRing submittedSlots;
+    unsigned char* slotBase = nullptr;
+    std::size_t slotStride = 0;
+    std::uint32_t slotCount = 0;
+    std::uint32_t slotBytes = 0;
+
+    static std::size_t ringCellsOffset(std::uint32_t slotCount, int ring) {
+        return alignUp(sizeof(MailboxHeader), kCacheLine) + 2 * sizeof(RingHeader) +
+               static_cast<std::size_t>(ring) * alignUp(slotCount * sizeof(RingCell), kCacheLine);
+    }
+
+    static std::size_t slotsOffset(std::uint32_t slotCount) {
+        return ringCellsOffset(slotCount, 2);
+    }
+
+    static std::size_t stride(std::uint32_t slotBytes) {
+        return alignUp(sizeof(SlotHeader) + slotBytes, kCacheLine);
+    }
+
+    /**
+     * @brief Resolves the addresses of the rings and slots from the mapped header.
+     */
+    void bind() {
+        auto* base = static_cast<unsigned char*>(region.get_address());
+        header = reinterpret_cast<MailboxHeader*>(base);
+        slotCount = header->slotCount;
+        slotBytes = header->slotBytes;
+        auto* ringHeaders = reinterpret_cast<RingHeader*>(base + alignUp(sizeof(MailboxHeader), kCacheLine));
+        freeSlots = IndexRing(&ringHeaders[0], reinterpret_cast<RingCell*>(base + ringCellsOffset(slotCount, 0)), slotCount);
+        submittedSlots = IndexRing(&ringHeaders[1], reinterpret_cast<RingCell*>(base + ringCellsOffset(slotCount, 1)), slotCount);
+        slotBase = base + slotsOffset(slotCount);
+        slotStride = stride(slotBytes);
+    }
+
+    SlotHeader* slot(std::uint32_t index) {
+        return reinterpret_cast<SlotHeader*>(slotBase + index * slotStride);
+    }
+
+    char* payload(std::uint32_t index) {
+        return reinterpret_cast<char*>(slotBase + index * slotStride + sizeof(SlotHeader));
+    }
+
+    /**
+     * @brief Stores a reply in a slot and hands the slot back to its client.
+     */
+    void complete(std::uint32_t index, MailboxResult result, std::string_view text) {
+        SlotHeader* header = slot(index);
+        if (result == MailboxResult::completed && text.size() > slotBytes) {
+            result = MailboxResult::truncated;
+        }
+        const std::size_t length = std::min<std::size_t>(text.size(), slotBytes);
+        std::memcpy(payload(index), text.data(), length);
+        header->length = static_cast<std::uint32_t>(length);
+        header->result = static_cast<std::uint32_t>(result);
+        header->state.store(slotCompleted);
+        reclaimAbandoned(index);
+    }
+
+    /**
+     * @brief Frees a completed slot whose client released its ticket. Both the server and the
+     *        releasing client call this; the one that clears the flag frees the slot.
+     */
+    void reclaimAbandoned(std::uint32_t index) {
+        SlotHeader* header = slot(index);
+        std::uint32_t expected = 1;
+        if (header->state.load() == slotCompleted && header->abandoned.compare_exchange_strong(expected, 0)) {
+            header->state.store(slotFree, std::memory_order_relaxed);
+            freeSlots.push(index);
+        }
+    }
+};
+
+/**
+ * @brief Constructor for the CommandMailboxServer class.
+ * @param name The segment name shared with clients.
+ * @param protocolHandler The handler used to send the commands.
+ * @param config The mailbox settings.
+ */
+CommandMailboxServer::CommandMailboxServer(const std::string& name, std::shared_ptr<ProtocolHandler> protocolHandler,
+                                           Config config)
+    : name_(name), protocolHandler_(std::move(protocolHandler)), config_(config) {
+    if (!protocolHandler_) {
+        throw std::invalid_argument("ProtocolHandler object is not valid.");
+    }
+    config_.slotCount = roundUpToPowerOfTwo(std::max<std::uint32_t>(config_.slotCount, 1));
+    config_.slotBytes = std::max<std::uint32_t>(config_.slotBytes, 16);
+    const std::size_t totalBytes = MailboxMapping::slotsOffset(config_.slotCount) +
+                                   config_.slotCount * MailboxMapping::stride(config_.slotBytes);
+
+    // Replace a segment left behind by a previous server that did not shut down cleanly.
+    bip::shared_memory_object::remove(name_.c_str());
+    mapping_ = std::make_shared<MailboxMapping>();
+    mapping_->segment = bip::shared_memory_object(bip::create_only, name_.c_str(), bip::read_write);
+    mapping_->segment.truncate(static_cast<bip::offset_t>(totalBytes));
+    mapping_->region = bip::mapped_region(mapping_->segment, bip::read_write);
+
+    auto* header = new (mapping_->region.get_address()) MailboxHeader();
+    header->magic = kMailboxMagic;
+    header->version = kMailboxVersion;
+    header->slotCount = config_.slotCount;
+    header->slotBytes = config_.slotBytes;
+    mapping_->bind();
+    mapping_->freeSlots.initialize(config_.slotCount);
+    mapping_->submittedSlots.initialize(config_.slotCount);
+    for (std::uint32_t i = 0; i < config_.slotCount; ++i) {
+        SlotHeader* slot = new (mapping_->slot(i)) SlotHeader();
+        slot->state.store(slotFree, std::memory_order_relaxed);
+        slot->abandoned.store(0, std::memory_order_relaxed);
+        mapping_->freeSlots.push(i);
+    }
+    header->ready.store(1, std::memory_order_release);
+    spdlog::info("Command mailbox '{}' created: {} slots of {} bytes.", name_, config_.slotCount, config_.slotBytes);
+}
+
+/**
+ * @brief Constructor for the CommandMailboxServer class with default settings.
+ * @param name The segment name shared with clients.
+ * @param protocolHandler The handler used to send the commands.
+ */
+CommandMailboxServer::CommandMailboxServer(const std::string& name, std::shared_ptr<ProtocolHandler> protocolHandler)
+    : CommandMailboxServer(name, std::move(protocolHandler), Config{}) {}
+
+/**
+ * @brief Destructor for the CommandMailboxServer class.
+ *
+ * Stops the server thread and removes the segment name. The mapping itself
+ * stays valid until the last pending reply has been delivered.
+ */
+CommandMailboxServer::~CommandMailboxServer() {
+    stop();
+    bip::shared_memory_object::remove(name_.c_str());
+}
+
+/**
+ * @brief Starts the server thread.
+ */
+void CommandMailboxServer::start() {
+    if (isRunning_.exchange(true)) {
+        return;
+    }
+    serverThread_ = std::thread(&CommandMailboxServer::serverThreadFunction, this);
+}
+
+/**
+ * @brief Stops the server thread.
+ */
+void CommandMailboxServer::stop() {
+    if (!isRunning_.exchange(false)) {
+        return;
+    }
+    if (serverThread_.joinable()) {
+        serverThread_.join();
+    }
+}
+
+/**
+ * @brief The function executed by the server thread.
+ *
+ * Forwards every submitted command found in one pass as a single pipelined write.
+ */
+void CommandMailboxServer::serverThreadFunction() {
+    CycleArena arena(kArenaBytes);
+    std::vector<std::string> params;
+    std::shared_ptr<MailboxMapping> mapping = mapping_;
+    while (isRunning_.load()) {
+        std::size_t sent = 0;
+        {
+            CommandBatch batch(arena.resource());
+            std::uint32_t index = 0;
+            while (batch.size() < mapping->slotCount && mapping->submittedSlots.pop(index)) {
+                SlotHeader* slot = mapping->slot(index);
+                const std::string_view line(mapping->payload(index), std::min(slot->length, mapping->slotBytes));
+                std::string_view baseCommand;
+                int axisNo = -1;
+                if (!parseCommandLine(line, baseCommand, axisNo, params)) {
+                    spdlog::warn("Command mailbox '{}': rejected malformed command '{}'.", name_, line);
+                    mapping->complete(index, MailboxResult::malformedCommand, {});
+                    continue;
+                }
+                slot->state.store(slotInFlight, std::memory_order_relaxed);
+                batch.add(baseCommand, axisNo, params, [mapping, index](const ProtocolResponse& response) {
+                    std::string_view text = response.fullResponse;
+                    while (!text.empty() && (text.back() == '\n' || text.back() == '\r')) {
+                        text.remove_suffix(1);
+                    }
+                    mapping->complete(index, MailboxResult::completed, text);
+                });
+            }
+            sent = batch.size();
+            protocolHandler_->sendBatch(batch);
+        }
+        arena.reset();
+
+        if (sent > 0) {
+            forwarded_.fetch_add(sent, std::memory_order_relaxed);
+        } else {
+            std::this_thread::sleep_for(std::chrono::microseconds(config_.pollIntervalUs));
+        }
+    }
+}
+
+/**
+ * @brief Constructor for the CommandMailboxClient class.
+ * @param name The segment name used by the server.
+ */
+CommandMailboxClient::CommandMailboxClient(const std::string& name)
+    : mapping_(std::make_shared<MailboxMapping>()) {
+    mapping_->segment = bip::shared_memory_object(bip::open_only, name.c_str(), bip::read_write);
+    mapping_->region = bip::mapped_region(mapping_->segment, bip::read_write);
+    if (mapping_->region.get_size() < sizeof(MailboxHeader)) {
+        throw std::runtime_error("Command mailbox '" + name + "' is too small.");
+    }
+    const auto* header = static_cast<const MailboxHeader*>(mapping_->region.get_address());
+    if (header->ready.load(std::memory_order_acquire) != 1 || header->magic != kMailboxMagic ||
+        header->version != kMailboxVersion) {
+        throw std::runtime_error("Command mailbox '" + name + "' is not initialized or has an incompatible version.");
+    }
+    mapping_->bind();
+    if (mapping_->region.get_size() < MailboxMapping::slotsOffset(mapping_->slotCount) +
+                                          mapping_->slotCount * mapping_->slotStride) {
+        throw std::runtime_error("Command mailbox '" + name + "' is truncated.");
+    }
+}
+
+/**
+ * @brief Destructor for the CommandMailboxClient class.
+ */
+CommandMailboxClient::~CommandMailboxClient() = default;
+
+/**
+ * @brief Submits an encoded command line.
+ * @param command The command line.
+ * @param ticket Receives the ticket used to collect the reply.
+ * @return False if the mailbox is full or the command does not fit in a slot.
+ */
+bool CommandMailboxClient::submit(std::string_view command, std::uint32_t& ticket) {
+    if (command.empty() || command.size() > mapping_->slotBytes) {
+        return false;
+    }
+    std::uint32_t index = 0;
+    if (!mapping_->freeSlots.pop(index)) {
+        return false;
+    }
+    SlotHeader* slot = mapping_->slot(index);
+    std::memcpy(mapping_->payload(index), command.data(), command.size());
+    slot->length = static_cast<std::uint32_t>(command.size());
+    slot->result = static_cast<std::uint32_t>(MailboxResult::completed);
+    slot->state.store(slotSubmitted, std::memory_order_relaxed);
+    // Every slot is in exactly one ring, so the submitted ring always has room.
+    mapping_->submittedSlots.push(index);
+    ticket = index;
+    return true;
+}
+
+/**
+ * @brief Collects the reply for a ticket if it has arrived.
+ * @param ticket The ticket returned by submit().
+ * @param completion Receives the reply.
+ * @return True if the reply was collected.
+ */
+bool CommandMailboxClient::poll(std::uint32_t ticket, MailboxCompletion& completion) {
+    if (ticket >= mapping_->slotCount) {
+        return false;
+    }
+    SlotHeader* slot = mapping_->slot(ticket);
+    if (slot->state.load(std::memory_order_acquire) != slotCompleted) {
+        return false;
+    }
+    completion.result = static_cast<MailboxResult>(slot->result);
+    completion.response.assign(mapping_->payload(ticket), std::min(slot->length, mapping_->slotBytes));
+    slot->state.store(slotFree, std::memory_order_relaxed);
+    mapping_->freeSlots.push(ticket);
+    return true;
+}
+
+/**
+ * @brief Gives up on a ticket whose reply will not be collected.
+ * @param ticket The ticket returned by submit().
+ */
+void CommandMailboxClient::release(std::uint32_t ticket) {
+    if (ticket >= mapping_->slotCount) {
+        return;
+    }
+    mapping_->slot(ticket)->abandoned.store(1);
+    // Frees the slot here if the reply has already arrived; otherwise the server frees it on completion.
+    mapping_->reclaimAbandoned(ticket);
+}
+
+/**
+ * @brief Waits for the reply for a ticket.
+ * @param ticket The ticket returned by submit().
+ * @param completion Receives the reply.
+ * @param timeout The maximum time to wait.
+ * @return True if the reply was collected, false on timeout.
+ */
+bool CommandMailboxClient::wait(std::uint32_t ticket, MailboxCompletion& completion, std::chrono::milliseconds timeout) {
+    constexpr int spinIterations = 1000;
+    for (int i = 0; i < spinIterations; ++i) {
+        if (poll(ticket, completion)) {
+            return true;
+        }
+    }
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (std::chrono::steady_clock::now() < deadline) {
+        if (poll(ticket, completion)) {
+            return true;
+        }
+        std::this_thread::yield();
+    }
+    return poll(ticket, completion);
+}
@@ -0,0 +1,2 @@
+#include "protocol/BasicProtocolHandler.h"
+// Implementation is included in the header file as it's a template class.
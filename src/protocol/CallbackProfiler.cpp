@@ -0,0 +1,136 @@
+#include "protocol/CallbackProfiler.h"
+#include "spdlog/spdlog.h"
+#include <algorithm>
+
+/**
+ * @brief Returns the file name without its directory.
+ * @return The base name of file.
+ */
+std::string_view CallSite::fileName() const {
+    const std::string_view path = file;
+    const std::size_t slash = path.find_last_of("/\\");
+    return slash == std::string_view::npos ? path : path.substr(slash + 1);
+}
+
+/**
+ * @brief Returns an upper bound of the given quantile of the callback duration.
+ * @param quantile The quantile, between 0 and 1.
+ * @return The upper edge of the histogram bucket holding the quantile, in microseconds.
+ */
+std::int64_t CallbackSiteStats::quantileUs(double quantile) const {
+    if (calls == 0) {
+        return 0;
+    }
+    const double target = std::clamp(quantile, 0.0, 1.0) * static_cast<double>(calls);
+    std::uint64_t seen = 0;
+    for (std::size_t i = 0; i < kBuckets; ++i) {
+        seen += histogram[i];
+        if (static_cast<double>(seen) >= target && seen > 0) {
+            return std::int64_t{1} << i;
+        }
+    }
+    return std::int64_t{1} << (kBuckets - 1);
+}
+
+/**
+ * @brief Constructor for the CallbackProfiler class.
+ * @param budget Callbacks running longer than this are reported.
+ */
+CallbackProfiler::CallbackProfiler(std::chrono::microseconds budget)
+    : budgetNs_(std::chrono::duration_cast<std::chrono::nanoseconds>(budget).count()) {}
+
+/**
+ * @brief Changes the budget.
+ * @param budget Callbacks running longer than this are reported.
+ */
+void CallbackProfiler::setBudget(std::chrono::microseconds budget) {
+    budgetNs_.store(std::chrono::duration_cast<std::chrono::nanoseconds>(budget).count(), std::memory_order_relaxed);
+}
+
+/**
+ * @brief Returns the budget.
+ * @return The budget.
+ */
+std::chrono::microseconds CallbackProfiler::budget() const {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::nanoseconds(budgetNs_.load(std::memory_order_relaxed)));
+}
+
+/**
+ * @brief Sets a function called, instead of logging, for every callback over the budget.
+ * @param handler The handler, or nullptr to log again.
+ */
+void CallbackProfiler::setSlowCallbackHandler(std::function<void(const SlowCallback&)> handler) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    slowCallbackHandler_ = std::move(handler);
+}
+
+/**
+ * @brief Records one callback invocation.
+ * @param site Where the callback was registered.
+ * @param command The command the callback answered.
+ * @param axisNo The axis of the command, or -1.
+ * @param durationNs How long the callback ran.
+ */
+void CallbackProfiler::record(const CallSite& site, std::string_view command, int axisNo, std::int64_t durationNs) {
+    const bool slow = durationNs > budgetNs_.load(std::memory_order_relaxed);
+    std::size_t bucket = 0;
+    for (std::int64_t us = durationNs / 1000; us > 0 && bucket < CallbackSiteStats::kBuckets - 1; us >>= 1) {
+        ++bucket;
+    }
+
+    std::function<void(const SlowCallback&)> handler;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = sites_.find(SiteKey{site.file, site.line});
+        if (it == sites_.end()) {
+            it = sites_.emplace(SiteKey{site.file, site.line}, CallbackSiteStats{}).first;
+            it->second.site = site;
+        }
+        CallbackSiteStats& stats = it->second;
+        ++stats.calls;
+        stats.totalNs += durationNs;
+        stats.maxNs = std::max(stats.maxNs, durationNs);
+        ++stats.histogram[bucket];
+        if (!slow) {
+            return;
+        }
+        ++stats.slowCalls;
+        handler = slowCallbackHandler_;
+    }
+
+    slowCallbacks_.fetch_add(1, std::memory_order_relaxed);
+    if (handler) {
+        handler(SlowCallback{site, std::string(command), axisNo, durationNs});
+    } else {
+        spdlog::warn("Slow callback: {}{} took {:.3f} ms (budget {:.3f} ms), registered at {}:{} in {}.", command,
+                     axisNo >= 0 ? std::to_string(axisNo) : std::string(), durationNs / 1e6,
+                     budgetNs_.load(std::memory_order_relaxed) / 1e6, site.fileName(), site.line, site.function);
+    }
+}
+
+/**
+ * @brief Returns the statistics of every call site, slowest maximum first.
+ * @return The per-site statistics.
+ */
+std::vector<CallbackSiteStats> CallbackProfiler::snapshot() const {
+    std::vector<CallbackSiteStats> result;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        result.reserve(sites_.size());
+        for (const auto& [key, stats] : sites_) {
+            result.push_back(stats);
+        }
+    }
+    std::sort(result.begin(), result.end(),
+              [](const CallbackSiteStats& a, const CallbackSiteStats& b) { return a.maxNs > b.maxNs; });
+    return result;
+}
+
+/**
+ * @brief Clears the statistics of every call site.
+ */
+void CallbackProfiler::reset() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    sites_.clear();
+}
@@ -0,0 +1,519 @@
+#include "protocol/CommandJournal.h"
+#include "protocol/LatencyEstimator.h"
+#include "spdlog/spdlog.h"
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <new>
+#include <stdexcept>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace bip = boost::interprocess;
+
+namespace {
+
+constexpr std::uint32_t kJournalMagic = 0x4C4E4A4B; // "KJNL"
+constexpr std::uint32_t kJournalVersion = 1;
+constexpr std::size_t kRecordBytes = 64;
+constexpr std::size_t kHeaderBytes = 64;
+
+static_assert(std::atomic<std::uint64_t>::is_always_lock_free, "64-bit atomics must be lock-free");
+
+/**
+ * @brief Fixed part of a segment, written once when the segment is created.
+ */
+struct alignas(kHeaderBytes) SegmentHeader {
+    std::uint32_t magic;
+    std::uint32_t version;
+    std::uint32_t recordBytes;
+    std::uint32_t reserved;
+    std::uint64_t firstSequence;
+    std::int64_t createdNs;
+};
+
+/**
+ * @brief One record as laid out in the segment.
+ */
+struct alignas(kRecordBytes) Record {
+    std::atomic<std::uint64_t> sequence; // Stored last; 0 marks the end of the written records
+    std::int64_t timestampNs;
+    std::uint64_t reference;
+    std::int32_t axisNo;
+    std::uint8_t type;
+    char status;
+    std::uint8_t length;
+    std::uint8_t reserved;
+    char text[CommandJournal::kTextBytes];
+};
+
+static_assert(sizeof(SegmentHeader) == kHeaderBytes, "Segment header must be one cache line");
+static_assert(sizeof(Record) == kRecordBytes, "Journal records must be one cache line");
+
+/**
+ * @brief Creates a zero-filled file of the given size, with its blocks allocated where the platform allows.
+ * @param path The file path.
+ * @param bytes The file size.
+ */
+void createPreallocatedFile(const std::string& path, std::uint64_t bytes) {
+    // Created exclusively: an existing segment is never truncated.
+    std::FILE* file = std::fopen(path.c_str(), "wbx");
+    if (!file) {
+        throw std::runtime_error("Cannot create journal segment '" + path + "': " + std::strerror(errno));
+    }
+    std::fclose(file);
+    std::filesystem::resize_file(path, bytes);
+#if defined(__linux__)
+    // Allocating up front turns a full disk into an error here rather than a SIGBUS on a later write.
+    const int fd = ::open(path.c_str(), O_RDWR | O_CLOEXEC);
+    if (fd >= 0) {
+        const int result = ::posix_fallocate(fd, 0, static_cast<off_t>(bytes));
+        ::close(fd);
+        if (result != 0) {
+            throw std::runtime_error("Cannot allocate journal segment '" + path + "': " + std::strerror(result));
+        }
+    }
+#endif
+}
+
+} // namespace
+
+/**
+ * @struct JournalSegment
+ * @brief A mapped segment file.
+ */
+struct JournalSegment {
+    std::string path;
+    std::uint64_t firstSequence = 0;
+    bip::file_mapping file;
+    bip::mapped_region region;
+    Record* records = nullptr;
+    std::size_t capacity = 0;
+
+    /**
+     * @brief Writes a range of records to disk and waits for it.
+     * @param begin The first record index.
+     * @param end One past the last record index.
+     * @return True on success.
+     */
+    bool flush(std::size_t begin, std::size_t end) {
+        // msync works on whole pages, so the range is widened to the page holding its first byte.
+        const std::size_t pageSize = bip::mapped_region::get_page_size();
+        const std::size_t first = kHeaderBytes + begin * kRecordBytes;
+        const std::size_t alignedFirst = first / pageSize * pageSize;
+        const std::size_t last = kHeaderBytes + end * kRecordBytes;
+        return region.flush(alignedFirst, last - alignedFirst, false);
+    }
+};
+
+/**
+ * @brief Constructor for the CommandJournal class.
+ * @param config The journal settings.
+ */
+CommandJournal::CommandJournal(Config config) : config_(std::move(config)) {
+    if (config_.directory.empty()) {
+        throw std::invalid_argument("Journal directory must not be empty.");
+    }
+    if (config_.segmentBytes < kHeaderBytes + kRecordBytes) {
+        throw std::invalid_argument("Journal segments must hold at least one record.");
+    }
+}
+
+/**
+ * @brief Destructor for the CommandJournal class.
+ */
+CommandJournal::~CommandJournal() {
+    stop();
+}
+
+/**
+ * @brief Creates the directory, opens a new segment and starts the sync thread, if any.
+ */
+void CommandJournal::start() {
+    if (isRunning_.load()) {
+        spdlog::warn("Command journal is already running.");
+        return;
+    }
+    std::filesystem::create_directories(config_.directory);
+
+    // Continue the sequence after the last record left by a previous run. Segments are named after
+    // their first sequence number, so scanning them newest first stops at the one holding it.
+    std::vector<std::pair<std::uint64_t, std::filesystem::path>> segments;
+    for (const auto& entry : std::filesystem::directory_iterator(config_.directory)) {
+        const std::string name = entry.path().filename().string();
+        if (entry.is_regular_file() && name.rfind("journal-", 0) == 0 && entry.path().extension() == ".kjl") {
+            const std::uint64_t firstSequence = std::strtoull(name.c_str() + 8, nullptr, 10);
+            if (firstSequence > 0) {
+                segments.emplace_back(firstSequence, entry.path());
+            }
+        }
+    }
+    std::sort(segments.begin(), segments.end(), std::greater<>());
+    std::vector<std::filesystem::path> emptySegments;
+    std::uint64_t emptyFirstSequence = 0;
+    for (const auto& [firstSequence, path] : segments) {
+        try {
+            const std::vector<JournalEntry> entries = readSegment(path.string());
+            if (!entries.empty()) {
+                nextSequence_ = std::max(nextSequence_, entries.back().sequence + 1);
+                emptyFirstSequence = 0;
+                break;
+            }
+            // Created by a run that stopped before its first record, or a spare left by a crash.
+            emptyFirstSequence = std::max(emptyFirstSequence, firstSequence);
+            emptySegments.push_back(path);
+        } catch (const std::exception& e) {
+            // Never reuse the name, or the sequence numbers, of a segment that cannot be read.
+            nextSequence_ = std::max(nextSequence_, firstSequence + 1);
+            spdlog::warn("Cannot read journal segment {}: {}", path.string(), e.what());
+        }
+    }
+    // Only when no older record exists does the sequence resume at an empty segment's name; otherwise a
+    // spare prepared ahead of a crash would leave a gap after the last record.
+    nextSequence_ = std::max(nextSequence_, emptyFirstSequence);
+    // An empty segment holds no records, so removing it loses nothing and frees its name for the new one.
+    for (const std::filesystem::path& path : emptySegments) {
+        std::filesystem::remove(path);
+        spdlog::info("Removed empty command journal segment {}.", path.string());
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        openSegment();
+        retired_.reserve(2);
+    }
+    isRunning_.store(true);
+    workerThread_ = std::make_unique<std::thread>(&CommandJournal::workerThreadFunction, this);
+    spdlog::info("Started command journal in {} at sequence {}.", config_.directory, nextSequence_);
+}
+
+/**
+ * @brief Joins the background thread, then syncs and closes the current segment.
+ */
+void CommandJournal::stop() {
+    {
+        // Cleared under the lock so the background thread cannot miss the wake-up.
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!isRunning_.exchange(false)) {
+            return;
+        }
+    }
+    workerCv_.notify_all();
+    spareCv_.notify_all();
+    if (workerThread_ && workerThread_->joinable()) {
+        workerThread_->join();
+    }
+    workerThread_.reset();
+    sync();
+    std::lock_guard<std::mutex> lock(mutex_);
+    segment_.reset();
+    discardSpare();
+    spdlog::info("Stopped command journal at sequence {} ({} records dropped).", lastSequence(), droppedRecords());
+}
+
+/**
+ * @brief Checks whether commands with the given response key or mnemonic are journalled.
+ * @param command The command mnemonic, optionally followed by the axis number.
+ * @return False for the excluded commands.
+ */
+bool CommandJournal::journals(std::string_view command) const {
+    std::size_t length = 0;
+    while (length < command.size() && std::isalpha(static_cast<unsigned char>(command[length]))) {
+        ++length;
+    }
+    const std::string_view mnemonic = command.substr(0, length);
+    return std::none_of(config_.excludedCommands.begin(), config_.excludedCommands.end(),
+                        [mnemonic](const std::string& excluded) { return excluded == mnemonic; });
+}
+
+/**
+ * @brief Appends a submitted record.
+ * @param commandLine The command line as written, without CR/LF.
+ * @param axisNo The axis number, or -1.
+ * @return The record's sequence number, or 0 if the journal is not running.
+ */
+std::uint64_t CommandJournal::recordSubmitted(std::string_view commandLine, int axisNo) {
+    return append(JournalRecordType::submitted, 0, axisNo, 0, commandLine);
+}
+
+/**
+ * @brief Appends a completed record.
+ * @param reference The sequence number of the command's submitted record.
+ * @param axisNo The axis number, or -1.
+ * @param status The reply status.
+ * @param detail The reply line or failure reason.
+ * @return The record's sequence number, or 0 if the journal is not running.
+ */
+std::uint64_t CommandJournal::recordCompleted(std::uint64_t reference, int axisNo, char status, std::string_view detail) {
+    return append(JournalRecordType::completed, reference, axisNo, status, detail);
+}
+
+/**
+ * @brief Writes one record into the current segment, rolling over to a new segment when it is full.
+ * @param type The record type.
+ * @param reference The referenced sequence number, or 0.
+ * @param axisNo The axis number, or -1.
+ * @param status The reply status, or 0.
+ * @param text The command line or reply, truncated to kTextBytes.
+ * @return The record's sequence number, or 0 if it was not written.
+ */
+std::uint64_t CommandJournal::append(JournalRecordType type, std::uint64_t reference, int axisNo, char status, std::string_view text) {
+    const std::int64_t timestampNs = wallClockNs();
+    const std::size_t length = std::min(text.size(), kTextBytes);
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!isRunning_.load(std::memory_order_relaxed)) {
+        return 0;
+    }
+    if (segment_ && nextIndex_ == segment_->capacity && preparing_) {
+        // The background thread is still creating the next segment; taking its file name here would fail.
+        spareCv_.wait(lock, [this] { return !preparing_ || !isRunning_.load(); });
+        if (!isRunning_.load(std::memory_order_relaxed)) {
+            return 0;
+        }
+    }
+    if (!segment_ || nextIndex_ == segment_->capacity) {
+        if (segment_ && nextIndex_ > syncedIndex_) {
+            // Flushed by the background thread, after this lock is released.
+            retired_.push_back({segment_, syncedIndex_, nextIndex_});
+        }
+        if (spare_ && spare_->firstSequence == nextSequence_) {
+            segment_ = std::move(spare_);
+            nextIndex_ = 0;
+            syncedIndex_ = 0;
+        } else {
+            // The background thread has fallen behind or failed: open the segment here.
+            discardSpare();
+            try {
+                openSegment();
+            } catch (const std::exception& e) {
+                // Logged once per failed roll-over; appends keep retrying with the next record.
+                segment_.reset();
+                droppedRecords_.fetch_add(1, std::memory_order_relaxed);
+                spdlog::error("Command journal: cannot open a new segment: {}", e.what());
+                return 0;
+            }
+        }
+        spareWanted_ = true;
+        workerCv_.notify_one();
+    }
+    Record& record = segment_->records[nextIndex_++];
+    const std::uint64_t sequence = nextSequence_++;
+    record.timestampNs = timestampNs;
+    record.reference = reference;
+    record.axisNo = axisNo;
+    record.type = static_cast<std::uint8_t>(type);
+    record.status = status;
+    record.length = static_cast<std::uint8_t>(length);
+    std::memcpy(record.text, text.data(), length);
+    // Published last, so a reader never sees a sequence number on a half-written record.
+    record.sequence.store(sequence, std::memory_order_release);
+    lastSequence_.store(sequence, std::memory_order_relaxed);
+    return sequence;
+}
+
+/**
+ * @brief Creates, maps and prefaults a segment file.
+ *
+ * Touches no member state besides config_, so it runs without mutex_ held.
+ * @param firstSequence The sequence number of the segment's first record.
+ * @return The mapped segment.
+ */
+std::shared_ptr<JournalSegment> CommandJournal::createSegment(std::uint64_t firstSequence) const {
+    auto segment = std::make_shared<JournalSegment>();
+    segment->path = (std::filesystem::path(config_.directory) / segmentFileName(firstSequence)).string();
+    segment->firstSequence = firstSequence;
+    createPreallocatedFile(segment->path, config_.segmentBytes);
+    segment->file = bip::file_mapping(segment->path.c_str(), bip::read_write);
+    segment->region = bip::mapped_region(segment->file, bip::read_write);
+
+    auto* header = new (segment->region.get_address()) SegmentHeader();
+    header->magic = kJournalMagic;
+    header->version = kJournalVersion;
+    header->recordBytes = kRecordBytes;
+    header->firstSequence = firstSequence;
+    header->createdNs = wallClockNs();
+
+    auto* base = static_cast<char*>(segment->region.get_address()) + kHeaderBytes;
+    segment->capacity = (config_.segmentBytes - kHeaderBytes) / kRecordBytes;
+    segment->records = reinterpret_cast<Record*>(base);
+    for (std::size_t i = 0; i < segment->capacity; ++i) {
+        new (&segment->records[i]) Record(); // Also faults every page in now, so appends never take a page fault
+    }
+    return segment;
+}
+
+/**
+ * @brief Creates and maps a segment starting at nextSequence_, replacing the current one.
+ *
+ * Must be called with mutex_ held.
+ */
+void CommandJournal::openSegment() {
+    segment_ = createSegment(nextSequence_);
+    nextIndex_ = 0;
+    syncedIndex_ = 0;
+    spdlog::info("Command journal segment {} opened ({} records).", segment_->path, segment_->capacity);
+}
+
+/**
+ * @brief Unmaps the spare segment and removes its file, which holds no records.
+ *
+ * Must be called with mutex_ held.
+ */
+void CommandJournal::discardSpare() {
+    if (!spare_) {
+        return;
+    }
+    const std::string path = spare_->path;
+    spare_.reset();
+    std::error_code error;
+    std::filesystem::remove(path, error);
+}
+
+/**
+ * @brief Flushes every record written so far to disk and waits for it.
+ */
+void CommandJournal::sync() {
+    std::lock_guard<std::mutex> syncLock(syncMutex_);
+    std::vector<PendingFlush> pending;
+    std::uint64_t last = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending.assign(retired_.begin(), retired_.end());
+        retired_.clear();
+        if (segment_) {
+            pending.push_back({segment_, syncedIndex_, nextIndex_});
+            syncedIndex_ = nextIndex_;
+        }
+        last = lastSequence_.load(std::memory_order_relaxed);
+    }
+    // One msync per segment for everything appended since the previous one: the group commit.
+    bool flushed = true;
+    for (const PendingFlush& range : pending) {
+        if (range.end > range.begin && !range.segment->flush(range.begin, range.end)) {
+            spdlog::error("Command journal: flushing {} failed.", range.segment->path);
+            flushed = false;
+        }
+    }
+    if (flushed) {
+        syncedSequence_.store(last, std::memory_order_relaxed);
+    }
+}
+
+/**
+ * @brief The function executed by the background thread.
+ *
+ * Prepares the segment that follows the current one and flushes rolled-over segments, plus
+ * everything else every sync interval when syncing is enabled.
+ */
+void CommandJournal::workerThreadFunction() {
+    const bool syncing = config_.syncIntervalMs > 0;
+    const auto interval = std::chrono::milliseconds(config_.syncIntervalMs);
+    auto nextSync = std::chrono::steady_clock::now() + interval;
+    std::unique_lock<std::mutex> lock(mutex_);
+    spareWanted_ = true;
+    while (isRunning_.load()) {
+        const auto hasWork = [this] { return !isRunning_.load() || spareWanted_ || !retired_.empty(); };
+        if (syncing) {
+            workerCv_.wait_until(lock, nextSync, hasWork);
+        } else {
+            workerCv_.wait(lock, hasWork);
+        }
+        if (!isRunning_.load()) {
+            break;
+        }
+
+        if (spareWanted_) {
+            spareWanted_ = false;
+            if (!spare_ && segment_) {
+                const std::uint64_t firstSequence = segment_->firstSequence + segment_->capacity;
+                preparing_ = true;
+                lock.unlock();
+                std::shared_ptr<JournalSegment> spare;
+                try {
+                    spare = createSegment(firstSequence);
+                } catch (const std::exception& e) {
+                    // Not retried until the next roll-over, which then opens its segment itself.
+                    spdlog::error("Command journal: cannot prepare the next segment: {}", e.what());
+                }
+                lock.lock();
+                preparing_ = false;
+                if (spare) {
+                    spare_ = std::move(spare);
+                    if (!isRunning_.load()) {
+                        discardSpare();
+                    }
+                }
+                spareCv_.notify_all();
+            }
+        }
+
+        const bool syncDue = syncing && std::chrono::steady_clock::now() >= nextSync;
+        if (syncDue || !retired_.empty()) {
+            lock.unlock();
+            sync();
+            lock.lock();
+            if (syncDue) {
+                nextSync = std::chrono::steady_clock::now() + interval;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Builds the file name of the segment whose first record has the given sequence number.
+ * @param firstSequence The sequence number of the segment's first record.
+ * @return The segment file name (without directory).
+ */
+std::string CommandJournal::segmentFileName(std::uint64_t firstSequence) {
+    char name[48];
+    std::snprintf(name, sizeof(name), "journal-%020llu.kjl", static_cast<unsigned long long>(firstSequence));
+    return name;
+}
+
+/**
+ * @brief Reads the complete records of a segment file.
+ * @param path The segment file path.
+ * @return The records in sequence order, up to the first unwritten or torn one.
+ */
+std::vector<JournalEntry> CommandJournal::readSegment(const std::string& path) {
+    bip::file_mapping file(path.c_str(), bip::read_only);
+    bip::mapped_region region(file, bip::read_only);
+    if (region.get_size() < kHeaderBytes) {
+        throw std::runtime_error("Journal segment '" + path + "' is too small.");
+    }
+    const auto* header = static_cast<const SegmentHeader*>(region.get_address());
+    if (header->magic != kJournalMagic || header->version != kJournalVersion || header->recordBytes != kRecordBytes) {
+        throw std::runtime_error("Journal segment '" + path + "' has an incompatible format.");
+    }
+    const auto* records = reinterpret_cast<const Record*>(static_cast<const char*>(region.get_address()) + kHeaderBytes);
+    const std::size_t capacity = (region.get_size() - kHeaderBytes) / kRecordBytes;
+    std::vector<JournalEntry> entries;
+    for (std::size_t i = 0; i < capacity; ++i) {
+        const Record& record = records[i];
+        const std::uint64_t sequence = record.sequence.load(std::memory_order_acquire);
+        if (sequence == 0) {
+            break;
+        }
+        JournalEntry entry;
+        entry.sequence = sequence;
+        entry.timestampNs = record.timestampNs;
+        entry.type = static_cast<JournalRecordType>(record.type);
+        entry.reference = record.reference;
+        entry.axisNo = record.axisNo;
+        entry.status = record.status;
+        entry.text.assign(record.text, std::min<std::size_t>(record.length, kTextBytes));
+        entries.push_back(std::move(entry));
+    }
+    return entries;
+}
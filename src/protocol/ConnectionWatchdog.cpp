@@ -0,0 +1,139 @@
+#include "protocol/ConnectionWatchdog.h"
+#include "spdlog/spdlog.h"
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+#include <system_error>
+
+/**
+ * @brief Constructor for the ConnectionWatchdog class.
+ * @param protocolHandler The handler whose activity is watched and which sends the heartbeat.
+ * @param client The client of that handler.
+ * @param config The watchdog settings.
+ */
+ConnectionWatchdog::ConnectionWatchdog(std::shared_ptr<ProtocolHandler> protocolHandler,
+                                       std::shared_ptr<ICommunicationClient> client, Config config)
+    : protocolHandler_(std::move(protocolHandler)),
+      client_(std::move(client)),
+      config_(std::move(config)) {
+    if (!protocolHandler_ || !client_) {
+        throw std::invalid_argument("ConnectionWatchdog requires a ProtocolHandler and its client.");
+    }
+}
+
+/**
+ * @brief Constructor for the ConnectionWatchdog class with default settings.
+ * @param protocolHandler The handler whose activity is watched and which sends the heartbeat.
+ * @param client The client of that handler.
+ */
+ConnectionWatchdog::ConnectionWatchdog(std::shared_ptr<ProtocolHandler> protocolHandler,
+                                       std::shared_ptr<ICommunicationClient> client)
+    : ConnectionWatchdog(std::move(protocolHandler), std::move(client), Config{}) {}
+
+/**
+ * @brief Destructor. Stops the watchdog thread.
+ */
+ConnectionWatchdog::~ConnectionWatchdog() {
+    stop();
+}
+
+/**
+ * @brief Starts the watchdog thread.
+ */
+void ConnectionWatchdog::start() {
+    if (isRunning_.exchange(true)) {
+        return;
+    }
+    watchdogThread_ = std::thread(&ConnectionWatchdog::watchdogThreadFunction, this);
+}
+
+/**
+ * @brief Stops the watchdog thread.
+ */
+void ConnectionWatchdog::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!isRunning_.exchange(false)) {
+            return;
+        }
+    }
+    cv_.notify_all();
+    if (watchdogThread_.joinable()) {
+        watchdogThread_.join();
+    }
+}
+
+/**
+ * @brief The function executed by the watchdog thread.
+ */
+void ConnectionWatchdog::watchdogThreadFunction() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (isRunning_.load()) {
+        cv_.wait_for(lock, std::chrono::milliseconds(config_.checkIntervalMs), [this] { return !isRunning_.load(); });
+        if (!isRunning_.load()) {
+            break;
+        }
+        lock.unlock();
+        check();
+        lock.lock();
+    }
+}
+
+/**
+ * @brief Samples the connection's activity once, sending a heartbeat or declaring the link dead.
+ */
+void ConnectionWatchdog::check() {
+    const ConnectionActivity activity = protocolHandler_->activity();
+    const std::int64_t now = steadyClockNs();
+    const std::int64_t responseTimeoutNs = static_cast<std::int64_t>(config_.responseTimeoutMs) * 1000000;
+
+    if (activity.pendingCommands > 0) {
+        // Progress is the later of the last received line and the moment commands started waiting.
+        const std::int64_t progressNs = std::max(activity.lastReceivedNs, activity.waitingSinceNs);
+        if (now - progressNs <= responseTimeoutNs) {
+            return;
+        }
+        // A long move sent with responseType 0 stays silent until it ends, so overdue replies alone do not
+        // prove the link dead: probe it, and declare it dead only if the probe goes unanswered as well.
+        if (!heartbeatOutstanding_->load()) {
+            sendHeartbeat(now);
+            return;
+        }
+        if (now - heartbeatSentNs_ <= responseTimeoutNs) {
+            return;
+        }
+        // Give the client one timeout to recover before declaring the link dead again.
+        if (declaredDeadNs_ != 0 && now - declaredDeadNs_ <= responseTimeoutNs) {
+            return;
+        }
+        declaredDeadNs_ = now;
+        deadLinks_.fetch_add(1, std::memory_order_relaxed);
+        const std::string reason = "heartbeat unanswered with " + std::to_string(activity.pendingCommands) +
+                                   " pending commands";
+        spdlog::error("Connection watchdog: link dead ({} for {} ms); dropping the connection.", reason,
+                      (now - progressNs) / 1000000);
+        client_->dropConnection(std::make_error_code(std::errc::timed_out));
+        if (deadLinkHandler_) {
+            deadLinkHandler_(reason);
+        }
+        return;
+    }
+
+    const std::int64_t idleNs = now - std::max(activity.lastSentNs, activity.lastReceivedNs);
+    if (idleNs >= static_cast<std::int64_t>(config_.idleHeartbeatMs) * 1000000) {
+        sendHeartbeat(now);
+    }
+}
+
+/**
+ * @brief Sends the heartbeat command and marks it outstanding until any reply, or failure, comes back.
+ * @param now The current steady clock time in nanoseconds.
+ */
+void ConnectionWatchdog::sendHeartbeat(std::int64_t now) {
+    heartbeatSentNs_ = now;
+    heartbeatsSent_.fetch_add(1, std::memory_order_relaxed);
+    heartbeatOutstanding_->store(true);
+    // The callback holds the flag, not the watchdog, so a late reply is harmless after the watchdog is gone.
+    protocolHandler_->sendCommand(config_.heartbeatCommand, -1, {},
+        [outstanding = heartbeatOutstanding_](const ProtocolResponse&) { outstanding->store(false); });
+}
@@ -0,0 +1,74 @@
+#include "protocol/LatencyEstimator.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+/**
+ * @brief Constructor for the LatencyEstimator class.
+ * @param outboundShare Fraction of the minimum round trip spent before the controller serves a request.
+ * @param windowSamples Number of samples after which the minimum round trip is re-measured.
+ */
+LatencyEstimator::LatencyEstimator(double outboundShare, std::size_t windowSamples)
+    : outboundShare_(std::clamp(outboundShare, 0.0, 1.0)),
+      windowSamples_(windowSamples > 0 ? windowSamples : 1),
+      minRttNs_(std::numeric_limits<std::int64_t>::max()),
+      windowMinRttNs_(std::numeric_limits<std::int64_t>::max()) {}
+
+/**
+ * @brief Adds a round trip and returns the estimated service time of the request.
+ * @param sentNs Time the request was written.
+ * @param receivedNs Time the reply was received.
+ * @return The estimated time the controller served the request.
+ */
+std::int64_t LatencyEstimator::estimate(std::int64_t sentNs, std::int64_t receivedNs) {
+    const std::int64_t rtt = std::max<std::int64_t>(receivedNs - sentNs, 0);
+
+    // Smoothed round trip and deviation, with the usual TCP gains (1/8 and 1/4).
+    if (samples_ == 0) {
+        meanRttNs_ = static_cast<double>(rtt);
+        jitterNs_ = static_cast<double>(rtt) / 2.0;
+    } else {
+        jitterNs_ += (std::abs(static_cast<double>(rtt) - meanRttNs_) - jitterNs_) / 4.0;
+        meanRttNs_ += (static_cast<double>(rtt) - meanRttNs_) / 8.0;
+    }
+    ++samples_;
+
+    // The minimum follows the last complete window, so it can rise again after a route change.
+    minRttNs_ = std::min(minRttNs_, rtt);
+    windowMinRttNs_ = std::min(windowMinRttNs_, rtt);
+    if (++windowCount_ >= windowSamples_) {
+        minRttNs_ = windowMinRttNs_;
+        windowMinRttNs_ = std::numeric_limits<std::int64_t>::max();
+        windowCount_ = 0;
+    }
+
+    const std::int64_t outbound = static_cast<std::int64_t>(static_cast<double>(minRttNs_) * outboundShare_);
+    const std::int64_t inbound = minRttNs_ - outbound;
+    std::int64_t lower = sentNs + outbound;
+    if (lastReceivedNs_ > sentNs) {
+        // Replies on one connection are served in order, so this request was served after the previous reply left.
+        lower = std::max(lower, lastReceivedNs_ - inbound);
+    }
+    const std::int64_t upper = std::max(receivedNs - inbound, lower);
+    lastReceivedNs_ = std::max(lastReceivedNs_, receivedNs);
+
+    return std::clamp(lower + (upper - lower) / 2, sentNs, std::max(sentNs, receivedNs));
+}
+
+/**
+ * @brief Returns the current latency statistics.
+ * @return The snapshot.
+ */
+LatencySnapshot LatencyEstimator::snapshot() const {
+    LatencySnapshot snapshot;
+    snapshot.samples = samples_;
+    if (samples_ == 0) {
+        return snapshot;
+    }
+    snapshot.minRttNs = minRttNs_;
+    snapshot.meanRttNs = meanRttNs_;
+    snapshot.jitterNs = jitterNs_;
+    snapshot.outboundNs = static_cast<std::int64_t>(static_cast<double>(minRttNs_) * outboundShare_);
+    snapshot.inboundNs = minRttNs_ - snapshot.outboundNs;
+    return snapshot;
+}
@@ -0,0 +1,68 @@
+#include "protocol/ProtocolError.h"
+#include <charconv>
+#include <string>
+
+namespace {
+
+/**
+ * @brief Error category describing ProtocolErrc values.
+ */
+class ProtocolErrorCategory : public std::error_category {
+public:
+    const char* name() const noexcept override {
+        return "kohzu-protocol";
+    }
+
+    std::string message(int condition) const override {
+        switch (static_cast<ProtocolErrc>(condition)) {
+        case ProtocolErrc::emptyResponse:
+            return "Received an empty response.";
+        case ProtocolErrc::missingCommandField:
+            return "Invalid response format: Missing command field.";
+        case ProtocolErrc::invalidAxisNumber:
+            return "Failed to parse axis number from response.";
+        case ProtocolErrc::invalidNumber:
+            return "Invalid numeric value.";
+        }
+        return "Unknown protocol error.";
+    }
+};
+
+} // namespace
+
+/**
+ * @brief Returns the error category of ProtocolErrc values.
+ * @return The protocol error category.
+ */
+const std::error_category& protocolErrorCategory() noexcept {
+    static const ProtocolErrorCategory category;
+    return category;
+}
+
+/**
+ * @brief Makes ProtocolErrc values usable as std::error_code.
+ * @param error The protocol error.
+ * @return The corresponding error code.
+ */
+std::error_code make_error_code(ProtocolErrc error) noexcept {
+    return {static_cast<int>(error), protocolErrorCategory()};
+}
+
+/**
+ * @brief Parses a decimal integer without throwing.
+ * @param text The text to parse.
+ * @param value Receives the parsed value on success.
+ * @return An empty error code on success, ProtocolErrc::invalidNumber otherwise.
+ */
+std::error_code parseInteger(std::string_view text, int& value) noexcept {
+    // Accept an explicit plus sign like std::stoi did.
+    if (!text.empty() && text.front() == '+') {
+        text.remove_prefix(1);
+    }
+    const char* end = text.data() + text.size();
+    auto result = std::from_chars(text.data(), end, value);
+    if (result.ec != std::errc() || result.ptr == text.data()) {
+        return ProtocolErrc::invalidNumber;
+    }
+    return {};
+}
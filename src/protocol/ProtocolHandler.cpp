@@ -1,34 +1,188 @@
 #include "protocol/ProtocolHandler.h"
+#include "protocol/CommandFormat.h"
 #include "spdlog/spdlog.h"
 #include <stdexcept>
-#include <sstream>
-#include <boost/asio.hpp>
+#include <string_view>
+#include <charconv>
 #include <atomic>
+#include <functional>
+#include <thread>
+#include <tuple>
+
+namespace {
+
+thread_local std::uint64_t submitterTag = 0;
+thread_local bool submitterTagSet = false;
+
+/**
+ * @brief Returns the axis number at the end of a response key ("APS1" -> 1), or -1 if it has none.
+ */
+int axisOfKey(std::string_view responseKey) {
+    std::size_t digits = responseKey.size();
+    while (digits > 0 && responseKey[digits - 1] >= '0' && responseKey[digits - 1] <= '9') {
+        --digits;
+    }
+    int axisNo = -1;
+    std::from_chars(responseKey.data() + digits, responseKey.data() + responseKey.size(), axisNo);
+    return axisNo;
+}
+
+} // namespace
+
+/**
+ * @brief Sets the tag of the current thread.
+ * @param tag The submitter tag.
+ */
+SubmitterTagScope::SubmitterTagScope(std::uint64_t tag) : previousTag_(submitterTag), previousSet_(submitterTagSet) {
+    submitterTag = tag;
+    submitterTagSet = true;
+}
+
+/**
+ * @brief Restores the previous tag.
+ */
+SubmitterTagScope::~SubmitterTagScope() {
+    submitterTag = previousTag_;
+    submitterTagSet = previousSet_;
+}
+
+/**
+ * @brief Returns the tag of the current thread.
+ * @return The tag set by the innermost scope, or a value derived from the thread id.
+ */
+std::uint64_t SubmitterTagScope::current() {
+    if (submitterTagSet) {
+        return submitterTag;
+    }
+    return std::hash<std::thread::id>{}(std::this_thread::get_id());
+}
 
 /**
  * @brief Constructor for the ProtocolHandler class.
  * @param client The communication client object.
  */
 ProtocolHandler::ProtocolHandler(std::shared_ptr<ICommunicationClient> client)
-    : client_(client) {
+    : client_(client),
+      callbackProfiler_(std::make_shared<CallbackProfiler>()),
+      readGuard_(std::make_shared<ReadGuard>()) {
     if (!client_) {
         throw std::invalid_argument("ICommunicationClient object is not valid.");
     }
     spdlog::info("ProtocolHandler object created.");
 }
 
+/**
+ * @brief Destructor. Detaches the client's callbacks so late replies are not delivered to a destroyed handler.
+ */
+ProtocolHandler::~ProtocolHandler() {
+    detachFromClient();
+}
+
+/**
+ * @brief Stops delivering the client's reads and disconnects to this handler.
+ *
+ * Waits for a callback that is already running on another thread to return. Called from
+ * within such a callback, the guard is already held by this thread and is not locked again.
+ */
+void ProtocolHandler::detachFromClient() {
+    if (readGuard_->deliveringThread.load() == std::this_thread::get_id()) {
+        readGuard_->attached = false;
+        return;
+    }
+    std::lock_guard<std::mutex> lock(readGuard_->mutex);
+    readGuard_->attached = false;
+}
+
 /**
  * @brief Initializes the protocol handler and starts the asynchronous read operation.
  */
 void ProtocolHandler::initialize() {
     if (!isReading_) {
         isReading_ = true;
-        client_->asyncRead([this](const std::string& data) {
-            this->handleRead(data);
+        // The guard lets shutdown() and the destructor detach the client's callbacks from this object.
+        std::shared_ptr<ReadGuard> guard = readGuard_;
+        client_->setDisconnectHandler([this, guard](const std::error_code& error) {
+            std::lock_guard<std::mutex> lock(guard->mutex);
+            if (guard->attached) {
+                guard->readerThread.store(std::this_thread::get_id());
+                guard->deliveringThread.store(std::this_thread::get_id());
+                this->failPendingCommands(error.message());
+                guard->deliveringThread.store(std::thread::id());
+            }
+        });
+        client_->asyncRead([this, guard](const std::string& data) {
+            std::lock_guard<std::mutex> lock(guard->mutex);
+            if (guard->attached) {
+                guard->readerThread.store(std::this_thread::get_id());
+                guard->deliveringThread.store(std::this_thread::get_id());
+                this->handleRead(data);
+                guard->deliveringThread.store(std::thread::id());
+            }
         });
     }
 }
 
+namespace {
+
+/**
+ * @brief Builds the error response delivered to a command that will not get a reply.
+ * @param responseKey The command's response key.
+ * @param reason The reason, passed as the only parameter.
+ * @param sentNs When the command was written, or 0 if it never was.
+ * @return The response.
+ */
+ProtocolResponse makeErrorResponse(std::string_view responseKey, const std::string& reason, std::int64_t sentNs) {
+    ProtocolResponse response;
+    response.status = 'E';
+    const std::size_t firstDigitPos = responseKey.find_first_of("0123456789");
+    response.command = std::string(responseKey.substr(0, firstDigitPos));
+    if (firstDigitPos != std::string_view::npos) {
+        std::from_chars(responseKey.data() + firstDigitPos, responseKey.data() + responseKey.size(), response.axisNo);
+    }
+    response.params.push_back(reason);
+    response.fullResponse = "E\t" + std::string(responseKey) + "\t" + reason;
+    response.sentNs = sentNs;
+    return response;
+}
+
+} // namespace
+
+/**
+ * @brief Constructs an empty batch.
+ * @param arena The memory resource used for the batch's storage.
+ */
+CommandBatch::CommandBatch(std::pmr::memory_resource* arena)
+    : arena_(arena), encoded_(arena), entries_(arena) {}
+
+/**
+ * @brief Appends a command without parameters.
+ * @param baseCommand The command string.
+ * @param axisNo The axis number, or -1 if the command takes none.
+ * @param callback The callback function to execute when the response is received.
+ * @param site Where the callback is registered.
+ */
+void CommandBatch::add(std::string_view baseCommand, int axisNo, Callback callback, CallSite site) {
+    static const std::vector<std::string> noParams;
+    add(baseCommand, axisNo, noParams, std::move(callback), site);
+}
+
+/**
+ * @brief Appends a command with parameters.
+ * @param baseCommand The command string.
+ * @param axisNo The axis number, or -1 if the command takes none.
+ * @param params A vector of string parameters.
+ * @param callback The callback function to execute when the response is received.
+ * @param site Where the callback is registered.
+ */
+void CommandBatch::add(std::string_view baseCommand, int axisNo, const std::vector<std::string>& params, Callback callback,
+                       CallSite site) {
+    const std::size_t lineBegin = encoded_.size();
+    appendCommand(encoded_, baseCommand, axisNo, params);
+    Entry entry{std::pmr::string(arena_), std::move(callback), CommandHandle(), site, lineBegin, encoded_.size() - 2};
+    appendResponseKey(entry.responseKey, baseCommand, axisNo);
+    entries_.push_back(std::move(entry));
+}
+
 /**
  * @brief Generates a key for the responseCallbacks_ map.
  * @param baseCommand The command string.
@@ -36,45 +190,537 @@ void ProtocolHandler::initialize() {
  * @return A unique string key.
  */
 std::string ProtocolHandler::generateResponseKey(const std::string& baseCommand, int axisNo) {
-    if (axisNo == -1) {
-        return baseCommand;
+    std::string key;
+    appendResponseKey(key, baseCommand, axisNo);
+    return key;
+}
+
+/**
+ * @brief Detaches the command's callback so it never runs, and withdraws the command if it is not written yet.
+ * @return True if the command was cancelled.
+ */
+bool CommandHandle::cancel() const {
+    return owner_ && owner_->cancel(*this);
+}
+
+/**
+ * @brief Queues a callback for the next response with the given key.
+ *
+ * Must be called with callbackMutex_ held.
+ * @param responseKey The response key.
+ * @param callback The callback function.
+ * @param sentNs The time the command is written.
+ * @param site Where the callback was registered.
+ * @return The handle that cancels the callback.
+ */
+CommandHandle ProtocolHandler::registerCallback(std::string_view responseKey,
+                                                std::function<void(const ProtocolResponse&)> callback,
+                                                std::int64_t sentNs, const CallSite& site) {
+    const CommandHandle handle = allocateSlot(std::move(callback), site);
+    expectReply(responseKey, handle.slot_, sentNs);
+    return handle;
+}
+
+/**
+ * @brief Stores a callback in a free slot without queueing it for a reply yet.
+ *
+ * Must be called with callbackMutex_ held.
+ * @param callback The callback function.
+ * @param site Where the callback was registered.
+ * @return The handle that cancels the callback.
+ */
+CommandHandle ProtocolHandler::allocateSlot(std::function<void(const ProtocolResponse&)> callback, const CallSite& site) {
+    std::uint32_t slot = 0;
+    if (!freeSlots_.empty()) {
+        slot = freeSlots_.back();
+        freeSlots_.pop_back();
+    } else {
+        slot = static_cast<std::uint32_t>(callbackSlots_.size());
+        callbackSlots_.emplace_back();
     }
-    return baseCommand + std::to_string(axisNo);
+    callbackSlots_[slot].callback = std::move(callback);
+    callbackSlots_[slot].site = site;
+    return CommandHandle(this, slot, callbackSlots_[slot].generation);
 }
 
 /**
- * @brief Sends a command with an optional axis number and parameters asynchronously.
- * @param baseCommand The command string (e.g., "APS", "RDP", "CERR").
- * @param axisNo The axis number for the command. Use a special value (e.g., -1) if no axis number is required.
- * @param params A vector of string parameters.
- * @param callback The callback function to execute when a response is received.
+ * @brief Queues a slot for the next response with the given key. Called when its command is written.
+ *
+ * Must be called with callbackMutex_ held.
+ * @param responseKey The response key.
+ * @param slot The slot holding the callback.
+ * @param sentNs The time the command is written.
+ */
+void ProtocolHandler::expectReply(std::string_view responseKey, std::uint32_t slot, std::int64_t sentNs) {
+    auto it = responseCallbacks_.find(responseKey);
+    if (it == responseCallbacks_.end()) {
+        it = responseCallbacks_.try_emplace(std::string(responseKey)).first;
+    }
+    it->second.push(PendingCallback{slot, sentNs});
+    if (pendingCommands_.fetch_add(1, std::memory_order_relaxed) == 0) {
+        waitingSinceNs_.store(steadyClockNs(), std::memory_order_relaxed);
+    }
+}
+
+/**
+ * @brief Enables per-submitter fair queueing of the commands sent from now on.
+ * @param config The queueing settings.
+ */
+void ProtocolHandler::setFairQueueing(FairQueueConfig config) {
+    if (config.maxInFlight == 0 || config.quantum == 0) {
+        throw std::invalid_argument("Fair queueing needs a non-zero in-flight limit and quantum.");
+    }
+    std::lock_guard<std::mutex> lock(callbackMutex_);
+    fairQueueConfig_ = config;
+    fairQueueing_ = true;
+    spdlog::info("Fair queueing enabled ({} commands in flight, quantum {}).", config.maxInFlight, config.quantum);
+}
+
+/**
+ * @brief Adds a write to the current submitter's queue and writes what the in-flight limit allows.
+ *
+ * Must be called with callbackMutex_ held.
+ * @param write The command or batch, with its callbacks already in slots.
+ */
+void ProtocolHandler::queueWrite(QueuedWrite write) {
+    const std::uint64_t tag = SubmitterTagScope::current();
+    SubmitterQueue& queue = submitterQueues_[tag];
+    write.live = write.replies.size();
+    queuedCommands_.fetch_add(write.live, std::memory_order_relaxed);
+    // Deque elements keep their address while others are added or popped, so slots can point at the write.
+    QueuedWrite& queued = queue.writes.emplace_back(std::move(write));
+    for (std::uint32_t i = 0; i < queued.replies.size(); ++i) {
+        CallbackSlot& entry = callbackSlots_[queued.replies[i].slot];
+        entry.queuedWrite = &queued;
+        entry.queuedReply = i;
+    }
+    if (!queue.active) {
+        queue.active = true;
+        activeSubmitters_.push_back(tag);
+    }
+    dispatchQueued();
+}
+
+/**
+ * @brief Writes queued commands with deficit round-robin until the in-flight limit is reached.
+ *
+ * Must be called with callbackMutex_ held. Callbacks are queued for replies in write order.
  */
-void ProtocolHandler::sendCommand(const std::string& baseCommand, int axisNo, const std::vector<std::string>& params, std::function<void(const ProtocolResponse&)> callback) {
-    std::string fullCommand = baseCommand;
-    if (axisNo != -1) {
-        fullCommand += std::to_string(axisNo);
+void ProtocolHandler::dispatchQueued() {
+    while (!activeSubmitters_.empty()) {
+        const std::uint64_t tag = activeSubmitters_.front();
+        SubmitterQueue& queue = submitterQueues_[tag];
+        if (!queue.granted) {
+            queue.deficit += fairQueueConfig_.quantum;
+            queue.granted = true;
+        }
+        while (!queue.writes.empty() && queue.writes.front().live <= queue.deficit) {
+            QueuedWrite& write = queue.writes.front();
+            const std::size_t cost = write.live;
+            if (cost > 0) { // A write whose commands were all withdrawn is just dropped
+                const std::size_t inFlight = pendingCommands_.load(std::memory_order_relaxed);
+                // A batch larger than the limit still goes out once the connection is idle.
+                if (inFlight > 0 && inFlight + cost > fairQueueConfig_.maxInFlight) {
+                    return; // Resumed with this submitter when replies free the window
+                }
+                const std::int64_t sentNs = wallClockNs();
+                for (const QueuedReply& reply : write.replies) {
+                    if (!reply.withdrawn) {
+                        callbackSlots_[reply.slot].queuedWrite = nullptr;
+                        expectReply(reply.responseKey, reply.slot, sentNs);
+                    }
+                }
+                if (cost < write.replies.size()) {
+                    // Leave out the lines of withdrawn commands.
+                    std::string bytes;
+                    for (std::size_t i = 0; i < write.replies.size(); ++i) {
+                        if (!write.replies[i].withdrawn) {
+                            const std::size_t lineEnd = i + 1 < write.replies.size() ? write.replies[i + 1].lineBegin : write.bytes.size();
+                            bytes.append(write.bytes, write.replies[i].lineBegin, lineEnd - write.replies[i].lineBegin);
+                        }
+                    }
+                    write.bytes = std::move(bytes);
+                }
+                spdlog::debug("Sending {} queued commands for submitter {:x}.", cost, tag);
+                client_->asyncWrite(write.bytes);
+                lastSentNs_.store(steadyClockNs(), std::memory_order_relaxed);
+                queuedCommands_.fetch_sub(cost, std::memory_order_relaxed);
+                queue.deficit -= cost;
+            }
+            queue.writes.pop_front();
+        }
+        // Round over for this submitter: an emptied queue leaves the rotation and keeps no credit.
+        queue.granted = false;
+        activeSubmitters_.pop_front();
+        if (queue.writes.empty()) {
+            submitterQueues_.erase(tag); // Per-thread tags come and go with the threads
+        } else {
+            activeSubmitters_.push_back(tag);
+        }
     }
+}
 
-    if (!params.empty()) {
-        if (axisNo != -1) {
-            fullCommand += "/";
+/**
+ * @brief Withdraws a command that has not been written yet from its fair queue.
+ *
+ * Must be called with callbackMutex_ held. The command is marked in place, so
+ * this takes constant time; dispatchQueued() leaves it out of the write.
+ * @param slot The slot holding the command's callback. Must be queued.
+ * @return The command's response key.
+ */
+std::string ProtocolHandler::withdrawQueued(std::uint32_t slot) {
+    CallbackSlot& entry = callbackSlots_[slot];
+    QueuedReply& reply = entry.queuedWrite->replies[entry.queuedReply];
+    reply.withdrawn = true;
+    --entry.queuedWrite->live;
+    entry.queuedWrite = nullptr;
+    queuedCommands_.fetch_sub(1, std::memory_order_relaxed);
+    return reply.responseKey;
+}
+
+/**
+ * @brief Returns a slot to the free list once its reply has been consumed.
+ *
+ * Must be called with callbackMutex_ held.
+ * @param slot The slot index.
+ * @param site Receives where the callback was registered.
+ * @param journalSequence Receives the command's submitted journal record, 0 if none.
+ * @return The slot's callback, empty if it was cancelled.
+ */
+std::function<void(const ProtocolResponse&)> ProtocolHandler::releaseSlot(std::uint32_t slot, CallSite& site,
+                                                                         std::uint64_t& journalSequence) {
+    CallbackSlot& entry = callbackSlots_[slot];
+    std::function<void(const ProtocolResponse&)> callback = std::move(entry.callback);
+    site = entry.site;
+    journalSequence = entry.journalSequence;
+    entry.journalSequence = 0;
+    entry.queuedWrite = nullptr;
+    entry.callback = nullptr;
+    ++entry.generation;
+    freeSlots_.push_back(slot);
+    return callback;
+}
+
+/**
+ * @brief Records a command in the journal, if any and if the journal takes it, and remembers the record in its slot.
+ *
+ * Must be called with callbackMutex_ held.
+ * @param slot The slot holding the command's callback.
+ * @param responseKey The command's response key.
+ * @param line The command line, without CR/LF.
+ */
+void ProtocolHandler::journalSubmission(std::uint32_t slot, std::string_view responseKey, std::string_view line) {
+    if (commandJournal_ && commandJournal_->journals(responseKey)) {
+        callbackSlots_[slot].journalSequence = commandJournal_->recordSubmitted(line, axisOfKey(responseKey));
+    }
+}
+
+/**
+ * @brief Detaches the callback of a submitted command so it never runs.
+ * @param handle The handle returned when the command was submitted.
+ * @return True if the callback was detached, false if it already ran or was cancelled.
+ */
+bool ProtocolHandler::cancel(const CommandHandle& handle) {
+    std::function<void(const ProtocolResponse&)> detached;
+    std::string withdrawnKey;
+    std::uint64_t journalSequence = 0;
+    {
+        std::lock_guard<std::mutex> lock(callbackMutex_);
+        if (handle.owner_ != this || handle.slot_ >= callbackSlots_.size()) {
+            return false;
         }
-        for (size_t i = 0; i < params.size(); ++i) {
-            fullCommand += params[i];
-            if (i < params.size() - 1) {
-                fullCommand += "/";
+        CallbackSlot& entry = callbackSlots_[handle.slot_];
+        if (entry.generation != handle.generation_ || (!entry.callback && !entry.queuedWrite)) {
+            return false;
+        }
+        if (entry.queuedWrite) {
+            // Not written yet: the command is withdrawn from its fair queue and its slot is freed at once.
+            withdrawnKey = withdrawQueued(handle.slot_);
+            CallSite site;
+            detached = releaseSlot(handle.slot_, site, journalSequence);
+            dispatchQueued(); // A shortened batch at the head of a queue may fit the window now
+            if (pendingCommands_.load(std::memory_order_relaxed) == 0 && queuedCommands_.load(std::memory_order_relaxed) == 0 &&
+                !acceptingCommands_.load()) {
+                drainedCv_.notify_all(); // shutdown() was waiting for this command
             }
+        } else {
+            // The slot stays queued so the reply, when it arrives, is still matched in order and then dropped.
+            detached = std::move(entry.callback);
+            entry.callback = nullptr;
         }
     }
-    fullCommand += "\r\n";
+    if (journalSequence != 0) {
+        commandJournal_->recordCompleted(journalSequence, axisOfKey(withdrawnKey), 'E', "cancelled");
+    }
+    cancelledCommands_.fetch_add(1, std::memory_order_relaxed);
+    // Destroyed outside the lock, releasing whatever the callback captured.
+    return true;
+}
+
+/**
+ * @brief Sends a command with an optional axis number and parameters asynchronously.
+ * @param baseCommand The command string (e.g., "APS", "RDP", "CERR").
+ * @param axisNo The axis number for the command. Use a special value (e.g., -1) if no axis number is required.
+ * @param params A vector of string parameters.
+ * @param callback The callback function to execute when a response is received.
+ * @param site Where the callback is registered.
+ */
+CommandHandle ProtocolHandler::sendCommand(const std::string& baseCommand, int axisNo, const std::vector<std::string>& params, std::function<void(const ProtocolResponse&)> callback,
+                                           CallSite site) {
+    if (!acceptingCommands_.load()) {
+        rejectCommand(generateResponseKey(baseCommand, axisNo), callback, site);
+        return CommandHandle();
+    }
+    std::string fullCommand;
+    appendCommand(fullCommand, baseCommand, axisNo, params);
     // Protect the map access with a lock
     std::lock_guard<std::mutex> lock(callbackMutex_);
+    const std::string_view line(fullCommand.data(), fullCommand.size() - 2);
+    if (fairQueueing_) {
+        const CommandHandle handle = allocateSlot(std::move(callback), site);
+        QueuedWrite write;
+        write.replies.push_back(QueuedReply{generateResponseKey(baseCommand, axisNo), handle.slot_});
+        journalSubmission(handle.slot_, write.replies.back().responseKey, line);
+        write.bytes = std::move(fullCommand);
+        queueWrite(std::move(write));
+        return handle;
+    }
     // Push the callback into the queue for the specific command and axis
-    responseCallbacks_[generateResponseKey(baseCommand, axisNo)].push(callback);
+    const std::string responseKey = generateResponseKey(baseCommand, axisNo);
+    const CommandHandle handle = registerCallback(responseKey, std::move(callback), wallClockNs(), site);
+    journalSubmission(handle.slot_, responseKey, line);
     // Log the full command being sent
     spdlog::info("Sending command: {}", fullCommand);
 
     client_->asyncWrite(fullCommand);
+    lastSentNs_.store(steadyClockNs(), std::memory_order_relaxed);
+    return handle;
+}
+
+/**
+ * @brief Sends several commands in a single write so they are pipelined on the connection.
+ * @param requests The commands to send.
+ * @param site Where the callbacks are registered.
+ * @return One cancellation handle per request, in request order.
+ */
+std::vector<CommandHandle> ProtocolHandler::sendCommands(const std::vector<CommandRequest>& requests, CallSite site) {
+    CommandBatch batch;
+    for (const CommandRequest& request : requests) {
+        batch.add(request.baseCommand, request.axisNo, request.params, request.callback, site);
+    }
+    sendBatch(batch);
+    std::vector<CommandHandle> handles;
+    handles.reserve(batch.size());
+    for (std::size_t i = 0; i < batch.size(); ++i) {
+        handles.push_back(batch.handle(i));
+    }
+    return handles;
+}
+
+/**
+ * @brief Sends every command of a batch in a single write.
+ * @param batch The commands to send.
+ */
+void ProtocolHandler::sendBatch(CommandBatch& batch) {
+    if (batch.entries_.empty()) {
+        return;
+    }
+    if (!acceptingCommands_.load()) {
+        for (CommandBatch::Entry& entry : batch.entries_) {
+            rejectCommand(entry.responseKey, entry.callback, entry.site);
+        }
+        return;
+    }
+    std::lock_guard<std::mutex> lock(callbackMutex_);
+    if (fairQueueing_) {
+        // The batch stays one write and costs its command count in its submitter's round.
+        QueuedWrite write;
+        write.bytes.assign(batch.encoded_.data(), batch.encoded_.size());
+        write.replies.reserve(batch.entries_.size());
+        for (CommandBatch::Entry& entry : batch.entries_) {
+            entry.handle = allocateSlot(std::move(entry.callback), entry.site);
+            write.replies.push_back(QueuedReply{std::string(entry.responseKey), entry.handle.slot_, entry.lineBegin});
+            journalSubmission(entry.handle.slot_, entry.responseKey,
+                              std::string_view(batch.encoded_).substr(entry.lineBegin, entry.lineEnd - entry.lineBegin));
+        }
+        queueWrite(std::move(write));
+        return;
+    }
+    // The whole batch leaves in one write, so every command shares the send time.
+    const std::int64_t sentNs = wallClockNs();
+    for (CommandBatch::Entry& entry : batch.entries_) {
+        entry.handle = registerCallback(entry.responseKey, std::move(entry.callback), sentNs, entry.site);
+        journalSubmission(entry.handle.slot_, entry.responseKey,
+                          std::string_view(batch.encoded_).substr(entry.lineBegin, entry.lineEnd - entry.lineBegin));
+    }
+    spdlog::debug("Sending {} pipelined commands ({} bytes).", batch.entries_.size(), batch.encoded_.size());
+
+    batchBuffer_.assign(batch.encoded_.data(), batch.encoded_.size());
+    client_->asyncWrite(batchBuffer_);
+    lastSentNs_.store(steadyClockNs(), std::memory_order_relaxed);
+}
+
+/**
+ * @brief Returns the request latency estimate of this connection.
+ * @return The latency snapshot.
+ */
+LatencySnapshot ProtocolHandler::latency() {
+    std::lock_guard<std::mutex> lock(callbackMutex_);
+    return latencyEstimator_.snapshot();
+}
+
+/**
+ * @brief Sets how the minimum round trip is split into an outbound and an inbound leg.
+ * @param outboundShare Fraction of the minimum round trip spent before the controller serves a request.
+ * @param windowSamples Number of samples after which the minimum round trip is re-measured.
+ */
+void ProtocolHandler::setLatencySplit(double outboundShare, std::size_t windowSamples) {
+    std::lock_guard<std::mutex> lock(callbackMutex_);
+    latencyEstimator_ = LatencyEstimator(outboundShare, windowSamples);
+}
+
+/**
+ * @brief Returns the progress counters of this connection.
+ * @return The activity snapshot.
+ */
+ConnectionActivity ProtocolHandler::activity() const {
+    ConnectionActivity activity;
+    activity.lastSentNs = lastSentNs_.load(std::memory_order_relaxed);
+    activity.lastReceivedNs = lastReceivedNs_.load(std::memory_order_relaxed);
+    activity.waitingSinceNs = waitingSinceNs_.load(std::memory_order_relaxed);
+    activity.pendingCommands = pendingCommands_.load(std::memory_order_relaxed);
+    return activity;
+}
+
+/**
+ * @brief Completes every command still waiting for a reply with an error response.
+ * @param reason The reason passed to the callbacks.
+ * @return The number of commands failed.
+ */
+std::size_t ProtocolHandler::failPendingCommands(const std::string& reason) {
+    std::vector<std::tuple<std::string, std::int64_t, std::function<void(const ProtocolResponse&)>, CallSite, std::uint64_t>> abandoned;
+    {
+        std::lock_guard<std::mutex> lock(callbackMutex_);
+        for (auto& [responseKey, queue] : responseCallbacks_) {
+            while (!queue.empty()) {
+                const PendingCallback pending = queue.pop();
+                pendingCommands_.fetch_sub(1, std::memory_order_relaxed);
+                CallSite site;
+                std::uint64_t journalSequence = 0;
+                std::function<void(const ProtocolResponse&)> callback = releaseSlot(pending.slot, site, journalSequence);
+                abandoned.emplace_back(responseKey, pending.sentNs, std::move(callback), site, journalSequence);
+            }
+        }
+        // Commands still in the fair queues were never written; they fail the same way.
+        for (std::uint64_t tag : activeSubmitters_) {
+            SubmitterQueue& queue = submitterQueues_[tag];
+            for (QueuedWrite& write : queue.writes) {
+                for (QueuedReply& reply : write.replies) {
+                    if (reply.withdrawn) {
+                        continue; // Its slot was released by cancel()
+                    }
+                    CallSite site;
+                    std::uint64_t journalSequence = 0;
+                    std::function<void(const ProtocolResponse&)> callback = releaseSlot(reply.slot, site, journalSequence);
+                    abandoned.emplace_back(std::move(reply.responseKey), 0, std::move(callback), site, journalSequence);
+                }
+            }
+        }
+        submitterQueues_.clear();
+        activeSubmitters_.clear();
+        queuedCommands_.store(0, std::memory_order_relaxed);
+        drainedCv_.notify_all(); // A shutdown() draining the connection has nothing left to wait for
+    }
+    if (abandoned.empty()) {
+        return 0;
+    }
+    spdlog::warn("Failing {} commands still waiting for a reply: {}", abandoned.size(), reason);
+    // Callbacks run without the lock so they may send new commands.
+    for (auto& [responseKey, sentNs, callback, site, journalSequence] : abandoned) {
+        if (journalSequence != 0) {
+            commandJournal_->recordCompleted(journalSequence, axisOfKey(responseKey), 'E', reason);
+        }
+        if (callback) {
+            invokeCallback(callback, makeErrorResponse(responseKey, reason, sentNs), site);
+        }
+    }
+    return abandoned.size();
+}
+
+/**
+ * @brief Shuts the connection down in order, waiting at most the given time for replies in flight.
+ * @param deadline How long to wait for outstanding replies before failing them.
+ * @return What happened to the outstanding commands.
+ */
+ShutdownReport ProtocolHandler::shutdown(std::chrono::milliseconds deadline) {
+    const auto start = std::chrono::steady_clock::now();
+    ShutdownReport report;
+    // 1. Stop intake: new commands are rejected from here on.
+    if (!acceptingCommands_.exchange(false)) {
+        return report;
+    }
+    // 2. Drain: every command already written has been flushed to the client, so wait for its reply.
+    //    Commands still in the fair queues are written as replies free the window. On the I/O
+    //    thread no reply can arrive while this waits, so nothing is awaited there.
+    {
+        const auto drained = [this] {
+            return pendingCommands_.load(std::memory_order_relaxed) == 0 &&
+                   queuedCommands_.load(std::memory_order_relaxed) == 0;
+        };
+        std::unique_lock<std::mutex> lock(callbackMutex_);
+        if (readGuard_->readerThread.load() == std::this_thread::get_id()) {
+            report.drained = drained();
+        } else {
+            report.drained = drainedCv_.wait_until(lock, start + deadline, drained);
+        }
+    }
+    // 3. Stop reading, so nothing reaches this handler after shutdown() returns, and fail what is left.
+    detachFromClient();
+    report.failedCommands = failPendingCommands("shutdown");
+    // 4. Close the connection.
+    client_->close();
+    report.elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    spdlog::info("ProtocolHandler shut down in {:.1f} ms ({}, {} commands failed).", report.elapsedMs,
+                 report.drained ? "drained" : "deadline reached", report.failedCommands);
+    return report;
+}
+
+/**
+ * @brief Completes a command submitted after shutdown() with an error response, without sending it.
+ * @param responseKey The command's response key.
+ * @param callback The command's callback.
+ * @param site Where the callback was registered.
+ */
+void ProtocolHandler::rejectCommand(std::string_view responseKey, const std::function<void(const ProtocolResponse&)>& callback,
+                                    const CallSite& site) {
+    spdlog::warn("Rejecting command {} submitted after shutdown.", responseKey);
+    if (callback) {
+        invokeCallback(callback, makeErrorResponse(responseKey, "shutdown", 0), site);
+    }
+}
+
+/**
+ * @brief Replaces the profiler that times this handler's callbacks.
+ * @param profiler The profiler. Must not be null.
+ */
+void ProtocolHandler::setCallbackProfiler(std::shared_ptr<CallbackProfiler> profiler) {
+    if (!profiler) {
+        throw std::invalid_argument("CallbackProfiler object is not valid.");
+    }
+    callbackProfiler_ = std::move(profiler);
+}
+
+/**
+ * @brief Runs a user callback and records how long it took with the callback profiler.
+ * @param callback The callback to run.
+ * @param response The response passed to the callback.
+ * @param site Where the callback was registered.
+ */
+void ProtocolHandler::invokeCallback(const std::function<void(const ProtocolResponse&)>& callback,
+                                     const ProtocolResponse& response, const CallSite& site) {
+    const std::int64_t startNs = steadyClockNs();
+    callback(response);
+    callbackProfiler_->record(site, response.command, response.axisNo, steadyClockNs() - startNs);
 }
 
 /**
@@ -82,97 +728,172 @@ void ProtocolHandler::sendCommand(const std::string& baseCommand, int axisNo, co
  * @param responseData The received response string.
  */
 void ProtocolHandler::handleRead(const std::string& responseData) {
-    try {
-        ProtocolResponse response = parseResponse(responseData);
+    // Prefer the transport's receive time (e.g. a kernel timestamp) over the time this handler runs.
+    std::int64_t receivedNs = client_->receiveTimestampNs();
+    if (receivedNs == 0) {
+        receivedNs = wallClockNs();
+    }
+    lastReceivedNs_.store(steadyClockNs(), std::memory_order_relaxed);
+    std::error_code error;
+    ProtocolResponse& response = scratchResponse_;
+    parseResponse(responseData, response, error);
+    if (error) {
+        spdlog::error("Protocol error: {}", error.message());
+    } else {
         spdlog::info("Received response: {}", response.fullResponse);
 
-        std::string responseKey = generateResponseKey(response.command, response.axisNo);
-        
-        // Protect the map access with a lock
-        std::lock_guard<std::mutex> lock(callbackMutex_);
-        // Find the matching queue for the received response
-        auto it = responseCallbacks_.find(responseKey);
-        if (it != responseCallbacks_.end()) {
-            ThreadSafeQueue<std::function<void(const ProtocolResponse&)>>& queue = it->second;
-            if (!queue.empty()) {
-                std::function<void(const ProtocolResponse&)> callback = queue.pop();
-                callback(response);
+        // Keys are short mnemonics plus an axis number and stay within the small-string buffer.
+        const std::string responseKey = generateResponseKey(response.command, response.axisNo);
+
+        std::function<void(const ProtocolResponse&)> callback;
+        CallSite site;
+        std::uint64_t journalSequence = 0;
+        bool matched = false;
+        {
+            // Protect the map access with a lock
+            std::lock_guard<std::mutex> lock(callbackMutex_);
+            // Find the matching queue for the received response
+            auto it = responseCallbacks_.find(responseKey);
+            if (it != responseCallbacks_.end() && !it->second.empty()) {
+                PendingCallback pending = it->second.pop();
+                pendingCommands_.fetch_sub(1, std::memory_order_relaxed);
+                if (fairQueueing_) {
+                    dispatchQueued(); // The reply frees a place in the window
+                }
+                if (pendingCommands_.load(std::memory_order_relaxed) == 0 && queuedCommands_.load(std::memory_order_relaxed) == 0 &&
+                    !acceptingCommands_.load()) {
+                    drainedCv_.notify_all(); // shutdown() is waiting for the last reply
+                }
+                response.sentNs = pending.sentNs;
+                response.receivedNs = receivedNs;
+                response.sampleNs = latencyEstimator_.estimate(pending.sentNs, receivedNs);
+                callback = releaseSlot(pending.slot, site, journalSequence);
+                matched = true;
             }
-            if (queue.empty()) {
-                responseCallbacks_.erase(it);
+        }
+        if (journalSequence != 0) {
+            std::string_view reply(response.fullResponse);
+            while (!reply.empty() && (reply.back() == '\r' || reply.back() == '\n')) {
+                reply.remove_suffix(1);
             }
-        } else {
+            commandJournal_->recordCompleted(journalSequence, response.axisNo, response.status, reply);
+        }
+        if (!matched) {
             // This is an unsolicited response or no matching callback was found
             spdlog::warn("No matching callback queue found for response: {}", responseData);
+        } else if (callback) {
+            // Run without the lock so the callback may send or cancel commands. Cancelled commands have no callback.
+            invokeCallback(callback, response, site);
         }
-
-    } catch (const ProtocolException& e) {
-        spdlog::error("Protocol error: {}", e.what());
     }
-
-    client_->asyncRead([this](const std::string& data) {
-        this->handleRead(data);
-    });
+    // The client keeps its read loop running; re-arming here would stack a second pending read per line.
 }
 
 /**
- * @brief Parses the response string into a ProtocolResponse struct based on the provided manual.
+ * @brief Parses the response string into an existing ProtocolResponse, reusing its storage.
  * @param response The response string to parse.
- * @return The parsed ProtocolResponse object.
+ * @param parsed The object to fill. Only partially filled if error is set.
+ * @param error Set to a ProtocolErrc value on failure, cleared on success.
  */
-ProtocolResponse ProtocolHandler::parseResponse(const std::string& response) {
-    ProtocolResponse parsed;
-    parsed.fullResponse = response;
-    std::string cleanedResponse = response;
+void ProtocolHandler::parseResponse(const std::string& response, ProtocolResponse& parsed, std::error_code& error) {
+    error.clear();
+    parsed.fullResponse.assign(response);
+    parsed.status = '\0';
+    parsed.command.clear();
+    parsed.axisNo = -1;
+    parsed.sentNs = 0;
+    parsed.receivedNs = 0;
+    parsed.sampleNs = 0;
+    std::size_t paramCount = 0;
+
+    std::string_view cleanedResponse = response;
     // Remove carriage return and line feed from the end.
     if (!cleanedResponse.empty() && cleanedResponse.back() == '\n') {
-        cleanedResponse.pop_back();
+        cleanedResponse.remove_suffix(1);
     }
     if (!cleanedResponse.empty() && cleanedResponse.back() == '\r') {
-        cleanedResponse.pop_back();
-    }
-    
-    if (cleanedResponse.empty()) {
-        throw ProtocolException("Received an empty response.");
+        cleanedResponse.remove_suffix(1);
     }
 
-    // Use a stringstream to split the response by the tab delimiter.
-    std::stringstream ss(cleanedResponse);
-    std::vector<std::string> tokens;
-    std::string token;
-    while (std::getline(ss, token, '\t')) {
-        tokens.push_back(token);
+    if (cleanedResponse.empty()) {
+        parsed.params.clear();
+        error = ProtocolErrc::emptyResponse;
+        return;
     }
 
-    if (tokens.empty()) {
-        throw ProtocolException("Invalid response format: No fields found.");
-    }
+    // Split the response by the tab delimiter. A trailing tab does not start a new field.
+    std::size_t fieldIndex = 0;
+    std::size_t fieldStart = 0;
+    while (fieldStart <= cleanedResponse.size()) {
+        const std::size_t tab = cleanedResponse.find('\t', fieldStart);
+        const std::size_t fieldEnd = tab == std::string_view::npos ? cleanedResponse.size() : tab;
+        const std::string_view field = cleanedResponse.substr(fieldStart, fieldEnd - fieldStart);
+        if (tab == std::string_view::npos && field.empty() && fieldIndex > 0) {
+            break;
+        }
 
-    // 1. Parse Status (first field)
-    parsed.status = tokens[0][0];
-    // 2. Parse Command and Axis No. (second field)
-    if (tokens.size() > 1) {
-        std::string commandAndAxis = tokens[1];
-        size_t firstDigitPos = commandAndAxis.find_first_of("0123456789");
-        if (firstDigitPos != std::string::npos) {
-            parsed.command = commandAndAxis.substr(0, firstDigitPos);
-            try {
-                parsed.axisNo = std::stoi(commandAndAxis.substr(firstDigitPos));
-            } catch (const std::exception& e) {
-                throw ProtocolException("Failed to parse axis number from response: " + std::string(e.what()));
+        if (fieldIndex == 0) {
+            // 1. Parse Status (first field)
+            parsed.status = field.empty() ? '\0' : field[0];
+        } else if (fieldIndex == 1) {
+            // 2. Parse Command and Axis No. (second field)
+            const std::size_t firstDigitPos = field.find_first_of("0123456789");
+            if (firstDigitPos != std::string_view::npos) {
+                parsed.command.assign(field.substr(0, firstDigitPos));
+                if (parseInteger(field.substr(firstDigitPos), parsed.axisNo)) {
+                    parsed.params.clear();
+                    error = ProtocolErrc::invalidAxisNumber;
+                    return;
+                }
+            } else {
+                parsed.command.assign(field);
+                parsed.axisNo = -1; // No axis number in the response
             }
         } else {
-            parsed.command = commandAndAxis;
-            parsed.axisNo = -1; // No axis number in the response
+            // 3. Parse Parameters (remaining fields), reusing the strings of the previous response
+            if (paramCount < parsed.params.size()) {
+                parsed.params[paramCount].assign(field);
+            } else {
+                parsed.params.emplace_back(field);
+            }
+            ++paramCount;
         }
-    } else {
-        throw ProtocolException("Invalid response format: Missing command field.");
+
+        ++fieldIndex;
+        if (tab == std::string_view::npos) {
+            break;
+        }
+        fieldStart = tab + 1;
     }
+    parsed.params.resize(paramCount);
 
-    // 3. Parse Parameters (remaining fields)
-    for (size_t i = 2; i < tokens.size(); ++i) {
-        parsed.params.push_back(tokens[i]);
+    if (fieldIndex < 2) {
+        error = ProtocolErrc::missingCommandField;
+    }
+}
+
+/**
+ * @brief Parses the response string into a ProtocolResponse struct based on the provided manual.
+ * @param response The response string to parse.
+ * @param error Set to a ProtocolErrc value on failure, cleared on success.
+ * @return The parsed ProtocolResponse object. Only partially filled if error is set.
+ */
+ProtocolResponse ProtocolHandler::parseResponse(const std::string& response, std::error_code& error) {
+    ProtocolResponse parsed;
+    parseResponse(response, parsed, error);
+    return parsed;
+}
+
+/**
+ * @brief Parses the response string into a ProtocolResponse struct, throwing on malformed input.
+ * @param response The response string to parse.
+ * @return The parsed ProtocolResponse object.
+ */
+ProtocolResponse ProtocolHandler::parseResponse(const std::string& response) {
+    std::error_code error;
+    ProtocolResponse parsed = parseResponse(response, error);
+    if (error) {
+        throw ProtocolException(error.message());
     }
-    
     return parsed;
-}
\ No newline at end of file
+}
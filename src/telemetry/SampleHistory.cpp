@@ -0,0 +1,94 @@
+#include "telemetry/SampleHistory.h"
+#include <stdexcept>
+
+/**
+ * @brief Constructor for the SampleHistory class.
+ * @param capacity The number of recent samples retained per axis.
+ */
+SampleHistory::SampleHistory(std::size_t capacity)
+    : capacity_(capacity) {
+    if (capacity_ == 0) {
+        throw std::invalid_argument("SampleHistory capacity must be positive.");
+    }
+}
+
+/**
+ * @brief Registers this history as a sample listener of the given AxisState.
+ * @param axisState The state whose updates should be retained.
+ */
+void SampleHistory::attach(AxisState& axisState) {
+    axisState.addSampleListener([this](const AxisSample& sample) {
+        this->addSample(sample);
+    });
+}
+
+/**
+ * @brief Appends a sample to the history of its axis.
+ * @param sample The sample to append.
+ */
+void SampleHistory::addSample(const AxisSample& sample) {
+    AxisBuffer* buffer;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto& slot = axes_[sample.axisNo];
+        if (!slot) {
+            slot = std::make_unique<AxisBuffer>(capacity_);
+        }
+        buffer = slot.get();
+    }
+
+    // Samples of one axis arrive from a single updating thread, so only the map needs the lock.
+    const std::uint64_t total = buffer->total.load(std::memory_order_relaxed);
+    const std::size_t index = static_cast<std::size_t>(total % capacity_);
+    for (std::size_t slotIndex : {index, index + capacity_}) {
+        buffer->timestampsNs[slotIndex] = sample.timestampNs;
+        buffer->positions[slotIndex] = sample.position;
+        buffer->statusWords[slotIndex] = sample.statusWord;
+        buffer->hasPositions[slotIndex] = sample.hasPosition;
+    }
+    buffer->total.store(total + 1, std::memory_order_release);
+}
+
+/**
+ * @brief Returns a contiguous view of the most recent samples of an axis, oldest first.
+ * @param axisNo The axis number.
+ * @return The view. Empty if the axis has no samples.
+ */
+SampleHistoryWindow SampleHistory::window(int axisNo) {
+    SampleHistoryWindow view;
+    AxisBuffer* buffer = findBuffer(axisNo);
+    if (!buffer) {
+        return view;
+    }
+    const std::uint64_t total = buffer->total.load(std::memory_order_acquire);
+    // Until the ring has wrapped the samples sit at the start of the first half.
+    const std::size_t start = total < capacity_ ? 0 : static_cast<std::size_t>(total % capacity_);
+    view.timestampsNs = buffer->timestampsNs.data() + start;
+    view.positions = buffer->positions.data() + start;
+    view.statusWords = buffer->statusWords.data() + start;
+    view.hasPositions = buffer->hasPositions.data() + start;
+    view.size = total < capacity_ ? static_cast<std::size_t>(total) : capacity_;
+    view.totalSamples = total;
+    return view;
+}
+
+/**
+ * @brief Returns the number of samples ever recorded for an axis.
+ * @param axisNo The axis number.
+ * @return The sample count.
+ */
+std::uint64_t SampleHistory::totalSamples(int axisNo) {
+    AxisBuffer* buffer = findBuffer(axisNo);
+    return buffer ? buffer->total.load(std::memory_order_acquire) : 0;
+}
+
+/**
+ * @brief Looks up the buffer of an axis.
+ * @param axisNo The axis number.
+ * @return The buffer, or nullptr if the axis has no samples.
+ */
+SampleHistory::AxisBuffer* SampleHistory::findBuffer(int axisNo) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = axes_.find(axisNo);
+    return it != axes_.end() ? it->second.get() : nullptr;
+}
@@ -0,0 +1,151 @@
+#include "telemetry/TelemetryDownsampler.h"
+#include <algorithm>
+#include <stdexcept>
+
+/**
+ * @brief Returns the default levels: 1 s for 1 hour, 10 s for 1 day and 1 min for 1 week.
+ * @return The default level configuration.
+ */
+std::vector<TelemetryDownsampler::Level> TelemetryDownsampler::defaultLevels() {
+    constexpr std::int64_t kSecondNs = 1000000000;
+    return {
+        {kSecondNs, 3600},
+        {10 * kSecondNs, 8640},
+        {60 * kSecondNs, 10080},
+    };
+}
+
+/**
+ * @brief Constructor for the TelemetryDownsampler class.
+ * @param levels The resolution levels, ordered from finest to coarsest.
+ */
+TelemetryDownsampler::TelemetryDownsampler(std::vector<Level> levels)
+    : levels_(std::move(levels)) {
+    if (levels_.empty()) {
+        throw std::invalid_argument("At least one downsampling level is required.");
+    }
+    for (const Level& level : levels_) {
+        if (level.bucketNs <= 0 || level.capacity == 0) {
+            throw std::invalid_argument("Downsampling levels need a positive bucket width and capacity.");
+        }
+    }
+}
+
+/**
+ * @brief Registers this downsampler as a sample listener of the given AxisState.
+ * @param axisState The state whose updates should be aggregated.
+ */
+void TelemetryDownsampler::attach(AxisState& axisState) {
+    axisState.addSampleListener([this](const AxisSample& sample) {
+        this->addSample(sample);
+    });
+}
+
+/**
+ * @brief Folds a sample into the current bucket of every level.
+ * @param sample The sample to aggregate.
+ */
+void TelemetryDownsampler::addSample(const AxisSample& sample) {
+    if (!sample.positionUpdated) {
+        return; // A status-only update repeats the last position, which was aggregated when it was read
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& rings = axes_[sample.axisNo];
+    if (rings.empty()) {
+        rings.resize(levels_.size());
+        for (std::size_t i = 0; i < levels_.size(); ++i) {
+            rings[i].buckets.resize(levels_[i].capacity);
+        }
+    }
+
+    for (std::size_t i = 0; i < levels_.size(); ++i) {
+        Ring& ring = rings[i];
+        const std::int64_t width = levels_[i].bucketNs;
+        std::int64_t bucketStart = sample.timestampNs - sample.timestampNs % width;
+        if (sample.timestampNs % width < 0) {
+            bucketStart -= width;
+        }
+
+        if (ring.size == 0 || bucketStart > ring.newest().startNs) {
+            // Open a new bucket, overwriting the oldest one once the ring is full.
+            if (ring.size < ring.buckets.size()) {
+                ++ring.size;
+            } else {
+                ring.head = (ring.head + 1) % ring.buckets.size();
+            }
+            DownsampleBucket& bucket = ring.newest();
+            bucket.startNs = bucketStart;
+            bucket.min = sample.position;
+            bucket.max = sample.position;
+            bucket.last = sample.position;
+            bucket.count = 1;
+            bucket.sum = sample.position;
+            continue;
+        }
+
+        DownsampleBucket& bucket = ring.newest();
+        bucket.min = std::min(bucket.min, sample.position);
+        bucket.max = std::max(bucket.max, sample.position);
+        bucket.last = sample.position;
+        ++bucket.count;
+        bucket.sum += sample.position;
+    }
+}
+
+/**
+ * @brief Copies the buckets of one level that overlap a time range.
+ * @param axisNo The axis number.
+ * @param level The level index (0 is the finest).
+ * @param startNs Inclusive lower time bound.
+ * @param endNs Inclusive upper time bound.
+ * @param out The vector that receives the buckets in time order (appended).
+ * @return The number of buckets appended.
+ */
+std::size_t TelemetryDownsampler::getBuckets(int axisNo, std::size_t level, std::int64_t startNs, std::int64_t endNs,
+                                             std::vector<DownsampleBucket>& out) {
+    if (level >= levels_.size()) {
+        throw std::out_of_range("Downsampling level out of range.");
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = axes_.find(axisNo);
+    if (it == axes_.end()) {
+        return 0;
+    }
+    const Ring& ring = it->second[level];
+    const std::int64_t width = levels_[level].bucketNs;
+
+    // Buckets are ordered by start time, so binary search for the first one ending after startNs.
+    std::size_t low = 0;
+    std::size_t high = ring.size;
+    while (low < high) {
+        const std::size_t middle = low + (high - low) / 2;
+        if (ring.at(middle).startNs + width <= startNs) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+
+    const std::size_t initialSize = out.size();
+    for (std::size_t i = low; i < ring.size && ring.at(i).startNs <= endNs; ++i) {
+        out.push_back(ring.at(i));
+    }
+    return out.size() - initialSize;
+}
+
+/**
+ * @brief Picks the finest level that covers a time range with at most maxPoints buckets.
+ * @param startNs Inclusive lower time bound.
+ * @param endNs Inclusive upper time bound.
+ * @param maxPoints The maximum number of buckets the caller wants to read.
+ * @return The level index; the coarsest level if none is coarse enough.
+ */
+std::size_t TelemetryDownsampler::selectLevel(std::int64_t startNs, std::int64_t endNs, std::size_t maxPoints) const {
+    const std::int64_t span = endNs > startNs ? endNs - startNs : 0;
+    for (std::size_t i = 0; i < levels_.size(); ++i) {
+        if (static_cast<std::size_t>(span / levels_[i].bucketNs) + 1 <= maxPoints) {
+            return i;
+        }
+    }
+    return levels_.size() - 1;
+}
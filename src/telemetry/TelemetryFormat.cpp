@@ -0,0 +1,205 @@
+#include "telemetry/TelemetryFormat.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+
+namespace {
+
+struct AxisHistory {
+    std::int64_t position = 0;
+    std::uint32_t statusWord = 0;
+};
+
+std::uint64_t zigzagEncode(std::int64_t value) {
+    return (static_cast<std::uint64_t>(value) << 1) ^ static_cast<std::uint64_t>(value >> 63);
+}
+
+std::int64_t zigzagDecode(std::uint64_t value) {
+    return static_cast<std::int64_t>(value >> 1) ^ -static_cast<std::int64_t>(value & 1);
+}
+
+void writeVarint(std::vector<std::uint8_t>& out, std::uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<std::uint8_t>(value) | 0x80);
+        value >>= 7;
+    }
+    out.push_back(static_cast<std::uint8_t>(value));
+}
+
+bool readVarint(const std::uint8_t*& cursor, const std::uint8_t* end, std::uint64_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 64 && cursor < end; shift += 7) {
+        const std::uint8_t byte = *cursor++;
+        value |= static_cast<std::uint64_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+/**
+ * @brief Encodes samples into a complete block (header and payload).
+ * @param samples The samples to encode, in arrival order. Must not be empty.
+ * @param out The buffer that receives the block (appended).
+ */
+void TelemetryCodec::encodeBlock(const std::vector<AxisSample>& samples, std::vector<std::uint8_t>& out) {
+    // Column scratch buffers are reused across calls on the writer thread.
+    thread_local std::vector<std::uint8_t> columns[4];
+    thread_local std::unordered_map<int, AxisHistory> history;
+    for (auto& column : columns) {
+        column.clear();
+    }
+    history.clear();
+
+    TelemetryBlockHeader header;
+    header.sampleCount = static_cast<std::uint32_t>(samples.size());
+    header.firstTimestampNs = samples.front().timestampNs;
+    header.minTimestampNs = samples.front().timestampNs;
+    header.maxTimestampNs = samples.front().timestampNs;
+
+    std::int64_t previousTimestamp = header.firstTimestampNs;
+    for (const AxisSample& sample : samples) {
+        writeVarint(columns[0], zigzagEncode(sample.timestampNs - previousTimestamp));
+        previousTimestamp = sample.timestampNs;
+        header.minTimestampNs = std::min(header.minTimestampNs, sample.timestampNs);
+        header.maxTimestampNs = std::max(header.maxTimestampNs, sample.timestampNs);
+
+        writeVarint(columns[1], zigzagEncode(sample.axisNo) << 1 | (sample.hasPosition ? 0 : 1));
+        header.axisMask |= std::uint64_t{1} << (static_cast<unsigned>(sample.axisNo) % 64);
+
+        AxisHistory& previous = history[sample.axisNo];
+        const std::int64_t position = sample.hasPosition ? sample.position : previous.position;
+        writeVarint(columns[2], zigzagEncode(position - previous.position));
+        writeVarint(columns[3], sample.statusWord ^ previous.statusWord);
+        previous.position = position;
+        previous.statusWord = sample.statusWord;
+    }
+
+    for (int i = 0; i < 4; ++i) {
+        header.columnBytes[i] = static_cast<std::uint32_t>(columns[i].size());
+    }
+
+    const std::size_t offset = out.size();
+    out.resize(offset + sizeof(header));
+    std::memcpy(out.data() + offset, &header, sizeof(header));
+    for (const auto& column : columns) {
+        out.insert(out.end(), column.begin(), column.end());
+    }
+}
+
+/**
+ * @brief Reads and validates the header of the block starting at data.
+ * @param data Pointer to the start of the block.
+ * @param size The number of readable bytes at data.
+ * @param header Receives the decoded header.
+ * @return True if a complete, well-formed block starts at data.
+ */
+bool TelemetryCodec::readBlockHeader(const std::uint8_t* data, std::size_t size, TelemetryBlockHeader& header) {
+    if (size < sizeof(TelemetryBlockHeader)) {
+        return false;
+    }
+    std::memcpy(&header, data, sizeof(header));
+    return header.magic == TelemetryBlockHeader::kMagic
+        && header.payloadBytes() <= size - sizeof(TelemetryBlockHeader);
+}
+
+/**
+ * @brief Decodes every sample of the block starting at data.
+ * @param data Pointer to the start of the block.
+ * @param size The number of readable bytes at data.
+ * @param out The vector that receives the samples (appended).
+ * @return True on success, false if the block is truncated or corrupt.
+ */
+bool TelemetryCodec::decodeBlock(const std::uint8_t* data, std::size_t size, std::vector<AxisSample>& out) {
+    return decodeBlock(data, size, INT64_MIN, INT64_MAX, ~std::uint64_t{0}, {}, out);
+}
+
+/**
+ * @brief Decodes the samples of a block that fall inside a time range and axis selection.
+ * @param data Pointer to the start of the block.
+ * @param size The number of readable bytes at data.
+ * @param startNs Inclusive lower time bound.
+ * @param endNs Inclusive upper time bound.
+ * @param axisMask Bit (axisNo % 64) is set for every selected axis; a quick filter ahead of axes.
+ * @param axes The selected axis numbers, sorted; empty selects every axis whose mask bit is set.
+ * @param out The vector that receives the matching samples (appended).
+ * @return True on success, false if the block is truncated or corrupt.
+ */
+bool TelemetryCodec::decodeBlock(const std::uint8_t* data, std::size_t size, std::int64_t startNs, std::int64_t endNs,
+                                 std::uint64_t axisMask, const std::vector<int>& axes, std::vector<AxisSample>& out) {
+    TelemetryBlockHeader header;
+    if (!readBlockHeader(data, size, header)) {
+        return false;
+    }
+
+    const std::uint8_t* cursors[4];
+    const std::uint8_t* ends[4];
+    const std::uint8_t* columnStart = data + sizeof(TelemetryBlockHeader);
+    for (int i = 0; i < 4; ++i) {
+        cursors[i] = columnStart;
+        columnStart += header.columnBytes[i];
+        ends[i] = columnStart;
+    }
+
+    thread_local std::unordered_map<int, AxisHistory> history;
+    history.clear();
+
+    const std::size_t firstIndex = out.size();
+    const bool selectsAll = startNs <= header.minTimestampNs && endNs >= header.maxTimestampNs
+                         && (axisMask & header.axisMask) == header.axisMask;
+    out.reserve(firstIndex + (selectsAll ? header.sampleCount : 0));
+    std::int64_t timestamp = header.firstTimestampNs;
+    for (std::uint32_t i = 0; i < header.sampleCount; ++i) {
+        std::uint64_t timestampDelta, axisValue, positionDelta, statusDelta;
+        if (!readVarint(cursors[0], ends[0], timestampDelta)
+            || !readVarint(cursors[1], ends[1], axisValue)
+            || !readVarint(cursors[2], ends[2], positionDelta)
+            || !readVarint(cursors[3], ends[3], statusDelta)) {
+            out.resize(firstIndex);
+            return false;
+        }
+
+        // Every sample must go through the per-axis history, even when filtered out.
+        timestamp += zigzagDecode(timestampDelta);
+        const int axisNo = static_cast<int>(zigzagDecode(axisValue >> 1));
+        const bool hasPosition = (axisValue & 1) == 0;
+        AxisHistory& previous = history[axisNo];
+        previous.position += zigzagDecode(positionDelta);
+        previous.statusWord ^= static_cast<std::uint32_t>(statusDelta);
+
+        if (timestamp < startNs || timestamp > endNs
+            || (axisMask & (std::uint64_t{1} << (static_cast<unsigned>(axisNo) % 64))) == 0
+            || (!axes.empty() && !std::binary_search(axes.begin(), axes.end(), axisNo))) {
+            continue;
+        }
+        AxisSample sample;
+        sample.timestampNs = timestamp;
+        sample.axisNo = axisNo;
+        sample.position = hasPosition ? static_cast<int>(previous.position) : -1;
+        sample.statusWord = previous.statusWord;
+        sample.hasPosition = hasPosition;
+        out.push_back(sample);
+    }
+    return true;
+}
+
+/**
+ * @brief Builds the index entry describing a block.
+ * @param header The block header.
+ * @param offset The offset of the block within its segment file.
+ * @return The index entry.
+ */
+TelemetryIndexEntry TelemetryCodec::makeIndexEntry(const TelemetryBlockHeader& header, std::uint64_t offset) {
+    TelemetryIndexEntry entry;
+    entry.minTimestampNs = header.minTimestampNs;
+    entry.maxTimestampNs = header.maxTimestampNs;
+    entry.axisMask = header.axisMask;
+    entry.offset = offset;
+    entry.blockBytes = static_cast<std::uint32_t>(sizeof(TelemetryBlockHeader) + header.payloadBytes());
+    entry.sampleCount = header.sampleCount;
+    return entry;
+}
@@ -0,0 +1,220 @@
+#include "telemetry/TelemetryReader.h"
+#include "telemetry/TelemetryRecorder.h"
+#include "spdlog/spdlog.h"
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+
+namespace bip = boost::interprocess;
+
+/**
+ * @brief Restricts the query to the given axes.
+ * @param axes The axis numbers to select; empty selects every axis.
+ * @return A reference to this query.
+ */
+TelemetryQuery& TelemetryQuery::selectAxes(const std::vector<int>& axes) {
+    this->axes = axes;
+    std::sort(this->axes.begin(), this->axes.end());
+    this->axes.erase(std::unique(this->axes.begin(), this->axes.end()), this->axes.end());
+    // An empty list selects every axis, so the mask must not prune any block either.
+    axisMask = this->axes.empty() ? ~std::uint64_t{0} : 0;
+    for (int axisNo : this->axes) {
+        axisMask |= std::uint64_t{1} << (static_cast<unsigned>(axisNo) % 64);
+    }
+    return *this;
+}
+
+/**
+ * @brief Constructor for the TelemetryReader class.
+ * @param directory The directory containing the segment files.
+ */
+TelemetryReader::TelemetryReader(std::string directory)
+    : directory_(std::move(directory)) {}
+
+/**
+ * @brief Decodes every recorded sample matching the query.
+ * @param query The time range and axis selection.
+ * @param out The caller-provided buffer that receives the samples (appended).
+ * @return The number of samples appended.
+ */
+std::size_t TelemetryReader::query(const TelemetryQuery& query, std::vector<AxisSample>& out) {
+    refreshSegments();
+    const std::size_t initialSize = out.size();
+
+    // Samples are stored in arrival order, so a segment's name does not bound the times in it or
+    // in later segments; every segment is pruned by the time ranges of its blocks instead.
+    for (auto& entry : segments_) {
+        Segment& segment = entry.second;
+        updateIndex(segment);
+
+        const auto& entries = segment.entries;
+        std::size_t i = 0;
+        while (i < entries.size()) {
+            const auto matches = [&](const TelemetryIndexEntry& entry) {
+                return entry.maxTimestampNs >= query.startNs && entry.minTimestampNs <= query.endNs
+                    && (entry.axisMask & query.axisMask) != 0;
+            };
+            if (!matches(entries[i])) {
+                ++i;
+                continue;
+            }
+
+            // Coalesce adjacent matching blocks into a single mapping.
+            std::size_t last = i;
+            while (last + 1 < entries.size() && matches(entries[last + 1])
+                   && entries[last + 1].offset == entries[last].offset + entries[last].blockBytes) {
+                ++last;
+            }
+            const std::uint64_t runOffset = entries[i].offset;
+            const std::uint64_t runBytes = entries[last].offset + entries[last].blockBytes - runOffset;
+
+            try {
+                bip::file_mapping file(segment.path.c_str(), bip::read_only);
+                bip::mapped_region region(file, bip::read_only, static_cast<bip::offset_t>(runOffset),
+                                          static_cast<std::size_t>(runBytes));
+                const auto* base = static_cast<const std::uint8_t*>(region.get_address());
+                for (std::size_t j = i; j <= last; ++j) {
+                    const std::uint64_t blockOffset = entries[j].offset - runOffset;
+                    if (!TelemetryCodec::decodeBlock(base + blockOffset, static_cast<std::size_t>(runBytes - blockOffset),
+                                                     query.startNs, query.endNs, query.axisMask, query.axes, out)) {
+                        spdlog::warn("Skipping corrupt telemetry block at offset {} in {}.", entries[j].offset, segment.path);
+                    }
+                }
+            } catch (const bip::interprocess_exception& e) {
+                spdlog::error("Failed to map telemetry segment {}: {}", segment.path, e.what());
+            }
+            i = last + 1;
+        }
+    }
+    return out.size() - initialSize;
+}
+
+/**
+ * @brief Returns the time range covered by the recording.
+ * @param firstNs Receives the earliest recorded timestamp.
+ * @param lastNs Receives the latest recorded timestamp.
+ * @return False if no samples have been recorded.
+ */
+bool TelemetryReader::timeRange(std::int64_t& firstNs, std::int64_t& lastNs) {
+    refreshSegments();
+    bool found = false;
+    for (auto& entry : segments_) {
+        updateIndex(entry.second);
+        for (const TelemetryIndexEntry& block : entry.second.entries) {
+            firstNs = found ? std::min(firstNs, block.minTimestampNs) : block.minTimestampNs;
+            lastNs = found ? std::max(lastNs, block.maxTimestampNs) : block.maxTimestampNs;
+            found = true;
+        }
+    }
+    return found;
+}
+
+/**
+ * @brief Picks up segment files created since the last call.
+ */
+void TelemetryReader::refreshSegments() {
+    std::error_code error;
+    for (const auto& file : std::filesystem::directory_iterator(directory_, error)) {
+        const std::filesystem::path& path = file.path();
+        if (path.extension() != ".kts") {
+            continue;
+        }
+        // "segment-<20 digit timestamp>.kts", or "segment-<timestamp>-<n>.kts" for the n-th segment sharing a start time
+        const std::string stem = path.stem().string();
+        const std::size_t dash = stem.find('-');
+        if (dash == std::string::npos) {
+            continue;
+        }
+        std::pair<std::int64_t, unsigned> key;
+        try {
+            std::size_t digits = 0;
+            key.first = std::stoll(stem.substr(dash + 1), &digits);
+            const std::size_t suffix = dash + 1 + digits;
+            key.second = suffix < stem.size() && stem[suffix] == '-' ? static_cast<unsigned>(std::stoul(stem.substr(suffix + 1))) : 0;
+        } catch (const std::exception&) {
+            continue;
+        }
+        if (segments_.count(key) == 0) {
+            Segment segment;
+            segment.path = path.string();
+            segment.indexPath = (path.parent_path() / TelemetryRecorder::indexFileName(path.filename().string())).string();
+            segments_.emplace(key, std::move(segment));
+        }
+    }
+    if (error) {
+        spdlog::error("Failed to list telemetry directory {}: {}", directory_, error.message());
+    }
+}
+
+/**
+ * @brief Loads the sidecar index of a segment and extends it over any blocks written since.
+ * @param segment The segment to update.
+ */
+void TelemetryReader::updateIndex(Segment& segment) {
+    std::error_code error;
+    const std::uint64_t fileSize = std::filesystem::file_size(segment.path, error);
+    if (error || segment.incompatible || (segment.indexLoaded && fileSize == segment.indexedBytes)) {
+        return;
+    }
+
+    if (segment.indexedBytes == 0) {
+        std::ifstream file(segment.path, std::ios::binary);
+        TelemetrySegmentHeader segmentHeader;
+        if (!file.read(reinterpret_cast<char*>(&segmentHeader), sizeof(segmentHeader))) {
+            return; // Header not written yet
+        }
+        if (segmentHeader.magic != TelemetrySegmentHeader::kMagic || segmentHeader.version != TelemetrySegmentHeader::kVersion) {
+            spdlog::warn("Skipping telemetry segment {} with an incompatible format.", segment.path);
+            segment.incompatible = true;
+            return;
+        }
+        segment.indexedBytes = sizeof(TelemetrySegmentHeader);
+    }
+
+    std::ifstream index(segment.indexPath, std::ios::binary);
+    TelemetryIndexHeader header;
+    if (index.read(reinterpret_cast<char*>(&header), sizeof(header))
+        && header.magic == TelemetryIndexHeader::kMagic && header.version == TelemetryIndexHeader::kVersion) {
+        index.seekg(static_cast<std::streamoff>(sizeof(header) + segment.entries.size() * sizeof(TelemetryIndexEntry)));
+        TelemetryIndexEntry entry;
+        while (index.read(reinterpret_cast<char*>(&entry), sizeof(entry))) {
+            // Entries must tile the segment and stay inside the file; anything else is stale.
+            if (entry.offset != segment.indexedBytes || entry.offset + entry.blockBytes > fileSize) {
+                break;
+            }
+            segment.entries.push_back(entry);
+            segment.indexedBytes = entry.offset + entry.blockBytes;
+        }
+    }
+    segment.indexLoaded = true;
+
+    // Blocks not (yet) covered by the index file are found by walking their headers.
+    if (segment.indexedBytes < fileSize) {
+        scanBlocks(segment, fileSize);
+    }
+}
+
+/**
+ * @brief Indexes the blocks of a segment between the indexed prefix and the end of the file.
+ * @param segment The segment to scan.
+ * @param fileSize The current size of the segment file.
+ */
+void TelemetryReader::scanBlocks(Segment& segment, std::uint64_t fileSize) {
+    try {
+        bip::file_mapping file(segment.path.c_str(), bip::read_only);
+        bip::mapped_region region(file, bip::read_only, static_cast<bip::offset_t>(segment.indexedBytes),
+                                  static_cast<std::size_t>(fileSize - segment.indexedBytes));
+        const auto* base = static_cast<const std::uint8_t*>(region.get_address());
+        std::uint64_t offset = 0;
+        TelemetryBlockHeader header;
+        while (TelemetryCodec::readBlockHeader(base + offset, static_cast<std::size_t>(region.get_size() - offset), header)) {
+            segment.entries.push_back(TelemetryCodec::makeIndexEntry(header, segment.indexedBytes + offset));
+            offset += segment.entries.back().blockBytes;
+        }
+        segment.indexedBytes += offset;
+    } catch (const bip::interprocess_exception& e) {
+        spdlog::error("Failed to scan telemetry segment {}: {}", segment.path, e.what());
+    }
+}
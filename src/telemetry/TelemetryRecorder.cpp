@@ -0,0 +1,241 @@
+#include "telemetry/TelemetryRecorder.h"
+#include "spdlog/spdlog.h"
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+
+/**
+ * @brief Constructor for the TelemetryRecorder class.
+ * @param config The recorder settings.
+ */
+TelemetryRecorder::TelemetryRecorder(Config config)
+    : config_(std::move(config)), queue_(config_.queueCapacity) {
+    if (config_.directory.empty()) {
+        throw std::invalid_argument("Telemetry directory must not be empty.");
+    }
+    if (config_.samplesPerBlock == 0) {
+        config_.samplesPerBlock = 1;
+    }
+    pending_.reserve(config_.samplesPerBlock);
+}
+
+/**
+ * @brief Destructor for the TelemetryRecorder class.
+ *
+ * Flushes outstanding samples and joins the writer thread.
+ */
+TelemetryRecorder::~TelemetryRecorder() {
+    stop();
+}
+
+/**
+ * @brief Creates the output directory and starts the writer thread.
+ */
+void TelemetryRecorder::start() {
+    if (isRunning_.load()) {
+        spdlog::warn("Telemetry recorder is already running.");
+        return;
+    }
+    std::filesystem::create_directories(config_.directory);
+    queue_.reopen();
+    isRunning_.store(true);
+    writerThread_ = std::make_unique<std::thread>(&TelemetryRecorder::writerThreadFunction, this);
+    spdlog::info("Started telemetry recorder writing to {}.", config_.directory);
+}
+
+/**
+ * @brief Writes all queued samples, closes the current segment and joins the writer thread.
+ */
+void TelemetryRecorder::stop() {
+    if (!isRunning_.load()) {
+        return;
+    }
+    isRunning_.store(false);
+    queue_.close(); // Wakes the writer; it drains what is left before exiting
+    if (writerThread_ && writerThread_->joinable()) {
+        writerThread_->join();
+    }
+    writerThread_.reset();
+    spdlog::info("Stopped telemetry recorder ({} samples dropped).", queue_.dropped());
+}
+
+/**
+ * @brief Registers this recorder as a sample listener of the given AxisState.
+ * @param axisState The state whose updates should be recorded.
+ */
+void TelemetryRecorder::attach(AxisState& axisState) {
+    axisState.addSampleListener([this](const AxisSample& sample) {
+        this->record(sample);
+    });
+}
+
+/**
+ * @brief Hands a sample to the writer thread without blocking.
+ * @param sample The sample to record.
+ * @return True if the sample was queued, false if it was dropped.
+ */
+bool TelemetryRecorder::record(const AxisSample& sample) {
+    return queue_.tryPush(sample);
+}
+
+/**
+ * @brief Returns the number of samples dropped because the queue was full.
+ * @return The dropped sample count.
+ */
+std::uint64_t TelemetryRecorder::droppedSamples() {
+    return queue_.dropped();
+}
+
+/**
+ * @brief Builds the file name of the segment whose first block starts at the given time.
+ * @param startNs The earliest timestamp in the segment's first block.
+ * @param collision 0 for the first segment starting at startNs, n for the n-th one after it.
+ * @return The segment file name (without directory).
+ */
+std::string TelemetryRecorder::segmentFileName(std::int64_t startNs, unsigned collision) {
+    char name[64];
+    if (collision == 0) {
+        std::snprintf(name, sizeof(name), "segment-%020lld.kts", static_cast<long long>(startNs));
+    } else {
+        std::snprintf(name, sizeof(name), "segment-%020lld-%u.kts", static_cast<long long>(startNs), collision);
+    }
+    return name;
+}
+
+/**
+ * @brief Returns the index file name belonging to a segment file name.
+ * @param segmentFileName The segment file name.
+ * @return The index file name.
+ */
+std::string TelemetryRecorder::indexFileName(const std::string& segmentFileName) {
+    return std::filesystem::path(segmentFileName).replace_extension(".kti").string();
+}
+
+/**
+ * @brief The function executed by the writer thread.
+ *
+ * Batches queued samples into blocks and writes a partial block at least once per flush interval.
+ */
+void TelemetryRecorder::writerThreadFunction() {
+    std::vector<AxisSample> batch;
+    auto lastFlush = std::chrono::steady_clock::now();
+    const auto flushInterval = std::chrono::milliseconds(config_.flushIntervalMs);
+
+    while (true) {
+        batch.clear();
+        queue_.drain(batch, config_.flushIntervalMs);
+        for (const AxisSample& sample : batch) {
+            pending_.push_back(sample);
+            if (pending_.size() >= config_.samplesPerBlock) {
+                writeBlock();
+                lastFlush = std::chrono::steady_clock::now();
+            }
+        }
+
+        if (!pending_.empty() && std::chrono::steady_clock::now() - lastFlush >= flushInterval) {
+            writeBlock();
+            lastFlush = std::chrono::steady_clock::now();
+        }
+
+        // Exit only once stop() has closed the queue and nothing is left in it; checking the
+        // running flag instead would drop a sample pushed between this drain and stop().
+        if (batch.empty() && queue_.closedAndEmpty()) {
+            break;
+        }
+    }
+
+    writeBlock();
+    closeSegment();
+}
+
+/**
+ * @brief Encodes the pending samples as one block and appends it to the current segment.
+ */
+void TelemetryRecorder::writeBlock() {
+    if (pending_.empty()) {
+        return;
+    }
+    encoded_.clear();
+    TelemetryCodec::encodeBlock(pending_, encoded_);
+    TelemetryBlockHeader header;
+    TelemetryCodec::readBlockHeader(encoded_.data(), encoded_.size(), header);
+
+    if (!segment_.is_open() || segmentBytes_ + encoded_.size() > config_.maxSegmentBytes) {
+        openSegment(header.minTimestampNs);
+    }
+    pending_.clear();
+    if (!segment_.is_open()) {
+        return; // openSegment() already logged the failure; the block is lost
+    }
+
+    segment_.write(reinterpret_cast<const char*>(encoded_.data()), static_cast<std::streamsize>(encoded_.size()));
+    segment_.flush(); // Blocks become visible to readers mapping the file as soon as they are complete
+    if (!segment_) {
+        spdlog::error("Failed to write telemetry block ({} bytes).", encoded_.size());
+        closeSegment();
+        return;
+    }
+
+    // The index entry is written after its block, so an index never points past the data.
+    const TelemetryIndexEntry entry = TelemetryCodec::makeIndexEntry(header, segmentBytes_);
+    index_.write(reinterpret_cast<const char*>(&entry), sizeof(entry));
+    index_.flush();
+    segmentBytes_ += encoded_.size();
+}
+
+/**
+ * @brief Closes the current segment (if any) and starts a new one.
+ * @param startNs The earliest timestamp in the first block written to the new segment.
+ */
+void TelemetryRecorder::openSegment(std::int64_t startNs) {
+    closeSegment();
+    // Created exclusively: a restart or a repeated start time must never overwrite an existing segment.
+    std::filesystem::path path;
+    for (unsigned collision = 0; collision < kMaxNameCollisions; ++collision) {
+        path = std::filesystem::path(config_.directory) / segmentFileName(startNs, collision);
+        if (std::FILE* file = std::fopen(path.string().c_str(), "wbx")) {
+            std::fclose(file);
+            segment_.open(path, std::ios::binary | std::ios::out);
+            break;
+        }
+        if (errno != EEXIST) {
+            break;
+        }
+    }
+    if (!segment_.is_open()) {
+        spdlog::error("Failed to create telemetry segment {}: {}", path.string(), std::strerror(errno));
+        return;
+    }
+
+    TelemetrySegmentHeader header;
+    header.createdNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    segment_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    segmentBytes_ = sizeof(header);
+
+    // The segment name is new, so an index file of that name can only be a stale leftover.
+    const std::filesystem::path indexPath = std::filesystem::path(config_.directory) / indexFileName(path.filename().string());
+    index_.open(indexPath, std::ios::binary | std::ios::out | std::ios::trunc);
+    if (!index_.is_open()) {
+        spdlog::warn("Failed to open telemetry index {}; readers will scan the segment instead.", indexPath.string());
+    }
+    TelemetryIndexHeader indexHeader;
+    index_.write(reinterpret_cast<const char*>(&indexHeader), sizeof(indexHeader));
+    spdlog::info("Opened telemetry segment {}.", path.string());
+}
+
+/**
+ * @brief Flushes and closes the current segment.
+ */
+void TelemetryRecorder::closeSegment() {
+    if (segment_.is_open()) {
+        segment_.close();
+    }
+    if (index_.is_open()) {
+        index_.close();
+    }
+    segmentBytes_ = 0;
+}
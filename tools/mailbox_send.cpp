@@ -0,0 +1,89 @@
+#include "ipc/CommandMailbox.h"
+#include <cstdio>
+#include <exception>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Sends commands to a controller through a process's command mailbox.
+ *
+ * Usage: kohzu-mailbox-send <mailbox> [--timeout <ms>] <command>...
+ * Every command is submitted before any reply is awaited, and each reply line
+ * is printed in command order.
+ */
+namespace {
+
+void printUsage() {
+    std::fprintf(stderr,
+        "Usage: kohzu-mailbox-send <mailbox> [--timeout <ms>] <command>...\n"
+        "  --timeout  Maximum wait per reply in milliseconds (default: 2000)\n"
+        "  command    An encoded command line, e.g. RDP1 or APS1/0/1000/0\n");
+}
+
+/**
+ * @brief Releases the tickets whose replies will not be collected, so their slots return to the mailbox.
+ */
+void releaseTickets(CommandMailboxClient& client, const std::vector<std::uint32_t>& tickets, std::size_t first) {
+    for (std::size_t i = first; i < tickets.size(); ++i) {
+        client.release(tickets[i]);
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        printUsage();
+        return 1;
+    }
+
+    std::chrono::milliseconds timeout(2000);
+    std::vector<std::string> commands;
+    try {
+        for (int i = 2; i < argc; ++i) {
+            const std::string argument = argv[i];
+            if (argument == "--timeout" && i + 1 < argc) {
+                timeout = std::chrono::milliseconds(std::stoi(argv[++i]));
+            } else {
+                commands.push_back(argument);
+            }
+        }
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "Invalid argument: %s\n", e.what());
+        return 1;
+    }
+
+    try {
+        CommandMailboxClient client(argv[1]);
+        std::vector<std::uint32_t> tickets;
+        for (const std::string& command : commands) {
+            std::uint32_t ticket = 0;
+            if (!client.submit(command, ticket)) {
+                std::fprintf(stderr, "Mailbox full or command too long: %s\n", command.c_str());
+                releaseTickets(client, tickets, 0);
+                return 1;
+            }
+            tickets.push_back(ticket);
+        }
+
+        int status = 0;
+        MailboxCompletion completion;
+        for (std::size_t i = 0; i < tickets.size(); ++i) {
+            if (!client.wait(tickets[i], completion, timeout)) {
+                std::fprintf(stderr, "Timed out waiting for: %s\n", commands[i].c_str());
+                releaseTickets(client, tickets, i);
+                return 1;
+            }
+            if (completion.result == MailboxResult::malformedCommand) {
+                std::fprintf(stderr, "Malformed command: %s\n", commands[i].c_str());
+                status = 1;
+                continue;
+            }
+            std::printf("%s\n", completion.response.c_str());
+        }
+        return status;
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "Cannot open mailbox %s: %s\n", argv[1], e.what());
+        return 1;
+    }
+}
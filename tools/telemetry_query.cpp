@@ -0,0 +1,90 @@
+#include "telemetry/TelemetryReader.h"
+#include "spdlog/spdlog.h"
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Dumps recorded telemetry samples as tab-separated lines.
+ *
+ * Usage: kohzu-telemetry-query <directory> [--from <ns>] [--to <ns>] [--last <seconds>] [--axes 1,2,3]
+ * Output columns: timestamp_ns, axis, position, status word (hex).
+ */
+namespace {
+
+void printUsage() {
+    std::fprintf(stderr,
+        "Usage: kohzu-telemetry-query <directory> [--from <ns>] [--to <ns>] [--last <seconds>] [--axes 1,2,3]\n"
+        "  --from   Inclusive start time in nanoseconds since the epoch\n"
+        "  --to     Inclusive end time in nanoseconds since the epoch\n"
+        "  --last   Select the final N seconds of the recording (overrides --from/--to)\n"
+        "  --axes   Comma-separated axis numbers (default: all)\n");
+}
+
+std::vector<int> parseAxes(const std::string& list) {
+    std::vector<int> axes;
+    std::stringstream ss(list);
+    std::string token;
+    while (std::getline(ss, token, ',')) {
+        axes.push_back(std::stoi(token));
+    }
+    return axes;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        printUsage();
+        return 1;
+    }
+    spdlog::set_level(spdlog::level::warn);
+
+    TelemetryReader reader(argv[1]);
+    TelemetryQuery query;
+    double lastSeconds = -1.0;
+    try {
+        for (int i = 2; i < argc; ++i) {
+            const std::string option = argv[i];
+            if (i + 1 >= argc) {
+                printUsage();
+                return 1;
+            }
+            const std::string value = argv[++i];
+            if (option == "--from") {
+                query.startNs = std::stoll(value);
+            } else if (option == "--to") {
+                query.endNs = std::stoll(value);
+            } else if (option == "--last") {
+                lastSeconds = std::stod(value);
+            } else if (option == "--axes") {
+                query.selectAxes(parseAxes(value));
+            } else {
+                printUsage();
+                return 1;
+            }
+        }
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "Invalid argument: %s\n", e.what());
+        return 1;
+    }
+
+    if (lastSeconds >= 0.0) {
+        std::int64_t firstNs, lastNs;
+        if (!reader.timeRange(firstNs, lastNs)) {
+            return 0;
+        }
+        query.endNs = lastNs;
+        query.startNs = lastNs - static_cast<std::int64_t>(lastSeconds * 1e9);
+    }
+
+    std::vector<AxisSample> samples;
+    reader.query(query, samples);
+    for (const AxisSample& sample : samples) {
+        std::printf("%lld\t%d\t%d\t%06x\n", static_cast<long long>(sample.timestampNs), sample.axisNo,
+                    sample.position, sample.statusWord);
+    }
+    return 0;
+}
@@ -0,0 +1,162 @@
+#include "controller/BasicKohzuController.h"
+#include "controller/KohzuController.h"
+#include "core/ICommunicationClient.h"
+#include "spdlog/spdlog.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <string>
+
+/**
+ * @brief Measures what virtual dispatch and std::function cost on the command path.
+ *
+ * Usage: kohzu-transport-benchmark [commands]
+ * Every path runs over an in-memory loopback that answers every command at
+ * once, so the figures are the library's own cost per command: formatting,
+ * writing, parsing the reply, matching it and running the completion.
+ *
+ * The headline comparison runs the same BasicKohzuController twice: once
+ * type-erased, on the virtual ICommunicationClient interface with std::function
+ * read callbacks and completions, and once with the loopback and completion
+ * types bound at compile time. Everything else is identical, so the difference
+ * is the cost of the indirection alone.
+ *
+ * KohzuController is reported as well, for reference. Its pipeline does more per
+ * command (string parameters, the CallbackProfiler, the cancellable slot table,
+ * a std::map key lookup, log level checks), so its gap to the others is not the
+ * cost of dispatch.
+ */
+namespace {
+
+/**
+ * @brief Builds the controller's reply to one command line: "C\t<command><axis>\t0".
+ */
+void makeReply(std::string_view line, std::string& reply) {
+    const std::size_t keyEnd = line.find_first_of("/\r");
+    reply.assign("C\t");
+    reply.append(line.substr(0, keyEnd));
+    reply.append("\t0\r\n");
+}
+
+/**
+ * @brief Answers every written command line through a callback that handleRead() sits behind.
+ */
+template <typename Deliver>
+void answer(std::string& outbox, std::string& reply, Deliver&& deliver) {
+    std::size_t start = 0;
+    while (start < outbox.size()) {
+        const std::size_t end = outbox.find('\n', start);
+        makeReply(std::string_view(outbox).substr(start, end - start), reply);
+        deliver(reply);
+        start = end + 1;
+    }
+    outbox.clear();
+}
+
+/**
+ * @brief Loopback behind the virtual ICommunicationClient interface.
+ */
+class LoopbackClient : public ICommunicationClient {
+public:
+    void connect(const std::string&, const std::string&) override {}
+    void connect(const std::string&, const std::string&, std::error_code& error) override { error.clear(); }
+    void asyncWrite(const std::string& data) override { outbox_.append(data); }
+    void asyncRead(std::function<void(const std::string&)> callback) override { callback_ = std::move(callback); }
+
+    void pump() {
+        answer(outbox_, reply_, [this](const std::string& line) { callback_(line); });
+    }
+
+private:
+    std::string outbox_;
+    std::string reply_;
+    std::function<void(const std::string&)> callback_;
+};
+
+/**
+ * @brief Loopback with a templated read loop, so replies reach the handler by a direct call.
+ */
+class LoopbackTransport {
+public:
+    void asyncWrite(const std::string& data) { outbox_.append(data); }
+
+    template <typename Sink>
+    void pump(Sink& sink) {
+        answer(outbox_, reply_, [&sink](const std::string& line) { sink.handleRead(line); });
+    }
+
+private:
+    std::string outbox_;
+    std::string reply_;
+};
+
+struct CountCompletion {
+    std::uint64_t* completed;
+    void operator()(const ProtocolResponse& response) { *completed += response.status == 'C'; }
+};
+
+template <typename Function>
+double nsPerCommand(std::uint64_t commands, Function&& function) {
+    const auto start = std::chrono::steady_clock::now();
+    function();
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::nano>(elapsed).count() / static_cast<double>(commands);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    const std::uint64_t commands = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 200000;
+    spdlog::set_level(spdlog::level::warn);
+
+    // Reference: the full KohzuController / ProtocolHandler pipeline.
+    auto client = std::make_shared<LoopbackClient>();
+    KohzuController controller(std::make_shared<ProtocolHandler>(client), std::make_shared<AxisState>());
+    controller.start();
+    std::uint64_t fullCompleted = 0;
+    const double fullNs = nsPerCommand(commands, [&] {
+        for (std::uint64_t i = 0; i < commands; ++i) {
+            controller.moveAbsolute(1 + static_cast<int>(i % 4), static_cast<int>(i), 0, 0,
+                                    CountCompletion{&fullCompleted});
+            client->pump();
+        }
+    });
+
+    // The same BasicKohzuController pipeline, type-erased: virtual transport, std::function callbacks.
+    LoopbackClient erasedClient;
+    BasicKohzuController<ICommunicationClient, std::function<void(const ProtocolResponse&)>> erasedController(
+        erasedClient, std::make_shared<AxisState>());
+    erasedController.start();
+    std::uint64_t virtualCompleted = 0;
+    const double virtualNs = nsPerCommand(commands, [&] {
+        for (std::uint64_t i = 0; i < commands; ++i) {
+            erasedController.moveAbsolute(1 + static_cast<int>(i % 4), static_cast<int>(i), 0, 0,
+                                          CountCompletion{&virtualCompleted});
+            erasedClient.pump();
+        }
+    });
+
+    // Transport and completion bound at compile time.
+    LoopbackTransport transport;
+    BasicKohzuController<LoopbackTransport, CountCompletion> basicController(transport, std::make_shared<AxisState>());
+    std::uint64_t staticCompleted = 0;
+    const double staticNs = nsPerCommand(commands, [&] {
+        for (std::uint64_t i = 0; i < commands; ++i) {
+            basicController.moveAbsolute(1 + static_cast<int>(i % 4), static_cast<int>(i), 0, 0,
+                                         CountCompletion{&staticCompleted});
+            transport.pump(basicController.protocolHandler());
+        }
+    });
+
+    std::printf("commands                            %llu\n", static_cast<unsigned long long>(commands));
+    std::printf("BasicKohzuController, type-erased   %8.1f ns/command (%llu completed)\n", virtualNs,
+                static_cast<unsigned long long>(virtualCompleted));
+    std::printf("BasicKohzuController, compile-time  %8.1f ns/command (%llu completed)\n", staticNs,
+                static_cast<unsigned long long>(staticCompleted));
+    std::printf("dispatch speedup                    %8.2fx\n", staticNs > 0.0 ? virtualNs / staticNs : 0.0);
+    std::printf("KohzuController (full pipeline)     %8.1f ns/command (%llu completed)\n", fullNs,
+                static_cast<unsigned long long>(fullCompleted));
+    return fullCompleted == commands && virtualCompleted == commands && staticCompleted == commands ? 0 : 1;
+}